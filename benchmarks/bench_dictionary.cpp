@@ -0,0 +1,138 @@
+/*
+ * Fledge "pivottoopcua" filter plugin.
+ *
+ * Copyright (c) 2020 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include "benchmark.h"
+
+// System headers
+#include <unistd.h>
+#include <thread>
+
+// Fledge headers
+#include "rapidjson/document.h"
+
+// Project headers
+#include "pivot2opcua_data.h"
+#include "pivot2opcua_snapshot.h"
+
+/** Duration of DataDictionnary construction from the "exchanged_data" JSON */
+BENCHMARK(DictionaryBuild) {
+    const std::vector<size_t> sizes(bench::quick() ?
+            std::vector<size_t>{1000, 10000} :
+            std::vector<size_t>{1000, 10000, 100000, 300000});
+    for (const size_t size : sizes) {
+        const std::string json(bench::syntheticExchangedData(size));
+        // JSON parsing alone, to separate the parser cost from the dictionary build cost
+        const double parseMs(bench::bestOfMs(3, [&json]() {
+            rapidjson::Document document;
+            document.Parse(json.c_str());
+        }));
+        const double ms(bench::bestOfMs(3, [&json, size]() {
+            const DataDictionnary dictionnary(json);
+            if (dictionnary.isEmpty(dictionnary.find(bench::syntheticPivotId(size - 1)))) {
+                printf("ERROR: missing entry\n");
+            }
+        }));
+        printf("  %8zu datapoints (%6.1f MB): %9.2f ms (JSON parsing: %9.2f ms)\n",
+                size, static_cast<double>(json.size()) / 1e6, ms, parseMs);
+    }
+}
+
+/**
+ * Peak memory of DataDictionnary construction (single pass SAX parsing),
+ * compared to a DOM-based build (whole document alive while the dictionnary is filled)
+ */
+BENCHMARK(DictionaryPeakRss) {
+    const std::vector<size_t> sizes(bench::quick() ?
+            std::vector<size_t>{10000} :
+            std::vector<size_t>{100000, 300000});
+    for (const size_t size : sizes) {
+        const std::string json(bench::syntheticExchangedData(size));
+        const int64_t domKb(bench::peakRssDeltaKb([&json]() {
+            rapidjson::Document document;
+            document.Parse(json.c_str());
+            const DataDictionnary dictionnary(json);
+        }));
+        const int64_t saxKb(bench::peakRssDeltaKb([&json]() {
+            const DataDictionnary dictionnary(json);
+        }));
+        printf("  %8zu datapoints (%6.1f MB): peak RSS DOM + dictionnary %8.1f MB, SAX dictionnary %8.1f MB\n",
+                size, static_cast<double>(json.size()) / 1e6,
+                static_cast<double>(domKb) / 1024, static_cast<double>(saxKb) / 1024);
+    }
+}
+
+/** DataDictionnary construction with several parsing threads */
+BENCHMARK(DictionaryParallel) {
+    const size_t size(bench::quick() ? 50000 : 1000000);
+    const std::string json(bench::syntheticExchangedData(size));
+    printf("  %8zu datapoints (%6.1f MB), %u CPUs\n", size, static_cast<double>(json.size()) / 1e6,
+            std::thread::hardware_concurrency());
+    for (const unsigned threads : {1u, 2u, 4u, 8u}) {
+        const double ms(bench::bestOfMs(bench::quick() ? 1 : 2, [&json, threads]() {
+            const DataDictionnary dictionnary(json, threads);
+        }));
+        printf("  %8u threads: %9.2f ms\n", threads, ms);
+    }
+}
+
+/** Warm startup: DataDictionnary read from its snapshot instead of the JSON */
+BENCHMARK(DictionarySnapshot) {
+    const std::vector<size_t> sizes(bench::quick() ?
+            std::vector<size_t>{10000} :
+            std::vector<size_t>{100000, 300000});
+    const std::string path("/tmp/p2o_bench_" + std::to_string(getpid()) + ".snapshot");
+    for (const size_t size : sizes) {
+        const std::string json(bench::syntheticExchangedData(size));
+        uint64_t hash(0);
+        const double hashMs(bench::bestOfMs(3, [&json, &hash]() {
+            hash = DictionarySnapshot::contentHash(json.data(), json.size());
+        }));
+        const double jsonMs(bench::bestOfMs(3, [&json]() {
+            const DataDictionnary dictionnary(json);
+        }));
+        DictionarySnapshot::save(path, hash, DataDictionnary(json));
+        const double loadMs(bench::bestOfMs(3, [&path, hash]() {
+            if (DictionarySnapshot::load(path, hash) == nullptr) printf("ERROR: snapshot not loaded\n");
+        }));
+        printf("  %8zu datapoints (%6.1f MB): JSON %9.2f ms, snapshot %9.2f ms (+ config hash %6.2f ms)\n",
+                size, static_cast<double>(json.size()) / 1e6, jsonMs, loadMs, hashMs);
+    }
+    unlink(path.c_str());
+}
+
+/**
+ * Hierarchical pivot ids: enumerated exact entries (hash map) compared to
+ * a few patterns (radix trie)
+ */
+BENCHMARK(DictionaryPatterns) {
+    const size_t size(bench::quick() ? 30000 : 300000);
+    const size_t lookups(bench::quick() ? 100000 : 1000000);
+    std::vector<std::string> ids;
+    ids.reserve(lookups);
+    for (size_t i = 0 ; i < lookups ; i++) {
+        ids.push_back(bench::syntheticHierarchicalId((i * 7919) % size));
+    }
+    for (const bool patterns : {false, true}) {
+        const std::string json(bench::syntheticHierarchicalData(size, patterns));
+        const double buildMs(bench::bestOfMs(3, [&json]() {
+            const DataDictionnary dictionnary(json);
+        }));
+        const DataDictionnary dictionnary(json);
+        size_t found(0);
+        const double lookupMs(bench::bestOfMs(3, [&dictionnary, &ids, &found]() {
+            found = 0;
+            for (const std::string& id : ids) {
+                if (dictionnary.lookup(id) != nullptr) found++;
+            }
+        }));
+        if (found != ids.size()) printf("ERROR: %zu ids not found\n", ids.size() - found);
+        printf("  %-10s %8zu entries, config %10zu bytes: build %9.2f ms, lookup %6.1f ns\n",
+                patterns ? "patterns" : "exact", dictionnary.size(), json.size(), buildMs,
+                lookupMs * 1e6 / static_cast<double>(ids.size()));
+    }
+}
@@ -0,0 +1,381 @@
+/*
+ * Fledge "pivottoopcua" filter plugin.
+ *
+ * Copyright (c) 2020 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include "benchmark.h"
+
+// System headers
+#include <time.h>
+#include <initializer_list>
+
+// Fledge headers
+#include "config_category.h"
+#include "reading_set.h"
+
+// Project headers
+#include "pivot2opcua_common.h"
+#include "pivot2opcua_filter.h"
+
+namespace {
+
+Datapoint* dpObject(const std::string& name, std::initializer_list<Datapoint*> children) {
+    std::vector<Datapoint*>* values(new std::vector<Datapoint*>(children));
+    DatapointValue dpv(values, true);
+    return new Datapoint(name, dpv);
+}
+
+Datapoint* dpInt(const std::string& name, int64_t value) {
+    DatapointValue dpv(static_cast<long>(value));  // //NOLINT
+    return new Datapoint(name, dpv);
+}
+
+Datapoint* dpString(const std::string& name, const std::string& value) {
+    DatapointValue dpv(value);
+    return new Datapoint(name, dpv);
+}
+
+/** @return A PIVOT "GTIM" object (MvTyp) */
+Datapoint* pivotMvDatapoint(const std::string& pivotId, int64_t index) {
+    Datapoint* q(dpObject("q", {dpString("Validity", "good"), dpString("Source", "process"),
+            dpObject("DetailQuality", {dpInt("oldData", 0), dpInt("overflow", 0)})}));
+    Datapoint* t(dpObject("t", {dpInt("SecondSinceEpoch", 1700000000 + index), dpInt("FractionOfSecond", 1234),
+            dpObject("TimeQuality", {dpInt("clockFailure", 0), dpInt("timeAccuracy", 10)})}));
+    DatapointValue f(3.14);
+    Datapoint* mag(dpObject("mag", {new Datapoint("f", f)}));
+    return dpObject("PIVOT", {dpObject("GTIM", {
+            dpObject("Cause", {dpInt("stVal", 3)}),
+            dpObject("Confirmation", {dpInt("stVal", 0)}),
+            dpString("ComingFrom", "iec104"),
+            dpString("Identifier", pivotId),
+            dpObject("TmOrg", {dpString("stVal", "genuine")}),
+            dpObject("TmValidity", {dpString("stVal", "good")}),
+            dpObject("MvTyp", {q, t, mag})})});
+}
+
+/** @return A PIVOT "GTIM" reading (MvTyp) */
+Reading* pivotMvReading(const std::string& pivotId, int64_t index) {
+    return new Reading("bench", pivotMvDatapoint(pivotId, index));
+}
+
+void ignoreOutput(OUTPUT_HANDLE* handle, READINGSET* readings) {
+    (void)handle;
+    (void)readings;
+}
+
+/** Simulated next filter: busy for a given time per call and per reading, records when the first output came */
+struct Downstream {
+    const READINGSET*   input;
+    int64_t             usPerCall;
+    int64_t             usPerReading;
+    int64_t             firstOutputUs;
+    size_t              nbOutputs;
+};
+
+int64_t monotonicUs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+void downstreamOutput(OUTPUT_HANDLE* handle, READINGSET* readings) {
+    Downstream* downstream(static_cast<Downstream*>(handle));
+    const int64_t startUs(monotonicUs());
+    if (downstream->nbOutputs++ == 0) downstream->firstOutputUs = startUs;
+    const int64_t endUs(startUs + downstream->usPerCall +
+            downstream->usPerReading * static_cast<int64_t>(readings->getAllReadings().size()));
+    while (monotonicUs() < endUs) {}
+    // Chunks are owned by the next filter
+    if (readings != downstream->input) delete readings;
+}
+
+/** Simulated north: serializes every output reading (when enabled), as sent or buffered */
+struct Serializer {
+    bool    enabled;
+    size_t  bytes;
+};
+
+void serializeOutput(OUTPUT_HANDLE* handle, READINGSET* readings) {
+    Serializer* serializer(static_cast<Serializer*>(handle));
+    if (!serializer->enabled) return;
+    for (const Reading* reading : readings->getAllReadings()) {
+        serializer->bytes += reading->toJSON().size();
+    }
+}
+
+}   // namespace
+
+/**
+ * Ingest of a large set (e.g. general interrogation), forwarded at once or by chunks
+ * to a next filter spending 2 us per reading: delay until the next filter gets data,
+ * and until the whole set is processed
+ */
+BENCHMARK(IngestChunks) {
+    const size_t nbEntries(30000);
+    const size_t nbReadings(bench::quick() ? 5000 : 50000);
+    const std::string json(bench::syntheticExchangedData(nbEntries));
+    for (const size_t chunkSize : {size_t(0), size_t(1000), size_t(5000)}) {
+        const std::string chunkValue(std::to_string(chunkSize));
+        ConfigCategory config;
+        config.addItem("enable", "enable", "boolean", "true", "true");
+        config.addItem(JSON_EXCHANGED_DATA, JSON_EXCHANGED_DATA, "JSON", json, json);
+        config.addItem(JSON_CHUNK_SIZE, JSON_CHUNK_SIZE, "integer", chunkValue, chunkValue);
+        Downstream downstream{nullptr, 0, 2, 0, 0};
+        Pivot2OpcuaFilter filter("bench", config, &downstream, &downstreamOutput);
+
+        std::vector<Reading*> readings;
+        for (size_t i = 0 ; i < nbReadings ; i++) {
+            readings.push_back(pivotMvReading(bench::syntheticPivotId((i * 3 + 2) % nbEntries),
+                    static_cast<int64_t>(i)));
+        }
+        ReadingSet burst(&readings);
+        downstream.input = &burst;
+        const int64_t startUs(monotonicUs());
+        filter.ingest(&burst);
+        const int64_t endUs(monotonicUs());
+        printf("  %8zu readings, chunks of %5zu: first output after %8.2f ms, done after %8.2f ms (%zu outputs)\n",
+                nbReadings, chunkSize, static_cast<double>(downstream.firstOutputUs - startUs) / 1000.0,
+                static_cast<double>(endUs - startUs) / 1000.0, downstream.nbOutputs);
+    }
+}
+
+/**
+ * Ingest of sets of a single reading, passed on to a next filter with a fixed cost
+ * of 20 us per call, with or without aggregation
+ */
+BENCHMARK(IngestBatches) {
+    const size_t nbEntries(30000);
+    const size_t nbReadings(bench::quick() ? 2000 : 20000);
+    const std::string json(bench::syntheticExchangedData(nbEntries));
+    for (const size_t batchSize : {size_t(0), size_t(10), size_t(100)}) {
+        const std::string batchValue(std::to_string(batchSize));
+        ConfigCategory config;
+        config.addItem("enable", "enable", "boolean", "true", "true");
+        config.addItem(JSON_EXCHANGED_DATA, JSON_EXCHANGED_DATA, "JSON", json, json);
+        config.addItem(JSON_BATCH_SIZE, JSON_BATCH_SIZE, "integer", batchValue, batchValue);
+        Downstream downstream{nullptr, 20, 0, 0, 0};
+        Pivot2OpcuaFilter filter("bench", config, &downstream, &downstreamOutput);
+
+        double ms(0);
+        for (size_t i = 0 ; i < nbReadings ; i++) {
+            std::vector<Reading*> readings{pivotMvReading(bench::syntheticPivotId((i * 3 + 2) % nbEntries),
+                    static_cast<int64_t>(i))};
+            ReadingSet* single(new ReadingSet(&readings));
+            ms += bench::bestOfMs(1, [single, &filter]() {
+                filter.ingest(single);
+            });
+        }
+        printf("  %8zu single readings, batches of %3zu: %9.2f ms (%6.0f ns/reading), %zu outputs\n", nbReadings,
+                batchSize, ms, ms * 1e6 / static_cast<double>(nbReadings), downstream.nbOutputs);
+    }
+}
+
+/**
+ * Time spent by the upstream thread in ingest, for sets of 10 readings, with the
+ * conversion done synchronously or by the conversion thread
+ */
+BENCHMARK(IngestAsync) {
+    const size_t nbEntries(30000);
+    const size_t nbSets(bench::quick() ? 200 : 2000);
+    const size_t setSize(10);
+    const std::string json(bench::syntheticExchangedData(nbEntries));
+    for (const size_t depth : {size_t(0), size_t(64), size_t(4096)}) {
+        const std::string depthValue(std::to_string(depth));
+        ConfigCategory config;
+        config.addItem("enable", "enable", "boolean", "true", "true");
+        config.addItem(JSON_EXCHANGED_DATA, JSON_EXCHANGED_DATA, "JSON", json, json);
+        config.addItem(JSON_ASYNC_QUEUE, JSON_ASYNC_QUEUE, "integer", depthValue, depthValue);
+        Downstream downstream{nullptr, 0, 0, 0, 0};
+        double ms(0);
+        const int64_t startUs(monotonicUs());
+        {
+            Pivot2OpcuaFilter filter("bench", config, &downstream, &downstreamOutput);
+            for (size_t i = 0 ; i < nbSets ; i++) {
+                std::vector<Reading*> readings;
+                for (size_t j = 0 ; j < setSize ; j++) {
+                    const size_t index(i * setSize + j);
+                    readings.push_back(pivotMvReading(bench::syntheticPivotId((index * 3 + 2) % nbEntries),
+                            static_cast<int64_t>(index)));
+                }
+                ReadingSet* readingSet(new ReadingSet(&readings));
+                ms += bench::bestOfMs(1, [readingSet, &filter]() {
+                    filter.ingest(readingSet);
+                });
+            }
+        }
+        const double totalMs(static_cast<double>(monotonicUs() - startUs) / 1000.0);
+        printf("  %8zu sets, queue depth %4zu: %8.2f us per set in ingest (total %8.2f ms, %zu outputs)\n",
+                nbSets, depth, ms * 1000.0 / static_cast<double>(nbSets), totalMs, downstream.nbOutputs);
+    }
+}
+
+/**
+ * Ingest of PIVOT measurements, with a share of pivot ids that are not in
+ * "exchanged_data" (rejected before decoding the rest of the object)
+ */
+BENCHMARK(IngestUnmapped) {
+    const size_t nbEntries(30000);
+    const size_t nbReadings(bench::quick() ? 20000 : 200000);
+    const size_t batchSize(100);
+    const std::string json(bench::syntheticExchangedData(nbEntries));
+    ConfigCategory config;
+    config.addItem("enable", "enable", "boolean", "true", "true");
+    config.addItem(JSON_EXCHANGED_DATA, JSON_EXCHANGED_DATA, "JSON", json, json);
+    Pivot2OpcuaFilter filter("bench", config, nullptr, &ignoreOutput);
+
+    for (const unsigned unmappedPercent : {0u, 50u, 100u}) {
+        double bestMs(-1);
+        for (unsigned repeat = 0 ; repeat < 3 ; repeat++) {
+            // Readings are modified by the conversion: each batch is built (cache-hot) just before its ingest
+            double ms(0);
+            for (size_t i = 0 ; i < nbReadings ; i += batchSize) {
+                std::vector<Reading*> readings;
+                for (size_t j = i ; j < i + batchSize ; j++) {
+                    const bool unmapped((j * 37) % 100 < unmappedPercent);
+                    // Synthetic datapoints 3k+2 are measurements ("MvTyp")
+                    readings.push_back(pivotMvReading(unmapped ?
+                            "UNMAPPED_" + std::to_string(j % 1000) :
+                            bench::syntheticPivotId((j * 3 + 2) % nbEntries), static_cast<int64_t>(j)));
+                }
+                ReadingSet batch(&readings);
+                ms += bench::bestOfMs(1, [&batch, &filter]() {
+                    filter.ingest(&batch);
+                });
+            }
+            if (bestMs < 0 || ms < bestMs) bestMs = ms;
+        }
+        printf("  %8zu readings, %3u%% unmapped: %9.2f ms (%6.0f ns/reading)\n", nbReadings, unmappedPercent,
+                bestMs, bestMs * 1e6 / static_cast<double>(nbReadings));
+    }
+}
+
+/**
+ * Ingest of PIVOT measurements packed by several PIVOT objects per reading (fanned
+ * out by the filter), compared to the same objects sent one per reading
+ */
+BENCHMARK(IngestFanOut) {
+    const size_t nbEntries(30000);
+    const size_t nbObjects(bench::quick() ? 20000 : 200000);
+    const size_t batchSize(100);
+    const std::string json(bench::syntheticExchangedData(nbEntries));
+    ConfigCategory config;
+    config.addItem("enable", "enable", "boolean", "true", "true");
+    config.addItem(JSON_EXCHANGED_DATA, JSON_EXCHANGED_DATA, "JSON", json, json);
+    Pivot2OpcuaFilter filter("bench", config, nullptr, &ignoreOutput);
+
+    for (const size_t perReading : {1u, 4u, 16u}) {
+        double bestMs(-1);
+        for (unsigned repeat = 0 ; repeat < 3 ; repeat++) {
+            // Batches of 'batchSize' objects, built (cache-hot) just before their ingest
+            double ms(0);
+            for (size_t i = 0 ; i < nbObjects ; i += batchSize) {
+                std::vector<Reading*> readings;
+                for (size_t j = i ; j < i + batchSize ; j += perReading) {
+                    std::vector<Datapoint*> objects;
+                    for (size_t k = j ; k < j + perReading ; k++) {
+                        // Synthetic datapoints 3k+2 are measurements ("MvTyp")
+                        objects.push_back(pivotMvDatapoint(bench::syntheticPivotId((k * 3 + 2) % nbEntries),
+                                static_cast<int64_t>(k)));
+                    }
+                    readings.push_back(new Reading("bench", objects));
+                }
+                ReadingSet batch(&readings);
+                ms += bench::bestOfMs(1, [&batch, &filter]() {
+                    filter.ingest(&batch);
+                });
+            }
+            if (bestMs < 0 || ms < bestMs) bestMs = ms;
+        }
+        printf("  %8zu objects, %2zu per reading: %9.2f ms (%6.0f ns/object)\n", nbObjects, perReading,
+                bestMs, bestMs * 1e6 / static_cast<double>(nbObjects));
+    }
+}
+
+/**
+ * Ingest of readings unrelated to PIVOT (e.g. statistics), decoded as PIVOT
+ * objects (default routing) or passed through by the asset routing table
+ */
+BENCHMARK(IngestUnrelated) {
+    const size_t nbReadings(bench::quick() ? 20000 : 200000);
+    const size_t batchSize(100);
+    const std::string json(bench::syntheticExchangedData(1000));
+    for (const bool passthrough : {false, true}) {
+        ConfigCategory config;
+        config.addItem("enable", "enable", "boolean", "true", "true");
+        config.addItem(JSON_EXCHANGED_DATA, JSON_EXCHANGED_DATA, "JSON", json, json);
+        const std::string routing(passthrough ? "{\"stats*\" : \"passthrough\"}" : "{}");
+        config.addItem(JSON_ASSET_ROUTING, JSON_ASSET_ROUTING, "JSON", routing, routing);
+        Pivot2OpcuaFilter filter("bench", config, nullptr, &ignoreOutput);
+
+        std::vector<Reading*> readings;
+        for (size_t i = 0 ; i < batchSize ; i++) {
+            readings.push_back(new Reading("stats" + std::to_string(i % 10),
+                    {dpInt("READINGS", static_cast<int64_t>(i)), dpInt("DISCARDED", 0)}));
+        }
+        ReadingSet batch(&readings);
+        // Unrelated readings are not modified: the same batch is ingested again
+        const double ms(bench::bestOfMs(3, [&batch, &filter, nbReadings, batchSize]() {
+            for (size_t i = 0 ; i < nbReadings ; i += batchSize) {
+                filter.ingest(&batch);
+            }
+        }));
+        printf("  %8zu readings, %s: %9.2f ms (%6.0f ns/reading)\n", nbReadings,
+                passthrough ? "passthrough" : "pivot2opcua", ms, ms * 1e6 / static_cast<double>(nbReadings));
+    }
+}
+
+/**
+ * Conversion of measurements with each output layout: time and allocations per object,
+ * then time and serialized size per object when the output is also serialized
+ */
+BENCHMARK(IngestLayout) {
+    const size_t nbEntries(30000);
+    const size_t nbObjects(bench::quick() ? 20000 : 200000);
+    const size_t batchSize(100);
+    const std::string json(bench::syntheticExchangedData(nbEntries));
+    const char* const layouts[] = {"default", "compact", "packed"};
+    for (size_t layout = 0 ; layout < 3 ; layout++) {
+        ConfigCategory config;
+        config.addItem("enable", "enable", "boolean", "true", "true");
+        config.addItem(JSON_EXCHANGED_DATA, JSON_EXCHANGED_DATA, "JSON", json, json);
+        const std::string compact(layout == 1 ? "true" : "false");
+        const std::string packed(layout == 2 ? "true" : "false");
+        config.addItem(JSON_COMPACT_OUTPUT, JSON_COMPACT_OUTPUT, "boolean", compact, compact);
+        config.addItem(JSON_PACKED_OUTPUT, JSON_PACKED_OUTPUT, "boolean", packed, packed);
+        Serializer serializer{false, 0};
+        Pivot2OpcuaFilter filter("bench", config, &serializer, &serializeOutput);
+
+        double bestMs[2] = {-1, -1};
+        uint64_t allocs[2] = {0, 0};
+        for (const bool serialize : {false, true}) {
+            serializer.enabled = serialize;
+            for (unsigned repeat = 0 ; repeat < 3 ; repeat++) {
+                serializer.bytes = 0;
+                allocs[serialize] = 0;
+                double ms(0);
+                for (size_t i = 0 ; i < nbObjects ; i += batchSize) {
+                    std::vector<Reading*> readings;
+                    for (size_t k = i ; k < i + batchSize ; k++) {
+                        // Synthetic datapoints 3k+2 are measurements ("MvTyp")
+                        readings.push_back(pivotMvReading(bench::syntheticPivotId((k * 3 + 2) % nbEntries),
+                                static_cast<int64_t>(k)));
+                    }
+                    ReadingSet batch(&readings);
+                    const uint64_t before(bench::allocationCount());
+                    ms += bench::bestOfMs(1, [&batch, &filter]() {
+                        filter.ingest(&batch);
+                    });
+                    allocs[serialize] += bench::allocationCount() - before;
+                }
+                if (bestMs[serialize] < 0 || ms < bestMs[serialize]) bestMs[serialize] = ms;
+            }
+        }
+        const double nb(static_cast<double>(nbObjects));
+        printf("  %8zu objects, %-7s: %6.0f ns/object, %5.1f allocations/object; serialized: %6.0f ns/object, "
+                "%4zu bytes/object\n", nbObjects, layouts[layout], bestMs[0] * 1e6 / nb,
+                static_cast<double>(allocs[0]) / nb, bestMs[1] * 1e6 / nb, serializer.bytes / nbObjects);
+    }
+}
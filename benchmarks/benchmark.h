@@ -0,0 +1,83 @@
+#ifndef BENCHMARKS_BENCHMARK_H_
+#define BENCHMARKS_BENCHMARK_H_
+/*
+ * Fledge "pivottoopcua" filter plugin.
+ *
+ * Copyright (c) 2020 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+/**
+ * Minimal benchmark harness.
+ * Each benchmark is declared with BENCHMARK(name) { ... } and prints its own results.
+ * RunBenchmarks [filter] runs all benchmarks whose name contains 'filter'.
+ * Setting P2O_BENCH_QUICK=1 in environment reduces the sizes (smoke run).
+ */
+
+// System headers
+#include <stdint.h>
+#include <stdio.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+using BenchmarkFn_t = void (*)(void);
+
+struct Benchmark {
+    const char*     name;
+    BenchmarkFn_t   function;
+};
+
+/** @return All registered benchmarks */
+std::vector<Benchmark>& registry(void);
+
+struct Registrar {
+    Registrar(const char* name, BenchmarkFn_t function) {
+        registry().push_back(Benchmark{name, function});
+    }
+};
+
+/** @return true if a reduced run is requested */
+bool quick(void);
+
+/** @return The best (minimum) duration of 'repeat' executions of 'function', in ms */
+double bestOfMs(unsigned repeat, const std::function<void(void)>& function);
+
+/** @return The number of heap allocations (operator new) since the start of the process */
+uint64_t allocationCount(void);
+
+/**
+ * Execute 'function' in a child process (free heap memory is first released to the system).
+ * @return The increase of the peak resident set size (in kB) caused by 'function', or -1 on error
+ */
+int64_t peakRssDeltaKb(const std::function<void(void)>& function);
+
+/**
+ * @return A synthetic "exchanged_data" configuration with 'nbDatapoints' datapoints,
+ *      each having an "iec104", an "opcua" and a "hnz" protocol
+ */
+std::string syntheticExchangedData(size_t nbDatapoints);
+
+/** @return The Pivot ID of the synthetic datapoint 'index' */
+std::string syntheticPivotId(size_t index);
+
+/** @return A hierarchical Pivot ID ("S<station>/B<bay>/CB<device>/<signal>"), 3 signals per device */
+std::string syntheticHierarchicalId(size_t index);
+
+/**
+ * @return A synthetic "exchanged_data" configuration covering the first 'nbDatapoints'
+ *      hierarchical Pivot IDs, either enumerated or as 3 patterns (one per signal)
+ */
+std::string syntheticHierarchicalData(size_t nbDatapoints, bool patterns);
+
+}   // namespace bench
+
+#define BENCHMARK(name) \
+    static void bench_##name(void); \
+    static const bench::Registrar registrar_##name(#name, &bench_##name); \
+    static void bench_##name(void)
+
+#endif  //BENCHMARKS_BENCHMARK_H_
@@ -0,0 +1,144 @@
+/*
+ * Fledge "pivottoopcua" filter plugin.
+ *
+ * Copyright (c) 2020 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include "benchmark.h"
+
+// System headers
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <new>
+
+// Fledge headers
+#include "logger.h"
+
+namespace {
+std::atomic<uint64_t> s_allocCount(0);
+}   // namespace
+
+void* operator new(size_t size) {
+    s_allocCount.fetch_add(1, std::memory_order_relaxed);
+    void* ptr(malloc(size > 0 ? size : 1));
+    if (ptr == nullptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    free(ptr);
+}
+
+namespace bench {
+
+std::vector<Benchmark>&
+registry(void) {
+    static std::vector<Benchmark> benchmarks;
+    return benchmarks;
+}
+
+bool
+quick(void) {
+    const char* env(getenv("P2O_BENCH_QUICK"));
+    return env != nullptr && strcmp(env, "0") != 0;
+}
+
+double
+bestOfMs(unsigned repeat, const std::function<void(void)>& function) {
+    double best(-1.0);
+    for (unsigned i = 0 ; i < repeat ; i++) {
+        const std::chrono::steady_clock::time_point start(std::chrono::steady_clock::now());
+        function();
+        const std::chrono::duration<double, std::milli> elapsed(std::chrono::steady_clock::now() - start);
+        if (best < 0 || elapsed.count() < best) best = elapsed.count();
+    }
+    return best;
+}
+
+uint64_t
+allocationCount(void) {
+    return s_allocCount.load(std::memory_order_relaxed);
+}
+
+namespace {
+/** @return The value (in kB) of 'field' in /proc/self/status, or -1 */
+int64_t procStatusKb(const char* field) {
+    FILE* file(fopen("/proc/self/status", "r"));
+    if (file == nullptr) return -1;
+    char line[256];
+    int64_t result(-1);
+    const size_t len(strlen(field));
+    while (fgets(line, sizeof(line), file) != nullptr) {
+        if (strncmp(line, field, len) == 0 && line[len] == ':') {
+            result = atoll(line + len + 1);
+            break;
+        }
+    }
+    fclose(file);
+    return result;
+}
+
+/** Reset the peak RSS of the process (Linux >= 4.0) */
+bool resetPeakRss(void) {
+    FILE* file(fopen("/proc/self/clear_refs", "w"));
+    if (file == nullptr) return false;
+    const bool ok(fputs("5", file) >= 0);
+    return fclose(file) == 0 && ok;
+}
+}   // namespace
+
+int64_t
+peakRssDeltaKb(const std::function<void(void)>& function) {
+    int fds[2];
+    if (pipe(fds) != 0) return -1;
+    const pid_t pid(fork());
+    if (pid < 0) return -1;
+    if (pid == 0) {
+        close(fds[0]);
+        // Memory freed by the parent must not be reused without being accounted
+        malloc_trim(0);
+        int64_t delta(-1);
+        if (resetPeakRss()) {
+            const int64_t before(procStatusKb("VmRSS"));
+            function();
+            delta = procStatusKb("VmHWM") - before;
+        }
+        const ssize_t written(write(fds[1], &delta, sizeof(delta)));
+        _exit(written == sizeof(delta) ? 0 : 1);
+    }
+    close(fds[1]);
+    int64_t delta(-1);
+    if (read(fds[0], &delta, sizeof(delta)) != sizeof(delta)) delta = -1;
+    close(fds[0]);
+    int status;
+    waitpid(pid, &status, 0);
+    return delta;
+}
+
+}   // namespace bench
+
+int main(int argc, char** argv) {
+    // Benchmarks must not measure logging
+    Logger::getLogger()->setMinLevel("warning");
+    const char* filter(argc > 1 ? argv[1] : "");
+    for (const bench::Benchmark& benchmark : bench::registry()) {
+        if (strstr(benchmark.name, filter) == nullptr) continue;
+        printf("=== %s\n", benchmark.name);
+        fflush(stdout);
+        benchmark.function();
+        fflush(stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,83 @@
+/*
+ * Fledge "pivottoopcua" filter plugin.
+ *
+ * Copyright (c) 2020 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include "benchmark.h"
+
+// System headers
+#include <stdio.h>
+
+namespace bench {
+
+namespace {
+const char* const PivotTypes[] = {"SpsTyp", "DpsTyp", "MvTyp"};
+const char* const OpcuaTypes[] = {"opcua_sps", "opcua_dps", "opcua_mvf"};
+const char* const Signals[] = {"Alarm", "Pos", "I"};
+
+const char* const Header = "{\"exchanged_data\":{\"name\":\"bench\",\"version\":\"1.0\",\"datapoints\":[";
+const char* const Footer = "]}}";
+
+/** Append the datapoint 'index', of the given kind (index in PivotTypes) */
+void
+appendDatapoint(std::string* result, size_t index, const std::string& pivotId, size_t kind) {
+    char buffer[512];
+    snprintf(buffer, sizeof(buffer),
+            "%s{\"label\":\"label%zu\",\"pivot_id\":\"%s\",\"pivot_type\":\"%s\",\"protocols\":["
+            "{\"name\":\"iec104\",\"address\":\"%zu-%zu\",\"typeid\":\"M_SP_TB_1\"},"
+            "{\"name\":\"opcua\",\"address\":\"ns=1;s=/station%zu/bay%zu/item%zu\",\"typeid\":\"%s\"},"
+            "{\"name\":\"hnz\",\"address\":\"%zu\",\"typeid\":\"TS\"}]}",
+            index > 0 ? "," : "", index, pivotId.c_str(), PivotTypes[kind],
+            index / 1000, index % 1000, index / 10000, (index / 100) % 100, index % 100, OpcuaTypes[kind], index);
+    *result += buffer;
+}
+}   // namespace
+
+std::string
+syntheticPivotId(size_t index) {
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "ID_%08zu", index);
+    return buffer;
+}
+
+std::string
+syntheticExchangedData(size_t nbDatapoints) {
+    std::string result;
+    result.reserve(nbDatapoints * 320 + 128);
+    result += Header;
+    for (size_t i = 0 ; i < nbDatapoints ; i++) {
+        appendDatapoint(&result, i, syntheticPivotId(i), i % 3);
+    }
+    result += Footer;
+    return result;
+}
+
+std::string
+syntheticHierarchicalId(size_t index) {
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "S%zu/B%zu/CB%zu/%s", index / 300, (index / 30) % 10, (index / 3) % 10,
+            Signals[index % 3]);
+    return buffer;
+}
+
+std::string
+syntheticHierarchicalData(size_t nbDatapoints, bool patterns) {
+    std::string result(Header);
+    if (patterns) {
+        for (size_t kind = 0 ; kind < 3 ; kind++) {
+            appendDatapoint(&result, kind, std::string("S*/B*/CB*/") + Signals[kind], kind);
+        }
+    } else {
+        result.reserve(nbDatapoints * 320 + 128);
+        for (size_t i = 0 ; i < nbDatapoints ; i++) {
+            appendDatapoint(&result, i, syntheticHierarchicalId(i), i % 3);
+        }
+    }
+    result += Footer;
+    return result;
+}
+
+}   // namespace bench
@@ -0,0 +1,76 @@
+#ifndef INCLUDE_PIVOT2OPCUA_ASYNC_H_
+#define INCLUDE_PIVOT2OPCUA_ASYNC_H_
+/*
+ * Fledge "pivottoopcua" filter plugin.
+ *
+ * Copyright (c) 2020 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+// System headers
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Project headers
+#include "pivot2opcua_queue.h"
+#include "pivot2opcua_stats.h"
+
+/**************************************************************************/
+/**
+ * Conversion of reading sets on a dedicated thread: the upstream thread only
+ * pushes them in a bounded lock-free queue.
+ * When the queue is full, the upstream thread either waits for some room
+ * (backpressure), or drops the oldest queued set.
+ */
+class AsyncIngest {
+ public:
+    enum class FullPolicy {Block, DropOldest};
+
+    /** @param readingSet The set to convert and pass on, owned by the callee */
+    using Process_t = std::function<void(ReadingSet* readingSet)>;
+
+    /**
+     * Starts the thread
+     * @param depth The maximum number of queued sets
+     * @param statistics Receives the queue metrics
+     */
+    AsyncIngest(size_t depth, FullPolicy policy, Process_t process, FilterStatistics* statistics);
+    /** Processes the queued sets, then stops the thread */
+    ~AsyncIngest(void);
+    AsyncIngest(const AsyncIngest&) = delete;
+    AsyncIngest& operator=(const AsyncIngest&) = delete;
+
+    /** @param readingSet The set to process, owned by the queue */
+    void push(ReadingSet* readingSet);
+
+    size_t depth(void)const {return m_queue.capacity();}
+    void setPolicy(FullPolicy policy) {m_policy = policy;}
+
+    /** @return The policy named 'name' ("block" or "drop_oldest"), Block if unknown */
+    static FullPolicy policyOf(const std::string& name);
+
+ private:
+    void run(void);
+
+    ReadingQueue                m_queue;
+    std::atomic<FullPolicy>     m_policy;
+    const Process_t             m_process;
+    FilterStatistics* const     m_statistics;
+    // Only used to sleep: when the queue is empty (consumer) or full (producers)
+    std::mutex                  m_mutex;
+    std::condition_variable     m_notEmpty;
+    std::condition_variable     m_notFull;
+    std::atomic<bool>           m_consumerIdle{false};
+    std::atomic<unsigned>       m_producersBlocked{0};
+    std::atomic<bool>           m_stop{false};
+    std::thread                 m_thread;
+};
+
+#endif  //INCLUDE_PIVOT2OPCUA_ASYNC_H_
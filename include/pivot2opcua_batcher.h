@@ -0,0 +1,79 @@
+#ifndef INCLUDE_PIVOT2OPCUA_BATCHER_H_
+#define INCLUDE_PIVOT2OPCUA_BATCHER_H_
+/*
+ * Fledge "pivottoopcua" filter plugin.
+ *
+ * Copyright (c) 2020 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+// System headers
+#include <stdint.h>
+#include <stddef.h>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Fledge includes
+#include "reading_set.h"
+
+/**************************************************************************/
+/**
+ * Aggregation of small reading sets before passing them on, to save the fixed
+ * cost of each call to the next filter.
+ * Readings are held until 'maxReadings' are pending or the oldest one has been
+ * held for 'maxDelayUs', whichever comes first. The delay is enforced by a
+ * background thread (only started on first use), even when no more sets come.
+ * Sets are passed on in order, and never concurrently.
+ */
+class ReadingBatcher {
+ public:
+    /**
+     * @param readingSet The merged set, owned by the callee
+     * @param timeout true if passed on because of the delay, false if full (or flushed)
+     */
+    using Output_t = std::function<void(ReadingSet* readingSet, bool timeout)>;
+
+    explicit ReadingBatcher(Output_t output);
+    /** Passes on the pending readings and stops the thread */
+    ~ReadingBatcher(void);
+    ReadingBatcher(const ReadingBatcher&) = delete;
+    ReadingBatcher& operator=(const ReadingBatcher&) = delete;
+
+    /**
+     * Change the limits. The pending readings are passed on first.
+     * @param maxReadings 0 or 1 disables the aggregation
+     */
+    void configure(size_t maxReadings, int64_t maxDelayUs);
+
+    /** @param readingSet The set to pass on, owned by the batcher (deleted once merged) */
+    void push(ReadingSet* readingSet);
+
+    /** Pass on 'readingSet' now, before the pending readings (priority lane) */
+    void bypass(ReadingSet* readingSet);
+
+    /** Pass on the pending readings now */
+    void flush(void);
+
+ private:
+    using Clock_t = std::chrono::steady_clock;
+
+    void run(void);
+    /** Called holding m_mutex */
+    void forward(bool timeout);
+
+    const Output_t          m_output;
+    std::mutex              m_mutex;
+    std::condition_variable m_cond;
+    size_t                  m_maxReadings = 0;
+    int64_t                 m_maxDelayUs = 0;
+    ReadingSet*             m_pending = nullptr;    /// First set received, others are merged in it
+    Clock_t::time_point     m_deadline;             /// When m_pending must be passed on
+    bool                    m_stop = false;
+    std::thread             m_thread;
+};
+
+#endif  //INCLUDE_PIVOT2OPCUA_BATCHER_H_
@@ -0,0 +1,48 @@
+#ifndef INCLUDE_PIVOT2OPCUA_BLOOM_H_
+#define INCLUDE_PIVOT2OPCUA_BLOOM_H_
+/*
+ * Fledge "pivottoopcua" filter plugin.
+ *
+ * Copyright (c) 2020 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+// System headers
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+/**************************************************************************/
+/**
+ * Blocked Bloom filter of strings: all the bits of a key are in the same
+ * cache line, so that a check costs a single memory access.
+ * About 1% false positives with the default sizing, no false negatives.
+ */
+class BloomFilter {
+ public:
+    /** @param nbKeys Expected number of keys (0 = empty filter, that contains nothing) */
+    explicit BloomFilter(size_t nbKeys = 0);
+
+    void add(const std::string& key);
+    /** @return false if 'key' was never added. True if it was probably added */
+    bool mayContain(const std::string& key)const;
+
+    /** @return the size of the filter, in bytes */
+    size_t bytes(void)const {return m_blocks.size() * sizeof(Block);}
+
+    /** @return A 64-bit hash of 'key', with all bits depending on all bytes */
+    static uint64_t hash(const std::string& key);
+
+ private:
+    static const size_t BitsPerKey = 10;
+    static const unsigned NbHashes = 7;
+    struct Block {
+        uint64_t words[8];
+    };
+
+    std::vector<Block>  m_blocks;
+};
+
+#endif  //INCLUDE_PIVOT2OPCUA_BLOOM_H_
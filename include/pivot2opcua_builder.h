@@ -0,0 +1,57 @@
+#ifndef INCLUDE_PIVOT2OPCUA_BUILDER_H_
+#define INCLUDE_PIVOT2OPCUA_BUILDER_H_
+/*
+ * Fledge "pivottoopcua" filter plugin.
+ *
+ * Copyright (c) 2020 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+// System headers
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+/**************************************************************************/
+/**
+ * Background thread rebuilding the dictionnary on reconfiguration.
+ * Only the latest request matters: submitting a job cancels the running one
+ * and replaces any job not started yet.
+ * The thread is only started on first use.
+ */
+class DictionaryBuilder {
+ public:
+    /**
+     * @param cancelled Set when the job becomes obsolete. The job should then
+     *      return as soon as possible.
+     */
+    using Job_t = std::function<void(const std::atomic<bool>& cancelled)>;
+
+    DictionaryBuilder(void) = default;
+    /** Cancels the running job and waits for its end */
+    ~DictionaryBuilder(void);
+    DictionaryBuilder(const DictionaryBuilder&) = delete;
+    DictionaryBuilder& operator=(const DictionaryBuilder&) = delete;
+
+    /** Schedule 'job' */
+    void submit(Job_t job);
+
+    /** Wait until no job is running or pending */
+    void waitIdle(void);
+
+ private:
+    void run(void);
+
+    std::mutex              m_mutex;
+    std::condition_variable m_cond;
+    Job_t                   m_pending;
+    bool                    m_running = false;
+    bool                    m_stop = false;
+    std::atomic<bool>       m_cancel{false};
+    std::thread             m_thread;
+};
+
+#endif  //INCLUDE_PIVOT2OPCUA_BUILDER_H_
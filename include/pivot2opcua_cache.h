@@ -0,0 +1,50 @@
+#ifndef INCLUDE_PIVOT2OPCUA_CACHE_H_
+#define INCLUDE_PIVOT2OPCUA_CACHE_H_
+/*
+ * Fledge "pivottoopcua" filter plugin.
+ *
+ * Copyright (c) 2020 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+// System headers
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+#include <memory>
+
+// Project headers
+#include "pivot2opcua_data.h"
+
+using DataDictionnary_SharedPtr = std::shared_ptr<const DataDictionnary>;
+
+/**************************************************************************/
+/**
+ * Process-wide cache of immutable dictionnaries, so that filter instances
+ * configured with the same "exchanged_data" share a single index.
+ * Dictionnaries are identified by the hash and size of their configuration.
+ * The cache only holds weak references: a dictionnary is freed when no
+ * instance uses it anymore.
+ * All methods are thread-safe. When several threads request the same missing
+ * dictionnary, only one builds it while the others wait for the result.
+ */
+class DictionaryCache {
+ public:
+    using Builder_t = std::function<DataDictionnary_Ptr(void)>;
+
+    /**
+     * @param configHash The hash of the configuration
+     * @param configSize The size of the configuration
+     * @param builder Called (without lock) if the dictionnary is not in use by any instance
+     * @return The shared dictionnary
+     * @throw std::exception If 'builder' throws (for all waiting callers, except
+     *      DataDictionnary::BuildCancelled: waiting callers then build the dictionnary)
+     */
+    static DataDictionnary_SharedPtr get(uint64_t configHash, size_t configSize, const Builder_t& builder);
+
+    /** @return the number of dictionnaries currently in use */
+    static size_t size(void);
+};
+
+#endif  //INCLUDE_PIVOT2OPCUA_CACHE_H_
@@ -0,0 +1,131 @@
+#ifndef INCLUDE_PIVOT2OPCUA_CAPTURE_H_
+#define INCLUDE_PIVOT2OPCUA_CAPTURE_H_
+/*
+ * Fledge "pivottoopcua" filter plugin.
+ *
+ * Copyright (c) 2020 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+// System headers
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <functional>
+
+// Fledge headers
+#include "reading_set.h"
+
+/**************************************************************************/
+/**
+ * Capture of incoming ReadingSets into a size-bounded memory-mapped ring file.
+ *
+ * File layout (host byte order):
+ * - CaptureHeader
+ * - Index ring: `indexCapacity` CaptureIndexEntry (one per captured batch)
+ * - Data ring: `dataCapacity` bytes. Each batch is stored contiguously at
+ *      (offset % dataCapacity). A batch that would cross the end of the ring
+ *      is written at its beginning instead.
+ *
+ * A batch is a sequence of readings, each encoded as:
+ *      asset (string), timestamp (varint, us), user timestamp (varint, us),
+ *      datapoints count (varint), datapoints
+ * And each datapoint as:
+ *      name (string), type (1 byte, DatapointValue::dataTagType), value:
+ *      - T_STRING: string
+ *      - T_INTEGER: zigzag varint
+ *      - T_FLOAT: 8 bytes IEEE754
+ *      - T_FLOAT_ARRAY: count (varint), values (8 bytes each)
+ *      - T_DP_DICT/T_DP_LIST: count (varint), datapoints
+ *      - Other types are not captured (no value)
+ * Strings are encoded as length (varint) + bytes.
+ *
+ * Writing is append-only: a batch is first sized, then serialized directly into
+ * the mapped memory, so that no allocation is done per reading.
+ */
+class ReadingCapture {
+ public:
+    static const uint32_t Version = 1;
+
+    struct CaptureHeader {
+        char        magic[8];
+        uint32_t    version;
+        uint32_t    indexCapacity;
+        uint64_t    dataCapacity;
+        uint64_t    nextSeq;        /// Sequence number of the next batch
+        uint64_t    writeOffset;    /// Logical (never wrapped) end of data
+    };
+
+    struct CaptureIndexEntry {
+        uint64_t    seq;
+        uint64_t    offset;         /// Logical offset of the batch in data ring
+        uint32_t    length;
+        uint32_t    nbReadings;
+        int64_t     captureTimeUs;
+    };
+
+    ReadingCapture(void) = default;
+    ~ReadingCapture(void);
+    ReadingCapture(const ReadingCapture&) = delete;
+    ReadingCapture& operator=(const ReadingCapture&) = delete;
+
+    /**
+     * Open (or create) a capture file. An existing capture with the same geometry
+     * is appended, a capture of another size is reset. Any other non-empty file is
+     * left untouched and the capture is not opened.
+     * @param path The file path. Relative paths are located in Fledge data folder.
+     * @param sizeBytes The total size of the file
+     * @return true if the capture is active
+     */
+    bool open(const std::string& path, uint64_t sizeBytes);
+    void close(void);
+    bool isOpen(void)const {return m_header != nullptr;}
+    const std::string& path(void)const {return m_path;}
+
+    /**
+     * Append a batch of readings to the capture.
+     * @return false if the batch could not be captured (too large for the ring)
+     */
+    bool capture(ReadingSet* readingSet, int64_t captureTimeUs);
+
+    uint64_t batches(void)const {return m_batches;}
+    uint64_t dropped(void)const {return m_dropped;}
+    uint64_t bytes(void)const {return m_bytes;}
+
+    /**
+     * Callback for captured batches, in capture order.
+     * @param data The encoded batch, @see decodeBatch
+     */
+    using BatchHandler_t = std::function<void(const CaptureIndexEntry& entry, const uint8_t* data)>;
+
+    /**
+     * Read all valid batches of a capture file.
+     * @return false if the file is not a valid capture
+     */
+    static bool readFile(const std::string& path, const BatchHandler_t& handler);
+
+    /**
+     * Decode a batch into new readings (owned by caller), with timestamps restored.
+     * @throw std::exception If the batch is corrupted
+     */
+    static std::vector<Reading*> decodeBatch(const uint8_t* data, size_t length, uint32_t nbReadings);
+
+    /** @return the path, located in Fledge data folder if relative */
+    static std::string resolvePath(const std::string& path);
+
+ private:
+    std::string         m_path;
+    int                 m_fd = -1;
+    uint8_t*            m_map = nullptr;
+    size_t              m_mapSize = 0;
+    CaptureHeader*      m_header = nullptr;
+    CaptureIndexEntry*  m_index = nullptr;
+    uint8_t*            m_data = nullptr;
+    uint64_t            m_batches = 0;
+    uint64_t            m_dropped = 0;
+    uint64_t            m_bytes = 0;
+};
+
+#endif  //INCLUDE_PIVOT2OPCUA_CAPTURE_H_
@@ -0,0 +1,97 @@
+#ifndef INCLUDE_PIVOT2OPCUA_COMMANDS_H_
+#define INCLUDE_PIVOT2OPCUA_COMMANDS_H_
+/*
+ * Fledge "pivottoopcua" filter plugin.
+ *
+ * Copyright (c) 2020 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+// System headers
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+// Project headers
+#include "pivot2opcua_histogram.h"
+
+/**************************************************************************/
+/**
+ * Tracks commands ("opcua_operation" converted to PIVOTTC) until the matching
+ * GTIC reply is received, in order to measure the command round-trip time.
+ *
+ * Pending commands are stored in a fixed-size pool (no allocation besides the
+ * index node), and chained into a timing wheel of `WheelSlots` slots, indexed
+ * by their expiry time. Expiring commands only visits the slots which elapsed
+ * since the previous call, whatever the number of pending commands.
+ * This class is not thread-safe.
+ */
+class CommandTracker {
+ public:
+    static const size_t WheelSlots = 64;
+
+    CommandTracker(void);
+
+    /**
+     * Clear all pending commands and apply a new setup.
+     * @param maxPending Maximum number of simultaneously pending commands
+     * @param timeoutUs Delay after which a command without reply is
+     *      considered as timed-out. 0 disables the tracking.
+     */
+    void configure(size_t maxPending, int64_t timeoutUs);
+
+    /** A command with identifier `id` has been sent */
+    void addCommand(const std::string& id, int64_t nowUs);
+    /** A reply for command `id` has been received */
+    void addReply(const std::string& id, bool ack, int64_t nowUs);
+    /** Account all commands whose timeout has elapsed */
+    void expire(int64_t nowUs);
+
+    size_t pending(void)const {return m_index.size();}
+    uint64_t timeouts(void)const {return m_timeouts;}
+    uint64_t acks(void)const {return m_acks;}
+    uint64_t nacks(void)const {return m_nacks;}
+
+    /** Write the round-trip statistics as a JSON object */
+    void toJson(JsonWriter_t* writer)const;
+
+ private:
+    using Index_t = int32_t;
+    static const Index_t NoEntry = -1;
+
+    struct Entry {
+        std::string id;
+        int64_t     sentUs;
+        int64_t     deadlineUs;
+        Index_t     prev;
+        Index_t     next;
+    };
+
+    int64_t tickOf(int64_t us)const {return us / m_tickUs;}
+    size_t slotOf(int64_t us)const {return static_cast<size_t>(tickOf(us) % WheelSlots);}
+    void link(Index_t idx);
+    void unlink(Index_t idx);
+    void release(Index_t idx);
+    void expireSlot(size_t slot, int64_t nowUs);
+
+    int64_t                 m_timeoutUs;
+    int64_t                 m_tickUs;
+    int64_t                 m_lastTick;     /// Last fully expired tick
+    std::vector<Entry>      m_entries;      /// Pool of pending commands
+    std::vector<Index_t>    m_slots;        /// Heads of the wheel lists
+    Index_t                 m_free;         /// Head of free entries list
+    std::unordered_map<std::string, Index_t> m_index;
+
+    uint64_t                m_commands;
+    uint64_t                m_untracked;    /// Commands ignored because pool was full
+    uint64_t                m_acks;
+    uint64_t                m_nacks;
+    uint64_t                m_timeouts;
+    uint64_t                m_unmatched;    /// Replies without pending command
+    LatencyHistogram        m_ackLatency;
+    LatencyHistogram        m_nackLatency;
+};
+
+#endif  //INCLUDE_PIVOT2OPCUA_COMMANDS_H_
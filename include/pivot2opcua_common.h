@@ -42,6 +42,29 @@ static constexpr const char*const JSON_PROT_TYPEID = "typeid";
 
 static constexpr const char*const JSON_PROT_MAPPING = "mapping_rule";
 
+// Filter configuration items
+static constexpr const char*const JSON_LATENCY_STAMP = "latency_stamp";
+static constexpr const char*const JSON_STATS_PERIOD = "stats_period";
+static constexpr const char*const JSON_CMD_TIMEOUT = "command_timeout";
+static constexpr const char*const JSON_CMD_MAX_PENDING = "command_max_pending";
+static constexpr const char*const JSON_CAPTURE_FILE = "capture_file";
+static constexpr const char*const JSON_CAPTURE_SIZE = "capture_size";
+static constexpr const char*const JSON_DICT_THREADS = "dictionary_threads";
+static constexpr const char*const JSON_DICT_SNAPSHOT = "dictionary_snapshot";
+static constexpr const char*const JSON_CHUNK_SIZE = "chunk_size";
+static constexpr const char*const JSON_BATCH_SIZE = "batch_size";
+static constexpr const char*const JSON_BATCH_DELAY = "batch_delay_us";
+static constexpr const char*const JSON_ASYNC_QUEUE = "async_queue";
+static constexpr const char*const JSON_ASYNC_POLICY = "async_full_policy";
+static constexpr const char*const JSON_ASSET_ROUTING = "asset_routing";
+static constexpr const char*const JSON_COMPACT_OUTPUT = "compact_output";
+static constexpr const char*const JSON_PACKED_OUTPUT = "packed_output";
+static constexpr const int64_t DEFAULT_CMD_TIMEOUT_S = 30;
+static constexpr const int64_t DEFAULT_CMD_MAX_PENDING = 1000;
+static constexpr const int64_t DEFAULT_CAPTURE_SIZE_MB = 64;
+static constexpr const int64_t DEFAULT_DICT_THREADS = 0;
+static constexpr const int64_t DEFAULT_BATCH_DELAY_US = 5000;
+
 static constexpr const char*const EXCH_DATA_VERSION = "1.0";
 static constexpr const char*const PROTO_TRANSLATION_VERSION = "1.0";
 
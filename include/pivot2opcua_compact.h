@@ -0,0 +1,47 @@
+#ifndef INCLUDE_PIVOT2OPCUA_COMPACT_H_
+#define INCLUDE_PIVOT2OPCUA_COMPACT_H_
+/*
+ * Fledge "pivottoopcua" filter plugin.
+ *
+ * Copyright (c) 2020 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+// System headers
+#include <stdint.h>
+#include <string>
+
+/**************************************************************************/
+/**
+ * Codes of the compact "data_object" layout (setting "compact_output").
+ * Compact objects start with "do_layout" (= Version). Enum-like fields are
+ * integers: their code is the rank of the value in the tables below. Values
+ * without a code are kept as strings.
+ * The fields whose code is 0 for Validity, Source and TmOrg are omitted
+ * ("do_value_quality", "do_ts_validity", "do_source", "do_ts_org"), as well as
+ * "do_confirmation", "do_quality" and "do_ts_quality" when 0.
+ * Codes are only ever appended: a new value never changes existing codes,
+ * any other change increments Version.
+ */
+class CompactLayout {
+ public:
+    static const int64_t Version = 1;
+
+    enum class Field {
+        ComingFrom,     /// "do_comingfrom": iec104, iec61850, opcua
+        OpcType,        /// "do_type": opcua_sps, opcua_dps, opcua_mvi, opcua_mvf, opcua_spc, opcua_dpc,
+                        ///     opcua_inc, opcua_apc, opcua_bsc
+        Validity,       /// "do_value_quality" and "do_ts_validity": good, invalid, reserved, questionable
+        Source,         /// "do_source": process, substituted
+        TmOrg           /// "do_ts_org": genuine, substituted
+    };
+
+    /** @return The code of 'value' for 'field', or -1 if it has none */
+    static int64_t encode(Field field, const std::string& value);
+
+    /** @return The value of 'code' for 'field', or nullptr if unknown */
+    static const char* decode(Field field, int64_t code);
+};
+
+#endif  //INCLUDE_PIVOT2OPCUA_COMPACT_H_
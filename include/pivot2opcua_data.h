@@ -11,58 +11,50 @@
  */
 
 // System headers
+#include <stdint.h>
+#include <atomic>
+#include <exception>
 #include <string>
 #include <unordered_map>
 #include <memory>
+#include <utility>
+#include <vector>
 
 // Fledge includes
 #include "config_category.h"
 #include "logger.h"
 
-/**************************************************************************/
+// Project headers
+#include "pivot2opcua_bloom.h"
+#include "pivot2opcua_trie.h"
+
 /**
- * This class parses the configuration of a single OPC UA variable (as Datapoint)
+ * An OPC UA variable a Pivot data is published to
  */
-class ExchangedDataC {
- public:
-    class NotAnS2opcInstance : public std::exception{};
-    /** Expected format:
-      {
-          "name":"s2opcua",
-          "address":"<nodeid>",
-          "typeid":"<opcua_sps|...>",
-       }
-     */
-    explicit ExchangedDataC(const rapidjson::Value& json);
-    virtual ~ExchangedDataC(void) = default;
-
- private:
-    const bool mPreCheck;
-    /**
-     * @return true if all checks are OK:
-     * - json is an object
-     * - contains keys "name", "address" and "typeid" with string values
-     * Throws exception() otherwise.
-     * NotAnS2opcInstance is thrown if json["name"] is not opcua
-     */
-    bool internalChecks(const rapidjson::Value& json)const;
-
- public:
-    const std::string address;
-    const std::string typeId;
-};  // class ExchangedDataC
+struct OpcuaMapping {
+    std::string m_opcType;
+    std::string m_address;
+};
 
+using OpcuaMappings_t = std::vector<OpcuaMapping>;
 
 /**
  * This structure contains all required information for a given Pivot data
  */
 struct PivotElement {  // //NOSONAR  No performance issue,: executed once at startup
-    explicit PivotElement(const std::string& pivot_type,
-            const std::string& opcType):
-        m_pivot_type(pivot_type),
-        m_opcType(opcType) {}
+    explicit PivotElement(std::string pivot_type,
+            std::string opcType, std::string address = std::string(), OpcuaMappings_t mappings = OpcuaMappings_t()):
+        m_pivot_type(std::move(pivot_type)),
+        m_opcType(std::move(opcType)),
+        m_address(std::move(address)),
+        m_mappings(std::move(mappings)) {}
     const std::string m_pivot_type;
-    const std::string m_opcType;
+    const std::string m_opcType;            /// Type of the first (usually only) "opcua" protocol
+    const std::string m_address;            /// Address of the first (usually only) "opcua" protocol
+    /** All "opcua" protocols, in document order. Only filled when there are several of them */
+    const OpcuaMappings_t m_mappings;
+    uint32_t m_index = 0;   /// Rank in the dictionnary, set once it is complete
+    bool m_isPattern = false;   /// The pivot id is a pattern, set once the dictionnary is complete
 };
 
 using PivotElementMap_t = std::unordered_map<std::string, PivotElement>;
@@ -73,13 +65,42 @@ using PivotElementMap_t = std::unordered_map<std::string, PivotElement>;
  */
 class DataDictionnary {
  public:
+    /** Thrown when a build is cancelled */
+    class BuildCancelled : public std::exception {};
+
     /**
      * @param jsonExData the full "exchanged_data" configuration category
+     * @param nbThreads Number of threads parsing the "datapoints" array (0 = one per CPU).
+     *      Small configurations are always parsed by the calling thread.
+     * @param cancel If provided and set during the build, BuildCancelled is thrown
+     * Duplicate pivot ids are reported, only the first one (in document order) is kept.
+     * A datapoint with several "opcua" protocols is kept as one element with several mappings.
+     */
+    explicit DataDictionnary(const std::string& jsonExData, unsigned nbThreads = 1,
+            const std::atomic<bool>* cancel = nullptr);
+    /**
+     * @param map Already built (and checked) entries
+     * @param duplicates The number of duplicates found when 'map' was built
      */
-    explicit DataDictionnary(const std::string& jsonExData);
+    DataDictionnary(PivotElementMap_t&& map, size_t duplicates);
+
+    DataDictionnary(const DataDictionnary&) = delete;
+    DataDictionnary& operator=(const DataDictionnary&) = delete;
 
     /**
-     * @param key the Pivot Id to search in the dictionnary
+     * @param pivotId the Pivot Id to search in the dictionnary
+     * @return The element with this exact id if any, otherwise the element of the best
+     *      matching pattern (@see PivotIdTrie), or nullptr if none.
+     *      An id containing a wildcard is not a signal: it matches nothing, not even its own pattern.
+     */
+    const PivotElement* lookup(const std::string& pivotId)const;
+    /**
+     * Fast pre-check, cheaper than ::lookup for unknown ids
+     * @return false if ::lookup(pivotId) fails. True if it probably succeeds.
+     */
+    bool mayContain(const std::string& pivotId)const;
+    /**
+     * @param key the Pivot Id to search in the dictionnary (exact match only, patterns included)
      * @return a const_iterator to the element (::isEmpty can be used to check result)
      */
     PivotElementMap_t::const_iterator find(const std::string& key)const;
@@ -89,8 +110,24 @@ class DataDictionnary {
      */
     bool isEmpty(const PivotElementMap_t::const_iterator& it)const;
 
+    /** @return the number of entries, patterns included */
+    size_t size(void)const {return m_map.size();}
+    /** @return the number of patterns (pivot ids with wildcards) */
+    size_t patterns(void)const {return m_patterns.size();}
+    PivotElementMap_t::const_iterator begin(void)const {return m_map.begin();}
+    PivotElementMap_t::const_iterator end(void)const {return m_map.end();}
+    /** @return the number of ignored duplicate pivot ids */
+    size_t duplicates(void)const {return m_duplicates;}
+
  private:
+    void parse(const std::string& jsonExData, const std::atomic<bool>* cancel);
+    void parseParallel(const std::string& jsonExData, unsigned nbThreads, const std::atomic<bool>* cancel);
+    void buildIndexes(void);
+
     PivotElementMap_t m_map;
+    size_t m_duplicates = 0;
+    PivotIdTrie m_patterns;     /// Patterns are also in m_map (tagged), which owns their elements
+    BloomFilter m_known;        /// Exact ids of m_map
 };
 
 using DataDictionnary_Ptr = std::unique_ptr<DataDictionnary>;
@@ -100,6 +137,20 @@ DataDictionnary::isEmpty(const PivotElementMap_t::const_iterator& it)const {
     return it == m_map.end();
 }
 
+inline const PivotElement*
+DataDictionnary::lookup(const std::string& pivotId)const {
+    const PivotElementMap_t::const_iterator it(m_map.find(pivotId));
+    if (it != m_map.end()) return it->second.m_isPattern ? nullptr : &it->second;
+    if (m_patterns.size() == 0 || PivotIdTrie::isPattern(pivotId)) return nullptr;
+    return m_patterns.match(pivotId);
+}
+
+inline bool
+DataDictionnary::mayContain(const std::string& pivotId)const {
+    if (m_known.mayContain(pivotId)) return true;
+    return m_patterns.size() > 0 && m_patterns.match(pivotId) != nullptr;
+}
+
 inline PivotElementMap_t::const_iterator
 DataDictionnary::find(const std::string& key)const {
     return m_map.find(key);
@@ -18,6 +18,7 @@
 #include <regex>
 #include <memory>
 #include <vector>
+#include <atomic>
 #include <exception>
 
 // Fledge includes
@@ -29,6 +30,15 @@
 // Project headers
 #include "pivot2opcua_common.h"
 #include "pivot2opcua_data.h"
+#include "pivot2opcua_stats.h"
+#include "pivot2opcua_cache.h"
+#include "pivot2opcua_builder.h"
+#include "pivot2opcua_capture.h"
+#include "pivot2opcua_batcher.h"
+#include "pivot2opcua_async.h"
+#include "pivot2opcua_usage.h"
+#include "pivot2opcua_router.h"
+#include "pivot2opcua_handles.h"
 
 using std::string;
 using std::vector;
@@ -55,11 +65,22 @@ class Pivot2OpcuaFilter : public FledgeFilter {
     virtual ~Pivot2OpcuaFilter(void) = default;
     void ingest(READINGSET *readingSet);
     void reconfigure(const string& newConfig);
+    /** @return The statistics collected by the filter, as a JSON object */
+    std::string getStatistics(void);
+    /** Wait until the dictionnary of the latest configuration is built (or failed) */
+    void waitConfigured(void) {m_builder.waitIdle();}
 
  private:
     using Readings = vector<Reading*>;
     using Datapoints = vector<Datapoint*>;
 
+    /** Encoding of converted measurements */
+    enum class OutputLayout {
+        Default,    /// "data_object"
+        Compact,    /// "data_object", compact (@see CompactLayout)
+        Packed      /// "do_packed" (@see PackedRecord)
+    };
+
     class PivotQuality {
      public:
         explicit PivotQuality(const Datapoints* dict);
@@ -98,6 +119,10 @@ class Pivot2OpcuaFilter : public FledgeFilter {
         explicit PivotTimestamp(const Datapoints* dict);
         uint32_t toDetails(void)const;
         inline int64_t nbSec(void)const {return time_nbSec;}
+        /** @return The timestamp as micro-seconds since Epoch (FractionOfSecond is a 24-bit fraction) */
+        inline int64_t toMicroSeconds(void)const {
+            return time_nbSec * 1000000 + ((time_frac * 1000000) >> 24);
+        }
 
      private:
         static const uint32_t Mask_clockFailure      = 0x0001u;
@@ -165,10 +190,31 @@ class Pivot2OpcuaFilter : public FledgeFilter {
     /** Common behavior for PIVOT measurements*/
     class CommonMeasurePivot {
      public:
-        explicit CommonMeasurePivot(const Datapoints* dict);
+        /**
+         * @param dictionnary If provided, the "Identifier" is searched in it before
+         *      decoding other fields: the decoding stops if it is absent (@see isUnknown),
+         *      and value sub-sections not matching its OPC UA type are skipped.
+         *      ::createDataObjects must then be called with the same dictionnary.
+         */
+        explicit CommonMeasurePivot(const Datapoints* dict, const DataDictionnary* dictionnary = nullptr);
         const std::string& pivotId(void)const {return m_Identifier;}
+        /** @return true if the decoding was stopped because the pivot id is not in the dictionnary */
+        bool isUnknown(void)const {return m_unknown;}
+        /** @return The dictionnary element of the pivot id, if looked up at construction */
+        const PivotElement* element(void)const {return m_element;}
+        const std::string& comingFrom(void)const {return m_ComingFrom;}
+        /** @return The source timestamp, in micro-seconds since Epoch. Only valid after a successful conversion */
+        int64_t sourceTimeUs(void)const {return m_Qualified->ts.toMicroSeconds();}
         virtual ~CommonMeasurePivot(void) = default;
-        void updateReading(const DataDictionnary* dictPtr, Reading* orig)const;
+        /**
+         * Encode the decoded object once per OPC UA mapping of its pivot id
+         * @param handles The handles of the entries of 'dictPtr' ("do_handle")
+         * @param outputs Receives the converted objects ("data_object")
+         * @param layout The encoding of the objects
+         * @return The number of objects added to 'outputs' (0 if it cannot be converted)
+         */
+        size_t createDataObjects(const DataDictionnary* dictPtr, const SignalHandles* handles, Datapoints* outputs,
+                OutputLayout layout = OutputLayout::Default)const;
 
      private:
         using FieldDecoder = void (*) (CommonMeasurePivot*, DatapointValue&, const string& name);
@@ -201,8 +247,18 @@ class Pivot2OpcuaFilter : public FledgeFilter {
                 FieldMask_val | FieldMask_vqu;
 
         static void logMissingMandatoryFields(const std::string& pivotName, uint32_t fields);
+        /**
+         * @param mapping The rank in element.m_mappings, for pivot ids with several mappings
+         *      (its address is added as "do_address")
+         */
+        Datapoint* createDataObject(const PivotElement& element, uint32_t handle, size_t mapping,
+                OutputLayout layout)const;
+        Datapoint* createPackedObject(uint32_t handle, size_t mapping, const std::string& opcType,
+                Datapoint* dp_value)const;
 
         uint32_t        m_readFields;   // A mask to  FieldMask_XXX
+        bool            m_unknown;
+        const PivotElement* m_element;  /// Dictionnary element, when looked up at construction
         string          m_pivotType;
         bool            m_Confirmation;
         int             m_Cause;
@@ -222,7 +278,9 @@ class Pivot2OpcuaFilter : public FledgeFilter {
         explicit TelecommandReplyPivot(const Datapoints* dict);
         virtual ~TelecommandReplyPivot(void) = default;
         const std::string& pivotId(void)const {return m_Identifier;}
-        void updateReading(const DataDictionnary* dictPtr, Reading* orig)const;
+        bool isAck(void)const {return m_ConfStVal == 0;}
+        /** @return The converted reply ("opcua_reply"), or nullptr if incomplete */
+        Datapoint* createReply(void)const;
 
      private:
         void initLoop(const string& name, DatapointValue* dpv);
@@ -236,11 +294,70 @@ class Pivot2OpcuaFilter : public FledgeFilter {
     static Datapoints* findDictElement(const Datapoints* dict, const string& key);
     static string getStringStVal(const Datapoints* dict, const string& context);
     static int64_t getIntStVal(const Datapoints* dict, const string& context);
-    void pivot2opcua(Reading* readDp)const;
-    void opcua2pivot(Reading* readDp)const;
+    /**
+     * What conversions use. The conversion lane reads m_conversion holding the configMutex,
+     * the command lane of the asynchronous mode a copy taken holding the inputMutex: both
+     * mutexes are held to change it.
+     */
+    struct Conversion {
+        DataDictionnary_SharedPtr           dictionnary;
+        SignalHandles_SharedPtr             handles;        /// Handles of the entries of dictionnary
+        DictionaryUsage_SharedPtr           usage;          /// Entries of dictionnary used by conversions
+        std::shared_ptr<const AssetRouter>  router;         /// Conversion of each asset
+        OutputLayout                        layout = OutputLayout::Default;
+        bool                                stampLatency = false;   /// Add 'do_filter_latency_us' in outputs
+        ConversionStatistics*               statistics = nullptr;   /// Conversions not accounted if nullptr
+    };
+
+    static int64_t nowUs(void);
+    void process(ReadingSet* readingSet, bool queued);
+    void captureInput(ReadingSet* readingSet, int64_t ingestTimeUs);
+    static bool isCommand(const AssetRouter& router, Reading* reading);
+    static void splitCommands(const AssetRouter& router, const Readings& readings, Readings* commands,
+            Readings* measurements);
+    void passOn(ReadingSet* readingSet, bool command, int64_t ingestTimeUs);
+    void trackAssets(const AssetRouter& router, const Readings& readings);
+    void convertSet(const Conversion& conversion, ReadingSet* readingSet, int64_t ingestTimeUs);
+    bool convertReadings(const Conversion& conversion, Reading* const* first, Reading* const* last,
+            int64_t ingestTimeUs, Readings* output);
+    void ingestChunks(ReadingSet* readingSet, int64_t ingestTimeUs);
+    void pivot2opcua(const Conversion& conversion, Reading* readDp, int64_t ingestTimeUs, Readings* fanOut);
+    void opcua2pivot(Reading* readDp, int64_t ingestTimeUs);
+    void recordSourceLatency(const Conversion& conversion, const CommonMeasurePivot& pivot,
+            Datapoint* const* first, Datapoint* const* last, int64_t ingestTimeUs);
+    void reportUnknownId(const std::string& pivotId);
+    void reportStatistics(int64_t nowUs);
+    static DataDictionnary_SharedPtr loadDictionnary(const string& jsonExData, uint64_t hash,
+            const string& snapshotName, unsigned nbThreads, bool useSnapshot, const std::atomic<bool>* cancel);
+    static SignalHandles_SharedPtr assignHandles(const DataDictionnary_SharedPtr& dictionnary,
+            const SignalHandles_SharedPtr& previous, const string& filterName);
+    static void warnPackedMappings(const DataDictionnary& dictionnary);
+    void publishDictionnary(const DataDictionnary_SharedPtr& dictionnary, const SignalHandles_SharedPtr& handles,
+            int64_t durationUs);
     void                         handleConfig(const ConfigCategory& config);
-    DataDictionnary_Ptr          m_dictionnary;
+    Conversion                   m_conversion;
+    uint64_t                     m_dictGeneration = 0;      /// Number of dictionnaries published
+    uint64_t                     m_exDataHash = 0;          /// Content hash of the last "exchanged_data" submitted
+    size_t                       m_exDataSize = 0;          /// Size of the last "exchanged_data" submitted
     std::mutex                   m_configMutex;
+    /** Held with m_configMutex to change m_conversion and m_capture, so that they can be used by
+     *  the caller thread in asynchronous mode without waiting for conversions */
+    std::mutex                   m_inputMutex;
+    std::atomic<bool>            m_inputEnabled{false};     /// isEnabled(), for the caller thread in asynchronous mode
+    FilterStatistics             m_statistics;
+    ConversionStatistics         m_conversionStats;         /// Guarded by m_configMutex
+    int64_t                      m_statsPeriodUs = 0;       /// Period of statistics logs (0 = disabled)
+    int64_t                      m_lastStatsReportUs = 0;
+    size_t                       m_chunkSize = 0;           /// Large sets are forwarded by chunks (0 = disabled)
+    int64_t                      m_cmdTimeoutUs = -1;       /// Commands without reply after that delay are timed-out
+    int64_t                      m_cmdMaxPending = -1;      /// Maximum number of commands waiting for a reply
+    ReadingCapture               m_capture;                 /// Record of input readings (when enabled)
+    uint64_t                     m_captureSize = 0;
+    ReadingBatcher               m_batcher;                 /// Output stage, passes on pending readings when destroyed
+    size_t                       m_asyncDepth = 0;          /// Configured ingest queue depth (0 = synchronous)
+    AsyncIngest::FullPolicy      m_asyncPolicy = AsyncIngest::FullPolicy::Block;
+    std::unique_ptr<AsyncIngest> m_async;                   /// Converts the queued sets, before the output stage stops
+    DictionaryBuilder            m_builder;                 /// Last member: stopped before the others are destroyed
 };
 
 
@@ -0,0 +1,94 @@
+#ifndef INCLUDE_PIVOT2OPCUA_HANDLES_H_
+#define INCLUDE_PIVOT2OPCUA_HANDLES_H_
+/*
+ * Fledge "pivottoopcua" filter plugin.
+ *
+ * Copyright (c) 2020 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+// System headers
+#include <stdint.h>
+#include <stddef.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Project headers
+#include "pivot2opcua_cache.h"
+#include "pivot2opcua_histogram.h"
+
+/**************************************************************************/
+/**
+ * 32-bit handles of the entries of a dictionnary ("do_handle"), so that consumers
+ * find the OPC UA variables of a converted object by array indexing.
+ * Handles are kept across reconfigurations and restarts (from the saved table) for
+ * unchanged pivot ids. The handles of removed ids are reused by new ones (in pivot id
+ * order), so that the table stays dense.
+ * Ids matched by a pattern share the handle of the pattern.
+ * Tables are immutable: a new one is built for each dictionnary.
+ */
+class SignalHandles {
+ public:
+    /**
+     * @param dictionnary The dictionnary whose entries get a handle
+     * @param previous The handles of the previous dictionnary, if any
+     */
+    SignalHandles(DataDictionnary_SharedPtr dictionnary, const SignalHandles* previous);
+    /**
+     * @param dictionnary The dictionnary whose entries get a handle
+     * @param previousIds The pivot ids of a previous table, by handle (empty if unassigned) (@see load)
+     */
+    SignalHandles(DataDictionnary_SharedPtr dictionnary, const std::vector<std::string>& previousIds);
+    SignalHandles(const SignalHandles&) = delete;
+    SignalHandles& operator=(const SignalHandles&) = delete;
+
+    /** @param element An element of the dictionnary */
+    uint32_t handle(const PivotElement& element)const {return m_handles[element.m_index];}
+
+    /** @return The entry with handle 'handle', or nullptr if it is not assigned */
+    const PivotElementMap_t::value_type* entry(uint32_t handle)const {
+        return handle < m_entries.size() ? m_entries[handle] : nullptr;
+    }
+
+    /** @return The size of the table (highest handle + 1) */
+    size_t size(void)const {return m_entries.size();}
+    /** @return The number of handles kept from the previous table */
+    size_t kept(void)const {return m_kept;}
+
+    /**
+     * Write the table as a JSON object: "handles" is an array indexed by handle of
+     * {"pivot_id", "mappings": [{"type", "address"}]} objects (null for unassigned handles).
+     */
+    void toJson(JsonWriter_t* writer)const;
+
+    /**
+     * Write the table (@see toJson) to a file, atomically
+     * @return false on error (logged)
+     */
+    bool save(const std::string& path)const;
+
+    /**
+     * Read the pivot ids of a table written by ::save
+     * @param ids Set to the pivot ids, by handle (empty if unassigned)
+     * @return false if the file does not exist or is invalid (logged)
+     */
+    static bool load(const std::string& path, std::vector<std::string>* ids);
+
+    /** @return The table file of the filter 'filterName' (@see DictionarySnapshot::dataPath) */
+    static std::string defaultPath(const std::string& filterName);
+
+ private:
+    /** @param previousIds The pivot ids of the previous table, by handle (nullptr if unassigned) */
+    void assign(const std::vector<const std::string*>& previousIds);
+
+    const DataDictionnary_SharedPtr                     m_dictionnary;
+    std::vector<uint32_t>                               m_handles;  /// By element index
+    std::vector<const PivotElementMap_t::value_type*>   m_entries;  /// By handle (nullptr if unassigned)
+    size_t                                              m_kept = 0;
+};
+
+using SignalHandles_SharedPtr = std::shared_ptr<const SignalHandles>;
+
+#endif  //INCLUDE_PIVOT2OPCUA_HANDLES_H_
@@ -0,0 +1,69 @@
+#ifndef INCLUDE_PIVOT2OPCUA_HISTOGRAM_H_
+#define INCLUDE_PIVOT2OPCUA_HISTOGRAM_H_
+/*
+ * Fledge "pivottoopcua" filter plugin.
+ *
+ * Copyright (c) 2020 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+// System headers
+#include <stdint.h>
+
+// Fledge includes
+#include "rapidjson/writer.h"
+#include "rapidjson/stringbuffer.h"
+
+using JsonWriter_t = rapidjson::Writer<rapidjson::StringBuffer>;
+
+/**************************************************************************/
+/**
+ * Histogram of durations (in micro-seconds).
+ * Values are stored in log-linear buckets: each power of two is split into
+ * 8 linear sub-buckets, so that any percentile is known with a relative error
+ * below 12.5%, for a constant memory footprint.
+ */
+class LatencyHistogram {
+ public:
+    LatencyHistogram(void);
+
+    /**
+     * @param us The duration to record. Negative values (e.g. due to clocks
+     *      not synchronized between source and filter) are only counted.
+     */
+    void add(int64_t us);
+    void reset(void);
+
+    uint64_t count(void)const {return m_count;}
+    uint64_t negatives(void)const {return m_negative;}
+    int64_t min(void)const {return m_count > 0 ? m_min : 0;}
+    int64_t max(void)const {return m_count > 0 ? m_max : 0;}
+    int64_t mean(void)const;
+    /**
+     * @param ratio The requested percentile, in [0.0 .. 1.0]
+     * @return The upper bound of the bucket containing that percentile
+     */
+    int64_t percentile(double ratio)const;
+
+    /** Write the histogram summary as a JSON object */
+    void toJson(JsonWriter_t* writer)const;
+
+ private:
+    static const unsigned SubBucketBits = 3;
+    static const unsigned SubBuckets = 1u << SubBucketBits;
+    static const unsigned MaxValueBits = 40;   // 2^40 us ~ 12 days
+    static const unsigned NbBuckets = (MaxValueBits - SubBucketBits + 1) * SubBuckets;
+
+    static unsigned bucketOf(uint64_t us);
+    static uint64_t bucketUpperBound(unsigned bucket);
+
+    uint64_t m_buckets[NbBuckets];
+    uint64_t m_count;
+    uint64_t m_negative;
+    int64_t m_min;
+    int64_t m_max;
+    double m_sum;
+};
+
+#endif  //INCLUDE_PIVOT2OPCUA_HISTOGRAM_H_
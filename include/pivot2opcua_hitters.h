@@ -0,0 +1,79 @@
+#ifndef INCLUDE_PIVOT2OPCUA_HITTERS_H_
+#define INCLUDE_PIVOT2OPCUA_HITTERS_H_
+/*
+ * Fledge "pivottoopcua" filter plugin.
+ *
+ * Copyright (c) 2020 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+// System headers
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Project headers
+#include "pivot2opcua_histogram.h"
+
+/**************************************************************************/
+/**
+ * Most frequent keys of a stream ("heavy hitters"), using the Space-Saving
+ * algorithm: a fixed number of counters, the least counted one being reused
+ * for a key not tracked yet. Any key seen more than total/capacity times is
+ * tracked, and its count is over-estimated by at most its 'error'.
+ * Keys are small integers (e.g. signal handles), so that the position of each
+ * counter is found by indexing, and reusing a counter does not allocate.
+ * Counters are kept sorted by decreasing count, so that an update costs a
+ * binary search, whatever the stream size.
+ */
+class HeavyHitters {
+ public:
+    explicit HeavyHitters(size_t capacity = 200);
+
+    /**
+     * @param key The key seen
+     * @param nowUs The current time, in micro-seconds since Epoch (for rate estimates)
+     */
+    void add(uint32_t key, int64_t nowUs);
+    void reset(void);
+
+    /** @return The number of keys seen since the last reset */
+    uint64_t total(void)const {return m_total;}
+    /** @return The estimated count of 'key' (0 if not tracked) */
+    uint64_t count(uint32_t key)const;
+    /** @return The keys tracked, most counted first */
+    std::vector<uint32_t> keys(void)const;
+    /** Stop tracking 'key' (e.g. when it is reused for something else) */
+    void remove(uint32_t key);
+
+    /**
+     * Write the 'top' most frequent keys as a JSON object, with their counts
+     * and rates (per second) over the observation window.
+     * @param keyName The name reported for a key
+     */
+    void toJson(JsonWriter_t* writer, size_t top, const std::function<std::string(uint32_t)>& keyName)const;
+
+ private:
+    struct Counter {
+        uint32_t key;
+        uint64_t count;
+        uint64_t error;     /// Maximum over-estimation of count
+    };
+    /// Position of an untracked key
+    static const uint32_t NotTracked = UINT32_MAX;
+
+    void increment(uint32_t pos);
+    void setPosition(uint32_t key, uint32_t pos);
+
+    const size_t            m_capacity;
+    std::vector<Counter>    m_counters;     /// Sorted by decreasing count
+    std::vector<uint32_t>   m_positions;    /// Position of each key in m_counters, by key
+    uint64_t                m_total;
+    int64_t                 m_firstUs;
+    int64_t                 m_lastUs;
+};
+
+#endif  //INCLUDE_PIVOT2OPCUA_HITTERS_H_
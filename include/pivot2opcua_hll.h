@@ -0,0 +1,36 @@
+#ifndef INCLUDE_PIVOT2OPCUA_HLL_H_
+#define INCLUDE_PIVOT2OPCUA_HLL_H_
+/*
+ * Fledge "pivottoopcua" filter plugin.
+ *
+ * Copyright (c) 2020 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+// System headers
+#include <stdint.h>
+#include <string>
+
+/**************************************************************************/
+/**
+ * HyperLogLog estimate of the number of distinct strings, in constant memory
+ * (4 kB, standard error about 1.6%).
+ */
+class HyperLogLog {
+ public:
+    HyperLogLog(void);
+
+    void add(const std::string& key);
+    void reset(void);
+    /** @return The estimated number of distinct keys added */
+    uint64_t estimate(void)const;
+
+ private:
+    static const unsigned PrecisionBits = 12;
+    static const unsigned NbRegisters = 1u << PrecisionBits;
+
+    uint8_t m_registers[NbRegisters];
+};
+
+#endif  //INCLUDE_PIVOT2OPCUA_HLL_H_
@@ -0,0 +1,222 @@
+#ifndef INCLUDE_PIVOT2OPCUA_PACKED_H_
+#define INCLUDE_PIVOT2OPCUA_PACKED_H_
+/*
+ * Fledge "pivottoopcua" filter plugin.
+ *
+ * Copyright (c) 2020 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+// System headers
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <string>
+
+/**************************************************************************/
+/**
+ * Packed measurement record (setting "packed_output"), published as the string
+ * datapoint "do_packed" in place of "data_object".
+ * This header has no dependency: it can be copied into consumers to decode records.
+ *
+ * The datapoint value is the base64 encoding (RFC 4648, padded) of the record.
+ * Layout version 1, integers are little-endian:
+ *  offset  size
+ *    0     1   version (1)
+ *    1     1   "do_type" code
+ *    2     1   "do_comingfrom" code
+ *    3     1   "do_value_quality" code
+ *    4     1   "do_source" code
+ *    5     1   "do_ts_org" code
+ *    6     1   "do_ts_validity" code
+ *    7     1   value kind (ValueKind)
+ *    8     4   "do_handle": stable handle of the pivot id (see README)
+ *   12     1   "do_confirmation"
+ *   13     1   mapping: rank of the OPC UA mapping, for pivot ids with several of them
+ *              (only the first MaxMappings mappings of a pivot id are published)
+ *   14     2   length of the pivot id ("do_id")
+ *   16     4   "do_cot"
+ *   20     4   "do_quality"
+ *   24     4   "do_ts_quality"
+ *   28     4   micro-seconds of the source timestamp
+ *   32     8   "do_ts" (seconds since Epoch)
+ *   40     8   value: int64, IEEE-754 double, or the length of the string value
+ *   48     *   pivot id, then string value
+ * Codes are those of the compact layout (see README), NoCode for values without a code.
+ * Fields may be appended after the fixed part in later versions: decoders must only
+ * check the version and read the lengths they know.
+ */
+struct PackedRecord {
+    enum : uint8_t {Version = 1, NoCode = 0xFF};
+    enum : size_t {HeaderSize = 48, MaxMappings = 256};
+    enum class ValueKind : uint8_t {Integer = 0, Float = 1, String = 2};
+
+    uint8_t     opcType = NoCode;
+    uint8_t     comingFrom = NoCode;
+    uint8_t     valueQuality = NoCode;
+    uint8_t     source = NoCode;
+    uint8_t     tmOrg = NoCode;
+    uint8_t     tmValidity = NoCode;
+    ValueKind   kind = ValueKind::Integer;
+    uint32_t    handle = 0;
+    bool        confirmation = false;
+    uint8_t     mapping = 0;
+    uint32_t    cot = 0;
+    uint32_t    quality = 0;
+    uint32_t    tsQuality = 0;
+    uint32_t    tsMicros = 0;
+    int64_t     ts = 0;
+    int64_t     intValue = 0;
+    double      floatValue = 0;
+    std::string stringValue;
+    std::string id;
+
+    /** @return The record, base64 encoded */
+    std::string encode(void)const {
+        const size_t idSize(id.size() > 0xFFFF ? 0xFFFF : id.size());
+        std::string raw(HeaderSize, '\0');
+        raw[0] = static_cast<char>(Version);
+        raw[1] = static_cast<char>(opcType);
+        raw[2] = static_cast<char>(comingFrom);
+        raw[3] = static_cast<char>(valueQuality);
+        raw[4] = static_cast<char>(source);
+        raw[5] = static_cast<char>(tmOrg);
+        raw[6] = static_cast<char>(tmValidity);
+        raw[7] = static_cast<char>(kind);
+        put(&raw, 8, handle, 4);
+        raw[12] = static_cast<char>(confirmation ? 1 : 0);
+        raw[13] = static_cast<char>(mapping);
+        put(&raw, 14, idSize, 2);
+        put(&raw, 16, cot, 4);
+        put(&raw, 20, quality, 4);
+        put(&raw, 24, tsQuality, 4);
+        put(&raw, 28, tsMicros, 4);
+        put(&raw, 32, static_cast<uint64_t>(ts), 8);
+        put(&raw, 40, valueBits(), 8);
+        raw.append(id, 0, idSize);
+        if (kind == ValueKind::String) raw.append(stringValue);
+        return toBase64(raw);
+    }
+
+    /**
+     * @param packed A "do_packed" value
+     * @return false if 'packed' is not a valid record of a known version
+     */
+    bool decode(const std::string& packed) {
+        std::string raw;
+        if (!fromBase64(packed, &raw) || raw.size() < HeaderSize || static_cast<uint8_t>(raw[0]) != Version) {
+            return false;
+        }
+        const uint8_t* bytes(reinterpret_cast<const uint8_t*>(raw.data()));
+        if (bytes[7] > static_cast<uint8_t>(ValueKind::String)) return false;
+        const size_t idSize(static_cast<size_t>(get(bytes + 14, 2)));
+        const uint64_t value(get(bytes + 40, 8));
+        const size_t valueSize(bytes[7] == static_cast<uint8_t>(ValueKind::String) ? static_cast<size_t>(value) : 0);
+        if (idSize > raw.size() - HeaderSize || valueSize > raw.size() - HeaderSize - idSize) return false;
+        opcType = bytes[1];
+        comingFrom = bytes[2];
+        valueQuality = bytes[3];
+        source = bytes[4];
+        tmOrg = bytes[5];
+        tmValidity = bytes[6];
+        kind = static_cast<ValueKind>(bytes[7]);
+        handle = static_cast<uint32_t>(get(bytes + 8, 4));
+        confirmation = (bytes[12] != 0);
+        mapping = bytes[13];
+        cot = static_cast<uint32_t>(get(bytes + 16, 4));
+        quality = static_cast<uint32_t>(get(bytes + 20, 4));
+        tsQuality = static_cast<uint32_t>(get(bytes + 24, 4));
+        tsMicros = static_cast<uint32_t>(get(bytes + 28, 4));
+        ts = static_cast<int64_t>(get(bytes + 32, 8));
+        id.assign(raw, HeaderSize, idSize);
+        intValue = 0;
+        floatValue = 0;
+        stringValue.clear();
+        if (kind == ValueKind::Integer) {
+            intValue = static_cast<int64_t>(value);
+        } else if (kind == ValueKind::Float) {
+            memcpy(&floatValue, &value, sizeof(floatValue));
+        } else {
+            stringValue.assign(raw, HeaderSize + idSize, valueSize);
+        }
+        return true;
+    }
+
+ private:
+    uint64_t valueBits(void)const {
+        if (kind == ValueKind::Integer) return static_cast<uint64_t>(intValue);
+        if (kind == ValueKind::String) return stringValue.size();
+        uint64_t bits;
+        memcpy(&bits, &floatValue, sizeof(bits));
+        return bits;
+    }
+
+    static void put(std::string* raw, size_t offset, uint64_t value, size_t size) {
+        for (size_t i = 0 ; i < size ; i++) {
+            (*raw)[offset + i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+        }
+    }
+
+    static uint64_t get(const uint8_t* bytes, size_t size) {
+        uint64_t value(0);
+        for (size_t i = 0 ; i < size ; i++) {
+            value |= static_cast<uint64_t>(bytes[i]) << (8 * i);
+        }
+        return value;
+    }
+
+    static const char* alphabet(void) {
+        return "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    }
+
+    static std::string toBase64(const std::string& raw) {
+        const char* const chars(alphabet());
+        std::string result;
+        result.reserve((raw.size() + 2) / 3 * 4);
+        const uint8_t* bytes(reinterpret_cast<const uint8_t*>(raw.data()));
+        size_t i(0);
+        for (; i + 2 < raw.size() ; i += 3) {
+            const uint32_t block((bytes[i] << 16) | (bytes[i + 1] << 8) | bytes[i + 2]);
+            result += chars[(block >> 18) & 0x3F];
+            result += chars[(block >> 12) & 0x3F];
+            result += chars[(block >> 6) & 0x3F];
+            result += chars[block & 0x3F];
+        }
+        if (i < raw.size()) {
+            const bool two(i + 1 < raw.size());
+            const uint32_t block((bytes[i] << 16) | (two ? bytes[i + 1] << 8 : 0));
+            result += chars[(block >> 18) & 0x3F];
+            result += chars[(block >> 12) & 0x3F];
+            result += (two ? chars[(block >> 6) & 0x3F] : '=');
+            result += '=';
+        }
+        return result;
+    }
+
+    static bool fromBase64(const std::string& text, std::string* raw) {
+        if (text.size() % 4 != 0) return false;
+        raw->clear();
+        raw->reserve(text.size() / 4 * 3);
+        for (size_t i = 0 ; i < text.size() ; i += 4) {
+            uint32_t block(0);
+            size_t padding(0);
+            for (size_t j = 0 ; j < 4 ; j++) {
+                const char c(text[i + j]);
+                const char* const pos(c == '\0' ? nullptr : strchr(alphabet(), c));
+                if (c == '=' && j >= 2 && i + 4 == text.size()) {
+                    padding++;
+                } else if (pos == nullptr || padding > 0) {
+                    return false;
+                }
+                block = (block << 6) | (pos != nullptr ? static_cast<uint32_t>(pos - alphabet()) : 0);
+            }
+            raw->push_back(static_cast<char>((block >> 16) & 0xFF));
+            if (padding < 2) raw->push_back(static_cast<char>((block >> 8) & 0xFF));
+            if (padding < 1) raw->push_back(static_cast<char>(block & 0xFF));
+        }
+        return true;
+    }
+};
+
+#endif  //INCLUDE_PIVOT2OPCUA_PACKED_H_
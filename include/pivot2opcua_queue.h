@@ -0,0 +1,65 @@
+#ifndef INCLUDE_PIVOT2OPCUA_QUEUE_H_
+#define INCLUDE_PIVOT2OPCUA_QUEUE_H_
+/*
+ * Fledge "pivottoopcua" filter plugin.
+ *
+ * Copyright (c) 2020 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+// System headers
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <memory>
+
+// Fledge includes
+#include "reading_set.h"
+
+/**************************************************************************/
+/**
+ * Bounded lock-free FIFO of reading sets (D. Vyukov's array-based queue).
+ * Any number of threads may push and pop concurrently: each cell has a
+ * sequence number telling whether it is free for the push, or filled for
+ * the pop, of a given position.
+ */
+class ReadingQueue {
+ public:
+    struct Item {
+        ReadingSet* readingSet;
+        int64_t     enqueuedUs;     /// Time of the push, in micro-seconds
+    };
+
+    /**
+     * @param capacity The maximum number of items (at least 2: with a single
+     *      cell, "filled" and "free for the next round" could not be told apart)
+     */
+    explicit ReadingQueue(size_t capacity);
+    ReadingQueue(const ReadingQueue&) = delete;
+    ReadingQueue& operator=(const ReadingQueue&) = delete;
+
+    /** @return false if the queue is full */
+    bool tryPush(const Item& item);
+    /** @return false if the queue is empty */
+    bool tryPop(Item* item);
+
+    size_t capacity(void)const {return m_capacity;}
+    /** @return The number of items, only exact when no push or pop is in progress */
+    size_t size(void)const;
+
+ private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        Item                item;
+    };
+
+    const size_t                    m_capacity;
+    const std::unique_ptr<Cell[]>   m_cells;
+    char                            m_pad1[64];     /// Producers and consumers do not share cache lines
+    std::atomic<size_t>             m_pushPos;
+    char                            m_pad2[64];
+    std::atomic<size_t>             m_popPos;
+};
+
+#endif  //INCLUDE_PIVOT2OPCUA_QUEUE_H_
@@ -0,0 +1,61 @@
+#ifndef INCLUDE_PIVOT2OPCUA_ROUTER_H_
+#define INCLUDE_PIVOT2OPCUA_ROUTER_H_
+/*
+ * Fledge "pivottoopcua" filter plugin.
+ *
+ * Copyright (c) 2020 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+// System headers
+#include <stddef.h>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**************************************************************************/
+/**
+ * Routing table from asset names to conversions, built once per configuration.
+ * Expected format (JSON object):
+ *  {
+ *      "<asset name>" : "<route>",
+ *      "<prefix>*" : "<route>",
+ *      "*" : "<route>"
+ *  }
+ * with <route> one of "pivot2opcua", "opcua2pivot" or "passthrough".
+ * Exact names take precedence over prefixes, and longer prefixes over shorter ones.
+ * Assets matching no rule are converted from PIVOT ("pivot2opcua").
+ */
+class AssetRouter {
+ public:
+    enum class Route {Pivot2Opcua, Opcua2Pivot, Passthrough};
+
+    /** Built-in rules: "opcua_operation" assets are commands, others are PIVOT objects */
+    AssetRouter(void);
+    /**
+     * @param json The routing table
+     * @throw std::exception If 'json' is not a valid routing table
+     */
+    explicit AssetRouter(const std::string& json);
+
+    /** @return The route of the readings of asset 'assetName' */
+    Route route(const std::string& assetName)const;
+
+    /** @return The number of rules */
+    size_t size(void)const {return m_names.size() + m_prefixes.size();}
+
+    /**
+     * @param name A route name
+     * @param route Receives the route named 'name'
+     * @return false if 'name' is not a route name
+     */
+    static bool routeOf(const std::string& name, Route* route);
+
+ private:
+    std::unordered_map<std::string, Route>      m_names;
+    std::vector<std::pair<std::string, Route>>  m_prefixes;     /// Longest first
+};
+
+#endif  //INCLUDE_PIVOT2OPCUA_ROUTER_H_
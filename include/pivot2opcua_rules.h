@@ -33,6 +33,8 @@ using std::string;
 /**************************************************************************/
 /// In pivot object, name of the sub-section, depending on GTIx type
 extern const Str2Vect_map_t gtix2pivotTypeMap;
+/// For each pivot value sub-section, the OPC UA types that can be built from it
+extern const Str2Vect_map_t pivotType2opcTypesMap;
 
 template <typename Tin, typename Tout, typename Tmap = std::map<const Tin&, const Tout&>>
 static const Tout&
@@ -0,0 +1,91 @@
+#ifndef INCLUDE_PIVOT2OPCUA_SNAPSHOT_H_
+#define INCLUDE_PIVOT2OPCUA_SNAPSHOT_H_
+/*
+ * Fledge "pivottoopcua" filter plugin.
+ *
+ * Copyright (c) 2020 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+// System headers
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+// Project headers
+#include "pivot2opcua_data.h"
+
+/**************************************************************************/
+/**
+ * Binary snapshot of a DataDictionnary, so that a restart with an unchanged
+ * "exchanged_data" configuration does not parse the JSON again.
+ *
+ * File layout (host byte order, checked with `byteOrder`):
+ * - SnapshotHeader
+ * - `nbEntries` SnapshotEntry
+ * - Strings area: `stringsSize` bytes. Pivot and OPC UA types are shared by all entries.
+ *   The mappings of an entry (if several) are stored there as a sequence of
+ *   (uint32_t length, characters) for the type then the address of each mapping.
+ * All locations are offsets, so that the file is position-independent.
+ * The file is mapped read-only and fully checked (checksum and bounds) before use.
+ */
+class DictionarySnapshot {
+ public:
+    static const uint32_t Version = 3;
+
+    struct SnapshotHeader {
+        char        magic[8];
+        uint32_t    version;
+        uint32_t    byteOrder;
+        uint64_t    configHash;     /// contentHash of the "exchanged_data" JSON
+        uint64_t    nbEntries;
+        uint64_t    duplicates;
+        uint64_t    stringsOffset;
+        uint64_t    stringsSize;
+        uint64_t    checksum;       /// contentHash of everything after the header
+    };
+
+    struct SnapshotEntry {
+        uint32_t    idOffset;
+        uint32_t    idLength;
+        uint32_t    typeOffset;
+        uint32_t    typeLength;
+        uint32_t    opcTypeOffset;
+        uint32_t    opcTypeLength;
+        uint32_t    addressOffset;
+        uint32_t    addressLength;
+        uint32_t    mappingsOffset;
+        uint32_t    mappingsLength;     /// 0 if the entry has a single mapping
+    };
+
+    /** @return A 64-bit hash of 'data' (not cryptographic, but stable across runs) */
+    static uint64_t contentHash(const void* data, size_t size);
+
+    /**
+     * Write the snapshot of 'dictionnary' (atomically replacing any existing file)
+     * @param configHash The contentHash of the configuration 'dictionnary' was built from
+     * @return false on error
+     */
+    static bool save(const std::string& path, uint64_t configHash, const DataDictionnary& dictionnary);
+
+    /**
+     * @return The dictionnary read from the snapshot 'path', or nullptr if the file is
+     *      missing, built from another configuration (stale) or corrupted
+     */
+    static DataDictionnary_Ptr load(const std::string& path, uint64_t configHash);
+
+    /**
+     * @return The snapshot file of the filter 'filterName', located in the plugin data
+     *      folder (created if needed), or an empty string if the Fledge data folder is unknown
+     */
+    static std::string defaultPath(const std::string& filterName);
+
+    /**
+     * @return The file '<filterName><suffix>' in the plugin data folder (created if needed),
+     *      or an empty string if the Fledge data folder is unknown
+     */
+    static std::string dataPath(const std::string& filterName, const char* suffix);
+};
+
+#endif  //INCLUDE_PIVOT2OPCUA_SNAPSHOT_H_
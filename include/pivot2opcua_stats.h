@@ -0,0 +1,178 @@
+#ifndef INCLUDE_PIVOT2OPCUA_STATS_H_
+#define INCLUDE_PIVOT2OPCUA_STATS_H_
+/*
+ * Fledge "pivottoopcua" filter plugin.
+ *
+ * Copyright (c) 2020 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+// System headers
+#include <stdint.h>
+#include <string>
+#include <map>
+#include <memory>
+#include <mutex>
+
+// Project headers
+#include "pivot2opcua_histogram.h"
+#include "pivot2opcua_commands.h"
+#include "pivot2opcua_handles.h"
+#include "pivot2opcua_hitters.h"
+#include "pivot2opcua_hll.h"
+#include "pivot2opcua_usage.h"
+
+using LatencyHistogramMap_t = std::map<std::string, LatencyHistogram>;
+
+/**************************************************************************/
+/**
+ * Statistics of each conversion of a PIVOT object.
+ * Not thread-safe: it is only updated by the conversion lane (which never runs
+ * concurrently), so that a conversion takes no lock. Reports read it from the
+ * same lane, or holding the lock that serializes conversions.
+ */
+class ConversionStatistics {
+ public:
+    ConversionStatistics(void) = default;
+
+    /**
+     * Record the delay between the source timestamp of a PIVOT object and its
+     * ingestion by the filter.
+     * @param comingFrom The "ComingFrom" field of the PIVOT object
+     * @param delayUs The delay, in micro-seconds
+     */
+    void addSourceLatency(const std::string& comingFrom, int64_t delayUs);
+
+    /**
+     * A PIVOT object was converted. The most frequent dictionnary entries are tracked.
+     * @param handle The handle of the dictionnary entry of the PIVOT object (@see setHandles)
+     * @param nowUs The current time, in micro-seconds since Epoch
+     */
+    void addConversion(uint32_t handle, int64_t nowUs) {m_heavyHitters.add(handle, nowUs);}
+
+    /**
+     * Name the handles of the next conversions with 'handles'. The counts of the handles
+     * now given to other pivot ids are dropped.
+     */
+    void setHandles(SignalHandles_SharedPtr handles);
+
+    /** Write the "source_latency" and "heavy_hitters" members of a JSON object */
+    void toJson(JsonWriter_t* writer)const;
+
+ private:
+    /// Maximum number of distinct "ComingFrom" histograms (others are merged)
+    static const size_t MaxSources = 64;
+    /// Number of most frequent converted pivot ids reported (4 times more are tracked)
+    static const size_t TopHeavyHitters = 50;
+
+    LatencyHistogramMap_t m_sourceLatency;
+    HeavyHitters m_heavyHitters{4 * TopHeavyHitters};
+    SignalHandles_SharedPtr m_handles;
+};
+
+/**************************************************************************/
+/**
+ * Statistics collected by the filter.
+ * All methods are thread-safe.
+ */
+class FilterStatistics {
+ public:
+    FilterStatistics(void) = default;
+
+    /**
+     * Converted readings were handed to the output stage
+     * @param command true for commands and command replies (priority lane), false for measurements
+     * @param delayUs The delay since the readings were received, in micro-seconds
+     */
+    void addLaneLatency(bool command, int64_t delayUs);
+
+    /**
+     * A reading set was passed on to the next filter
+     * @param nbReadings The number of readings in the set
+     * @param timeout true if a batch was passed on because of its maximum delay
+     */
+    void addOutput(size_t nbReadings, bool timeout);
+
+    /**
+     * A reading set was taken from the asynchronous ingest queue
+     * @param waitUs The time spent in the queue, in micro-seconds
+     * @param queued The number of sets still in the queue
+     */
+    void addQueueWait(int64_t waitUs, size_t queued);
+    /** The oldest set of the asynchronous ingest queue was dropped to make room */
+    void addQueueDrop(size_t nbReadings);
+    /** The asynchronous ingest queue was full: the upstream thread had to wait */
+    void addQueueBlocked(void);
+
+    /** @see CommandTracker::configure */
+    void configureCommands(size_t maxPending, int64_t timeoutUs);
+    /** A command (PIVOTTC) with the given Identifier has been forwarded */
+    void addCommand(const std::string& pivotId, int64_t nowUs);
+    /** A command reply (GTIC) with the given Identifier has been received */
+    void addCommandReply(const std::string& pivotId, bool ack, int64_t nowUs);
+    /** Account commands which did not receive any reply within timeout */
+    void expireCommands(int64_t nowUs);
+
+    /**
+     * A new dictionnary has been published
+     * @param generation The number of dictionnaries published since start (1 = initial configuration)
+     * @param entries The number of entries in the dictionnary
+     * @param durationUs The build duration, in micro-seconds
+     */
+    void addDictionaryBuild(uint64_t generation, size_t entries, int64_t durationUs);
+    /** A dictionnary build was cancelled by a newer configuration, or failed */
+    void addDictionaryBuildFailure(bool cancelled);
+
+    /**
+     * A reading with a pivot id unknown in the dictionnary was rejected.
+     * The most recently seen unknown ids are kept (with their count) for reporting.
+     * @return true if 'pivotId' is not among the recently seen unknown ids
+     */
+    bool addUnknownId(const std::string& pivotId);
+
+    /** Report the usage of the current dictionnary (replaces the previous one) */
+    void setDictionaryUsage(std::shared_ptr<const DictionaryUsage> usage);
+
+    /**
+     * @param conversions The statistics of the conversion lane, if any
+     * @return All statistics as a JSON object
+     */
+    std::string toJson(const ConversionStatistics* conversions = nullptr)const;
+
+ private:
+    /// Maximum number of recently seen unknown pivot ids
+    static const size_t MaxUnknownIds = 64;
+    /// Number of most frequent unknown pivot ids reported
+    static const size_t TopUnknownIds = 10;
+
+    struct UnknownId {
+        uint64_t count;
+        uint64_t lastSeen;  /// Sequence number of the last rejection
+    };
+
+    mutable std::mutex m_mutex;
+    CommandTracker m_commands;
+    uint64_t m_outputSets = 0;
+    uint64_t m_outputReadings = 0;
+    uint64_t m_outputTimeouts = 0;
+    LatencyHistogram m_commandLane;
+    LatencyHistogram m_measurementLane;
+    LatencyHistogram m_queueWait;
+    size_t m_queueDepth = 0;
+    size_t m_queueMaxDepth = 0;
+    uint64_t m_queueDroppedSets = 0;
+    uint64_t m_queueDroppedReadings = 0;
+    uint64_t m_queueBlocked = 0;
+    uint64_t m_dictGeneration = 0;
+    size_t m_dictEntries = 0;
+    int64_t m_dictBuildUs = 0;
+    uint64_t m_dictCancelled = 0;
+    uint64_t m_dictFailed = 0;
+    uint64_t m_unknownRejected = 0;
+    std::map<std::string, UnknownId> m_unknownIds;
+    HyperLogLog m_unknownDistinct;
+    std::shared_ptr<const DictionaryUsage> m_dictUsage;
+};
+
+#endif  //INCLUDE_PIVOT2OPCUA_STATS_H_
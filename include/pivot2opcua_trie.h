@@ -0,0 +1,54 @@
+#ifndef INCLUDE_PIVOT2OPCUA_TRIE_H_
+#define INCLUDE_PIVOT2OPCUA_TRIE_H_
+/*
+ * Fledge "pivottoopcua" filter plugin.
+ *
+ * Copyright (c) 2020 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+// System headers
+#include <stddef.h>
+#include <memory>
+#include <string>
+
+struct PivotElement;
+
+/**************************************************************************/
+/**
+ * Compressed radix trie of pivot id patterns, for hierarchical ids
+ * (e.g. "S1/B2/CB3/Pos"):
+ * - '*' matches any sequence of characters except '/' ("S1/B*" matches "S1/B2" but not "S1/B2/CB3")
+ * - '**' matches any sequence of characters, '/' included ("S1/B**" matches "S1/B2/CB3")
+ * When several patterns match, the most specific one (the largest number of literal
+ * characters) is used. Remaining ties are resolved by the smallest pattern.
+ */
+class PivotIdTrie {
+ public:
+    PivotIdTrie(void);
+    ~PivotIdTrie(void);
+    PivotIdTrie(const PivotIdTrie&) = delete;
+    PivotIdTrie& operator=(const PivotIdTrie&) = delete;
+
+    /** @return true if 'pivotId' is a pattern (contains a wildcard) */
+    static bool isPattern(const std::string& pivotId) {return pivotId.find('*') != std::string::npos;}
+
+    /**
+     * @param pattern The pattern
+     * @param element The associated element (not owned). An existing pattern is replaced.
+     */
+    void insert(const std::string& pattern, const PivotElement* element);
+
+    /** @return The element of the best pattern matching 'pivotId', or nullptr */
+    const PivotElement* match(const std::string& pivotId)const;
+
+    size_t size(void)const {return m_size;}
+
+ private:
+    struct Node;
+    std::unique_ptr<Node>   m_root;
+    size_t                  m_size = 0;
+};
+
+#endif  //INCLUDE_PIVOT2OPCUA_TRIE_H_
@@ -0,0 +1,70 @@
+#ifndef INCLUDE_PIVOT2OPCUA_USAGE_H_
+#define INCLUDE_PIVOT2OPCUA_USAGE_H_
+/*
+ * Fledge "pivottoopcua" filter plugin.
+ *
+ * Copyright (c) 2020 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+// System headers
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <memory>
+
+// Project headers
+#include "pivot2opcua_cache.h"
+#include "pivot2opcua_histogram.h"
+
+/**************************************************************************/
+/**
+ * Record of the dictionnary entries used by conversions, to find dead
+ * configuration. One bit per entry: recording a hit is a single relaxed
+ * atomic OR, and can be done concurrently with reports.
+ */
+class DictionaryUsage {
+ public:
+    /**
+     * @param dictionnary The dictionnary whose entries are recorded
+     * @param previous The usage of the dictionnary being replaced, if any: hits of the ids
+     *      still present in 'dictionnary' are kept
+     */
+    explicit DictionaryUsage(DataDictionnary_SharedPtr dictionnary, const DictionaryUsage* previous = nullptr);
+    DictionaryUsage(const DictionaryUsage&) = delete;
+    DictionaryUsage& operator=(const DictionaryUsage&) = delete;
+
+    /** @param element An element of the dictionnary, used by a conversion */
+    void hit(const PivotElement& element) {
+        m_bits[element.m_index >> 6].fetch_or(uint64_t(1) << (element.m_index & 63), std::memory_order_relaxed);
+    }
+
+    /** @return The dictionnary whose entries are recorded */
+    const DataDictionnary_SharedPtr& dictionnary(void)const {return m_dictionnary;}
+
+    /** @return The number of entries used at least once */
+    size_t used(void)const;
+
+    /**
+     * Write the usage report as a JSON object: number of entries, of used ones,
+     * and the (alphabetically) first unused ones.
+     */
+    void toJson(JsonWriter_t* writer)const;
+
+ private:
+    /// Maximum number of unused entries listed in reports
+    static const size_t MaxUnusedReported = 20;
+
+    bool isUsed(uint32_t index)const {
+        return (m_bits[index >> 6].load(std::memory_order_relaxed) & (uint64_t(1) << (index & 63))) != 0;
+    }
+
+    const DataDictionnary_SharedPtr                 m_dictionnary;
+    const size_t                                    m_nbWords;
+    const std::unique_ptr<std::atomic<uint64_t>[]>  m_bits;
+};
+
+using DictionaryUsage_SharedPtr = std::shared_ptr<DictionaryUsage>;
+
+#endif  //INCLUDE_PIVOT2OPCUA_USAGE_H_
@@ -18,6 +18,13 @@
 
 #define FILTER_NAME "pivottoopcua"   // NOLINT //NOSONAR
 
+// PLUGIN DEFAULT ASSET ROUTING: commands from OPC UA, everything else from PIVOT
+#define ASSET_ROUTING_DEF                    \
+    QUOTE({                                  \
+        "opcua_operation" : "opcua2pivot",   \
+        "*" : "pivot2opcua"                  \
+    })
+
 // PLUGIN DEFAULT EXCHANGED DATA CONF
 #define EXCHANGED_DATA_DEF                   \
     QUOTE({                                  \
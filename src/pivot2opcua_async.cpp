@@ -0,0 +1,113 @@
+/*
+ * Fledge "pivottoopcua" filter plugin.
+ *
+ * Copyright (c) 2020 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include "pivot2opcua_async.h"
+
+// System headers
+#include <sys/time.h>
+#include <chrono>
+#include <utility>
+
+namespace {
+
+/// Upper bound of any sleep, in case a wake-up is missed
+const std::chrono::milliseconds MaxSleep(100);
+
+int64_t nowUs(void) {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return static_cast<int64_t>(tv.tv_sec) * 1000000 + tv.tv_usec;
+}
+
+}   // namespace
+
+/**************************************************************************/
+AsyncIngest::AsyncIngest(size_t depth, FullPolicy policy, Process_t process, FilterStatistics* statistics):
+    m_queue(depth),
+    m_policy(policy),
+    m_process(std::move(process)),
+    m_statistics(statistics),
+    m_thread(&AsyncIngest::run, this) {
+}
+
+AsyncIngest::~AsyncIngest(void) {
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_stop = true;
+    }
+    m_notEmpty.notify_all();
+    m_thread.join();
+}
+
+AsyncIngest::FullPolicy
+AsyncIngest::policyOf(const std::string& name) {
+    return name == "drop_oldest" ? FullPolicy::DropOldest : FullPolicy::Block;
+}
+
+void
+AsyncIngest::push(ReadingSet* readingSet) {
+    const ReadingQueue::Item item{readingSet, nowUs()};
+    if (!m_queue.tryPush(item)) {
+        if (m_policy == FullPolicy::DropOldest) {
+            ReadingQueue::Item oldest;
+            while (!m_queue.tryPush(item)) {
+                if (m_queue.tryPop(&oldest)) {
+                    m_statistics->addQueueDrop(oldest.readingSet->getAllReadings().size());
+                    delete oldest.readingSet;
+                }
+            }
+        } else {
+            m_statistics->addQueueBlocked();
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_producersBlocked++;
+            while (!m_queue.tryPush(item)) {
+                m_notFull.wait_for(lock, MaxSleep);
+            }
+            m_producersBlocked--;
+        }
+    }
+    // Pairs with the fence of the consumer going idle
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_consumerIdle) {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_notEmpty.notify_one();
+    }
+}
+
+void
+AsyncIngest::run(void) {
+    ReadingQueue::Item item{nullptr, 0};
+    for (;;) {
+        if (!m_queue.tryPop(&item)) {
+            if (m_stop) return;
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_consumerIdle = true;
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            // Sleep until a push, re-checking the queue with the lock held
+            while (!m_stop && !m_queue.tryPop(&item)) {
+                m_notEmpty.wait_for(lock, MaxSleep);
+            }
+            m_consumerIdle = false;
+            if (item.readingSet == nullptr) continue;
+        }
+        const size_t queued(m_queue.size());
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_producersBlocked > 0) {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            m_notFull.notify_all();
+        }
+        m_statistics->addQueueWait(nowUs() - item.enqueuedUs, queued);
+        ReadingSet* readingSet(item.readingSet);
+        item.readingSet = nullptr;
+        try {
+            m_process(readingSet);
+        }
+        catch (...) {  // //NOSONAR  Nobody to report to, the thread must survive
+        }
+    }
+}
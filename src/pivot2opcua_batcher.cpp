@@ -0,0 +1,97 @@
+/*
+ * Fledge "pivottoopcua" filter plugin.
+ *
+ * Copyright (c) 2020 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include "pivot2opcua_batcher.h"
+
+// System headers
+#include <utility>
+#include <vector>
+
+/**************************************************************************/
+ReadingBatcher::ReadingBatcher(Output_t output):
+    m_output(std::move(output)) {
+}
+
+ReadingBatcher::~ReadingBatcher(void) {
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_stop = true;
+        forward(false);
+    }
+    m_cond.notify_all();
+    if (m_thread.joinable()) m_thread.join();
+}
+
+void
+ReadingBatcher::configure(size_t maxReadings, int64_t maxDelayUs) {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    forward(false);
+    m_maxReadings = maxReadings;
+    m_maxDelayUs = maxDelayUs > 0 ? maxDelayUs : 0;
+}
+
+void
+ReadingBatcher::push(ReadingSet* readingSet) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_maxReadings <= 1) {
+        lock.unlock();
+        m_output(readingSet, false);
+        return;
+    }
+    if (m_pending == nullptr) {
+        m_pending = readingSet;
+        m_deadline = Clock_t::now() + std::chrono::microseconds(m_maxDelayUs);
+        if (!m_thread.joinable()) m_thread = std::thread(&ReadingBatcher::run, this);
+        m_cond.notify_all();
+    } else {
+        std::vector<Reading*> readings(readingSet->getAllReadings());
+        readingSet->clear();
+        m_pending->append(readings);
+        delete readingSet;
+    }
+    if (m_pending->getAllReadings().size() >= m_maxReadings) forward(false);
+}
+
+void
+ReadingBatcher::bypass(ReadingSet* readingSet) {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_output(readingSet, false);
+}
+
+void
+ReadingBatcher::flush(void) {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    forward(false);
+}
+
+void
+ReadingBatcher::forward(bool timeout) {
+    if (m_pending == nullptr) return;
+    ReadingSet* readingSet(m_pending);
+    m_pending = nullptr;
+    // Still holding the lock: sets are passed on in order
+    m_output(readingSet, timeout);
+}
+
+void
+ReadingBatcher::run(void) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stop) {
+        if (m_pending == nullptr) {
+            m_cond.wait(lock);
+        } else if (Clock_t::now() < m_deadline) {
+            m_cond.wait_until(lock, m_deadline);
+        } else {
+            try {
+                forward(true);
+            }
+            catch (...) {  // //NOSONAR  Nobody to report to, the thread must survive
+            }
+        }
+    }
+}
@@ -0,0 +1,64 @@
+/*
+ * Fledge "pivottoopcua" filter plugin.
+ *
+ * Copyright (c) 2020 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include "pivot2opcua_bloom.h"
+
+// System headers
+#include <string.h>
+
+/**************************************************************************/
+BloomFilter::BloomFilter(size_t nbKeys) {
+    if (nbKeys > 0) {
+        const size_t bitsPerBlock(sizeof(Block) * 8);
+        m_blocks.resize((nbKeys * BitsPerKey + bitsPerBlock - 1) / bitsPerBlock);
+        memset(m_blocks.data(), 0, m_blocks.size() * sizeof(Block));
+    }
+}
+
+/** 64-bit FNV-1a, with a final mix so that all bits depend on all input bytes */
+uint64_t
+BloomFilter::hash(const std::string& key) {
+    uint64_t result(0xCBF29CE484222325ULL);
+    for (const char c : key) {
+        result = (result ^ static_cast<uint8_t>(c)) * 0x100000001B3ULL;
+    }
+    result ^= result >> 33;
+    result *= 0xFF51AFD7ED558CCDULL;
+    result ^= result >> 33;
+    return result;
+}
+
+void
+BloomFilter::add(const std::string& key) {
+    if (m_blocks.empty()) return;
+    const uint64_t h(hash(key));
+    Block& block(m_blocks[(h >> 32) % m_blocks.size()]);
+    // Bit positions (9 bits each) are derived from the low half of the hash
+    uint32_t bits(static_cast<uint32_t>(h));
+    const uint32_t step((bits >> 16) | 1);
+    for (unsigned i = 0 ; i < NbHashes ; i++) {
+        const uint32_t bit(bits & 511);
+        block.words[bit >> 6] |= uint64_t(1) << (bit & 63);
+        bits += step;
+    }
+}
+
+bool
+BloomFilter::mayContain(const std::string& key)const {
+    if (m_blocks.empty()) return false;
+    const uint64_t h(hash(key));
+    const Block& block(m_blocks[(h >> 32) % m_blocks.size()]);
+    uint32_t bits(static_cast<uint32_t>(h));
+    const uint32_t step((bits >> 16) | 1);
+    for (unsigned i = 0 ; i < NbHashes ; i++) {
+        const uint32_t bit(bits & 511);
+        if ((block.words[bit >> 6] & (uint64_t(1) << (bit & 63))) == 0) return false;
+        bits += step;
+    }
+    return true;
+}
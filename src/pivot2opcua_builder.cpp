@@ -0,0 +1,64 @@
+/*
+ * Fledge "pivottoopcua" filter plugin.
+ *
+ * Copyright (c) 2020 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include "pivot2opcua_builder.h"
+
+// System headers
+#include <utility>
+
+/**************************************************************************/
+DictionaryBuilder::~DictionaryBuilder(void) {
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_stop = true;
+        m_pending = nullptr;
+        m_cancel = true;
+    }
+    m_cond.notify_all();
+    if (m_thread.joinable()) m_thread.join();
+}
+
+void
+DictionaryBuilder::submit(Job_t job) {
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_pending = std::move(job);
+        // The running job (if any) is obsolete
+        m_cancel = true;
+        if (!m_thread.joinable()) m_thread = std::thread(&DictionaryBuilder::run, this);
+    }
+    m_cond.notify_all();
+}
+
+void
+DictionaryBuilder::waitIdle(void) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cond.wait(lock, [this]() {return !m_running && m_pending == nullptr;});
+}
+
+void
+DictionaryBuilder::run(void) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_cond.wait(lock, [this]() {return m_stop || m_pending != nullptr;});
+        if (m_stop) return;
+        Job_t job(std::move(m_pending));
+        m_pending = nullptr;
+        m_cancel = false;
+        m_running = true;
+        lock.unlock();
+        try {
+            job(m_cancel);
+        }
+        catch (...) {  // //NOSONAR  Jobs report their own errors, the thread must survive
+        }
+        lock.lock();
+        m_running = false;
+        m_cond.notify_all();
+    }
+}
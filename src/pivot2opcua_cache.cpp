@@ -0,0 +1,112 @@
+/*
+ * Fledge "pivottoopcua" filter plugin.
+ *
+ * Copyright (c) 2020 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include "pivot2opcua_cache.h"
+
+// System headers
+#include <exception>
+#include <future>
+#include <map>
+#include <mutex>
+#include <utility>
+
+// Project headers
+#include "pivot2opcua_common.h"
+
+namespace {
+
+using Key_t = std::pair<uint64_t, size_t>;
+
+struct Slot {
+    std::weak_ptr<const DataDictionnary>            dictionnary;
+    std::shared_future<DataDictionnary_SharedPtr>   pending;    /// Valid while being built
+};
+
+/** Cache content. Allocated once and never freed, so that it outlives all filter instances */
+struct Cache {
+    std::mutex              mutex;
+    std::map<Key_t, Slot>   slots;
+};
+
+Cache& cache(void) {
+    static Cache* instance(new Cache);  // //NOSONAR (process lifetime)
+    return *instance;
+}
+
+/** Remove the slots of dictionnaries no more in use. Called with the lock held */
+void prune(std::map<Key_t, Slot>* slots) {
+    for (std::map<Key_t, Slot>::iterator it(slots->begin()) ; it != slots->end() ;) {
+        if (!it->second.pending.valid() && it->second.dictionnary.expired()) {
+            it = slots->erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+}   // namespace
+
+/**************************************************************************/
+DataDictionnary_SharedPtr
+DictionaryCache::get(uint64_t configHash, size_t configSize, const Builder_t& builder) {
+    Cache& instance(cache());
+    const Key_t key(configHash, configSize);
+    std::promise<DataDictionnary_SharedPtr> promise;
+    for (;;) {
+        std::shared_future<DataDictionnary_SharedPtr> pending;
+        {
+            std::lock_guard<std::mutex> guard(instance.mutex);
+            prune(&instance.slots);
+            Slot& slot(instance.slots[key]);
+            const DataDictionnary_SharedPtr result(slot.dictionnary.lock());
+            if (result != nullptr) {
+                LOG_INFO("Exchanged data: already in use, shared");
+                return result;
+            }
+            if (slot.pending.valid()) {
+                pending = slot.pending;
+            } else {
+                slot.pending = promise.get_future().share();
+            }
+        }
+        if (!pending.valid()) break;
+        // Being built by another instance
+        try {
+            return pending.get();
+        }
+        catch (const DataDictionnary::BuildCancelled&) {
+            // The other build is obsolete for its instance, not for this one
+        }
+    }
+
+    DataDictionnary_SharedPtr result;
+    try {
+        result = DataDictionnary_SharedPtr(builder());
+    }
+    catch (...) {
+        std::lock_guard<std::mutex> guard(instance.mutex);
+        instance.slots.erase(key);
+        promise.set_exception(std::current_exception());
+        throw;
+    }
+    std::lock_guard<std::mutex> guard(instance.mutex);
+    Slot& slot(instance.slots[key]);
+    slot.dictionnary = result;
+    slot.pending = std::shared_future<DataDictionnary_SharedPtr>();
+    promise.set_value(result);
+    return result;
+}
+
+/**************************************************************************/
+size_t
+DictionaryCache::size(void) {
+    Cache& instance(cache());
+    std::lock_guard<std::mutex> guard(instance.mutex);
+    prune(&instance.slots);
+    return instance.slots.size();
+}
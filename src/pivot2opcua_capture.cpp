@@ -0,0 +1,479 @@
+/*
+ * Fledge "pivottoopcua" filter plugin.
+ *
+ * Copyright (c) 2020 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include "pivot2opcua_capture.h"
+
+// System headers
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+// Project headers
+#include "pivot2opcua_common.h"
+
+namespace {
+using Datapoints = std::vector<Datapoint*>;
+
+const char CaptureMagic[8] = "P2OCAPT";
+const size_t HeaderSize = 64;
+const uint64_t MinCaptureSize = 64 * 1024;
+const unsigned MaxDecodeDepth = 64;
+
+/** Serialization sink only computing the encoded size */
+class SizeSink {
+ public:
+    void byte(uint8_t) {m_size++;}
+    void bytes(const void*, size_t len) {m_size += len;}
+    size_t size(void)const {return m_size;}
+ private:
+    size_t m_size = 0;
+};
+
+/** Serialization sink writing to a memory area known to be large enough */
+class MemSink {
+ public:
+    explicit MemSink(uint8_t* ptr): m_ptr(ptr) {}
+    void byte(uint8_t b) {*m_ptr++ = b;}
+    void bytes(const void* src, size_t len) {
+        memcpy(m_ptr, src, len);
+        m_ptr += len;
+    }
+ private:
+    uint8_t* m_ptr;
+};
+
+template <class Sink>
+void putVarint(Sink* sink, uint64_t value) {
+    while (value >= 0x80) {
+        sink->byte(static_cast<uint8_t>(value) | 0x80);
+        value >>= 7;
+    }
+    sink->byte(static_cast<uint8_t>(value));
+}
+
+template <class Sink>
+void putSigned(Sink* sink, int64_t value) {
+    putVarint(sink, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+}
+
+template <class Sink>
+void putString(Sink* sink, const std::string& str) {
+    putVarint(sink, str.size());
+    sink->bytes(str.data(), str.size());
+}
+
+template <class Sink>
+void putDatapoint(Sink* sink, Datapoint* dp) {
+    putString(sink, dp->getName());
+    DatapointValue& value(dp->getData());
+    const DatapointValue::dataTagType type(value.getType());
+    sink->byte(static_cast<uint8_t>(type));
+    switch (type) {
+    case DatapointValue::T_STRING:
+        putString(sink, value.toStringValue());
+        break;
+    case DatapointValue::T_INTEGER:
+        putSigned(sink, static_cast<int64_t>(value.toInt()));
+        break;
+    case DatapointValue::T_FLOAT: {
+        const double d(value.toDouble());
+        sink->bytes(&d, sizeof(d));
+        break;
+    }
+    case DatapointValue::T_FLOAT_ARRAY: {
+        const std::vector<double>* array(value.getDpArr());
+        putVarint(sink, array->size());
+        sink->bytes(array->data(), array->size() * sizeof(double));
+        break;
+    }
+    case DatapointValue::T_DP_DICT:
+    case DatapointValue::T_DP_LIST: {
+        const Datapoints* children(value.getDpVec());
+        putVarint(sink, children->size());
+        for (Datapoint* child : *children) {
+            putDatapoint(sink, child);
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+template <class Sink>
+void putReading(Sink* sink, Reading* reading) {
+    struct timeval tv;
+    putString(sink, reading->getAssetName());
+    reading->getTimestamp(&tv);
+    putSigned(sink, static_cast<int64_t>(tv.tv_sec) * 1000000 + tv.tv_usec);
+    reading->getUserTimestamp(&tv);
+    putSigned(sink, static_cast<int64_t>(tv.tv_sec) * 1000000 + tv.tv_usec);
+    const Datapoints& datapoints(reading->getReadingData());
+    putVarint(sink, datapoints.size());
+    for (Datapoint* dp : datapoints) {
+        putDatapoint(sink, dp);
+    }
+}
+
+/** Bounds-checked reader of an encoded batch */
+class Cursor {
+ public:
+    Cursor(const uint8_t* data, size_t length): m_ptr(data), m_end(data + length) {}
+
+    uint8_t byte(void) {
+        ASSERT(m_ptr < m_end, "Capture: truncated batch");
+        return *m_ptr++;
+    }
+    uint64_t varint(void) {
+        uint64_t value(0);
+        for (unsigned shift = 0 ; shift < 64 ; shift += 7) {
+            const uint8_t b(byte());
+            value |= static_cast<uint64_t>(b & 0x7F) << shift;
+            if ((b & 0x80) == 0) return value;
+        }
+        ASSERT(false, "Capture: invalid varint");
+        return 0;
+    }
+    int64_t signedVarint(void) {
+        const uint64_t value(varint());
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+    void bytes(void* dest, size_t len) {
+        ASSERT(len <= static_cast<size_t>(m_end - m_ptr), "Capture: truncated batch");
+        memcpy(dest, m_ptr, len);
+        m_ptr += len;
+    }
+    std::string string(void) {
+        const uint64_t len(varint());
+        ASSERT(len <= static_cast<uint64_t>(m_end - m_ptr), "Capture: truncated string");
+        const char* begin(reinterpret_cast<const char*>(m_ptr));
+        m_ptr += len;
+        return std::string(begin, len);
+    }
+    size_t remaining(void)const {return static_cast<size_t>(m_end - m_ptr);}
+
+ private:
+    const uint8_t* m_ptr;
+    const uint8_t* m_end;
+};
+
+void deleteDatapoints(Datapoints* datapoints) {
+    for (Datapoint* dp : *datapoints) {
+        delete dp;
+    }
+    datapoints->clear();
+}
+
+Datapoint* decodeDatapoint(Cursor* cursor, unsigned depth) {
+    ASSERT(depth < MaxDecodeDepth, "Capture: datapoints nested too deep");
+    const std::string name(cursor->string());
+    const uint8_t type(cursor->byte());
+    switch (type) {
+    case DatapointValue::T_STRING: {
+        DatapointValue value(cursor->string());
+        return new Datapoint(name, value);
+    }
+    case DatapointValue::T_INTEGER: {
+        DatapointValue value(static_cast<long>(cursor->signedVarint()));  // //NOLINT
+        return new Datapoint(name, value);
+    }
+    case DatapointValue::T_FLOAT: {
+        double d;
+        cursor->bytes(&d, sizeof(d));
+        DatapointValue value(d);
+        return new Datapoint(name, value);
+    }
+    case DatapointValue::T_FLOAT_ARRAY: {
+        const uint64_t count(cursor->varint());
+        ASSERT(count <= cursor->remaining() / sizeof(double), "Capture: truncated array");
+        std::vector<double> array(count);
+        cursor->bytes(array.data(), count * sizeof(double));
+        DatapointValue value(array);
+        return new Datapoint(name, value);
+    }
+    case DatapointValue::T_DP_DICT:
+    case DatapointValue::T_DP_LIST: {
+        const uint64_t count(cursor->varint());
+        ASSERT(count <= cursor->remaining(), "Capture: truncated datapoints");
+        // Children are decoded directly in the datapoint (avoids deep copies)
+        Datapoints* children(new Datapoints);  // //NOSONAR (Use of FLEDGE API)
+        DatapointValue value(children, type == DatapointValue::T_DP_DICT);
+        Datapoint* dp(new Datapoint(name, value));  // //NOSONAR (Use of FLEDGE API)
+        Datapoints* target(dp->getData().getDpVec());
+        try {
+            for (uint64_t i = 0 ; i < count ; i++) {
+                target->push_back(decodeDatapoint(cursor, depth + 1));
+            }
+        } catch (const std::exception&) {
+            delete dp;
+            throw;
+        }
+        return dp;
+    }
+    default: {
+        // Type not captured (e.g. images)
+        DatapointValue value(std::string(""));
+        return new Datapoint(name, value);
+    }
+    }
+}
+
+Reading* decodeReading(Cursor* cursor) {
+    const std::string asset(cursor->string());
+    const int64_t ts(cursor->signedVarint());
+    const int64_t userTs(cursor->signedVarint());
+    const uint64_t count(cursor->varint());
+    ASSERT(count <= cursor->remaining(), "Capture: truncated reading");
+
+    Datapoints datapoints;
+    try {
+        for (uint64_t i = 0 ; i < count ; i++) {
+            datapoints.push_back(decodeDatapoint(cursor, 0));
+        }
+    } catch (const std::exception&) {
+        deleteDatapoints(&datapoints);
+        throw;
+    }
+    Reading* reading(new Reading(asset, datapoints));
+    struct timeval tv;
+    tv.tv_sec = static_cast<time_t>(ts / 1000000);
+    tv.tv_usec = static_cast<suseconds_t>(ts % 1000000);
+    reading->setTimestamp(tv);
+    tv.tv_sec = static_cast<time_t>(userTs / 1000000);
+    tv.tv_usec = static_cast<suseconds_t>(userTs % 1000000);
+    reading->setUserTimestamp(tv);
+    return reading;
+}
+
+/**
+ * @return true if the header describes a valid capture of size 'fileSize'
+ */
+bool isValidHeader(const ReadingCapture::CaptureHeader* header, uint64_t fileSize) {
+    if (memcmp(header->magic, CaptureMagic, sizeof(CaptureMagic)) != 0) return false;
+    if (header->version != ReadingCapture::Version) return false;
+    if (header->indexCapacity == 0 || header->dataCapacity == 0) return false;
+    return fileSize == HeaderSize +
+            header->indexCapacity * sizeof(ReadingCapture::CaptureIndexEntry) + header->dataCapacity;
+}
+}   // namespace
+
+/**************************************************************************/
+ReadingCapture::
+~ReadingCapture(void) {
+    close();
+}
+
+std::string
+ReadingCapture::resolvePath(const std::string& path) {
+    if (path.empty() || path[0] == '/') return path;
+    const char* dataDir(getenv("FLEDGE_DATA"));
+    if (dataDir != nullptr) return std::string(dataDir) + "/" + path;
+    const char* root(getenv("FLEDGE_ROOT"));
+    if (root != nullptr) return std::string(root) + "/data/" + path;
+    return path;
+}
+
+bool
+ReadingCapture::open(const std::string& path, uint64_t sizeBytes) {
+    close();
+    if (sizeBytes < MinCaptureSize) {
+        LOG_ERROR("Capture: size %llu is too small (minimum %llu bytes)",
+                static_cast<unsigned long long>(sizeBytes),  // //NOLINT
+                static_cast<unsigned long long>(MinCaptureSize));  // //NOLINT
+        return false;
+    }
+    // Expect an average batch size of 1kB
+    const uint64_t indexCapacity(sizeBytes / 1024);
+    const uint64_t dataCapacity(sizeBytes - HeaderSize - indexCapacity * sizeof(CaptureIndexEntry));
+
+    m_path = resolvePath(path);
+    m_fd = ::open(m_path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (m_fd < 0) {
+        LOG_ERROR("Capture: cannot open '%s' (%s)", m_path.c_str(), strerror(errno));
+        return false;
+    }
+
+    // Only a new (empty) file or an existing capture may be (re)initialized: any other file is left untouched
+    CaptureHeader existing;
+    struct stat st;
+    if (fstat(m_fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        LOG_ERROR("Capture: '%s' is not a regular file, capture disabled", m_path.c_str());
+        close();
+        return false;
+    }
+    const bool isCapture(st.st_size > 0 &&
+            pread(m_fd, &existing, sizeof(existing), 0) == static_cast<ssize_t>(sizeof(existing)) &&
+            isValidHeader(&existing, static_cast<uint64_t>(st.st_size)));
+    if (st.st_size > 0 && !isCapture) {
+        LOG_ERROR("Capture: '%s' exists and is not a capture file, capture disabled", m_path.c_str());
+        close();
+        return false;
+    }
+    const bool reuse(isCapture && existing.indexCapacity == indexCapacity && existing.dataCapacity == dataCapacity);
+    if (isCapture && !reuse) {
+        LOG_WARNING("Capture: '%s' has another size, previous capture is discarded", m_path.c_str());
+    }
+    if (!reuse && (ftruncate(m_fd, 0) != 0 || ftruncate(m_fd, static_cast<off_t>(sizeBytes)) != 0)) {
+        LOG_ERROR("Capture: cannot resize '%s' (%s)", m_path.c_str(), strerror(errno));
+        close();
+        return false;
+    }
+
+    void* map(mmap(nullptr, sizeBytes, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0));
+    if (map == MAP_FAILED) {
+        LOG_ERROR("Capture: cannot map '%s' (%s)", m_path.c_str(), strerror(errno));
+        close();
+        return false;
+    }
+    m_map = static_cast<uint8_t*>(map);
+    m_mapSize = sizeBytes;
+    m_header = reinterpret_cast<CaptureHeader*>(m_map);
+    m_index = reinterpret_cast<CaptureIndexEntry*>(m_map + HeaderSize);
+    m_data = m_map + HeaderSize + indexCapacity * sizeof(CaptureIndexEntry);
+
+    if (!reuse) {
+        memcpy(m_header->magic, CaptureMagic, sizeof(CaptureMagic));
+        m_header->version = Version;
+        m_header->indexCapacity = static_cast<uint32_t>(indexCapacity);
+        m_header->dataCapacity = dataCapacity;
+        m_header->nextSeq = 0;
+        m_header->writeOffset = 0;
+    }
+    LOG_INFO("Capture: recording input to '%s' (%s, %llu bytes)", m_path.c_str(),
+            reuse ? "appended" : "created", static_cast<unsigned long long>(sizeBytes));  // //NOLINT
+    return true;
+}
+
+void
+ReadingCapture::close(void) {
+    if (m_map != nullptr) {
+        msync(m_map, m_mapSize, MS_ASYNC);
+        munmap(m_map, m_mapSize);
+        LOG_INFO("Capture: closed '%s' (%llu batches, %llu dropped)", m_path.c_str(),
+                static_cast<unsigned long long>(m_batches),  // //NOLINT
+                static_cast<unsigned long long>(m_dropped));  // //NOLINT
+    }
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+    m_fd = -1;
+    m_map = nullptr;
+    m_mapSize = 0;
+    m_header = nullptr;
+    m_index = nullptr;
+    m_data = nullptr;
+}
+
+bool
+ReadingCapture::capture(ReadingSet* readingSet, int64_t captureTimeUs) {
+    if (!isOpen()) return false;
+    std::vector<Reading*>* readings(readingSet->getAllReadingsPtr());
+    if (readings->empty()) return true;
+
+    SizeSink sizer;
+    for (Reading* reading : *readings) {
+        putReading(&sizer, reading);
+    }
+    const uint64_t length(sizer.size());
+    const uint64_t capacity(m_header->dataCapacity);
+    if (length > capacity || length > UINT32_MAX) {
+        m_dropped++;
+        return false;
+    }
+
+    // Keep the batch contiguous: skip the end of the ring if needed
+    uint64_t offset(m_header->writeOffset);
+    if (offset % capacity + length > capacity) {
+        offset += capacity - offset % capacity;
+    }
+    MemSink sink(m_data + offset % capacity);
+    for (Reading* reading : *readings) {
+        putReading(&sink, reading);
+    }
+
+    // Publish the batch once its content is written
+    CaptureIndexEntry& entry(m_index[m_header->nextSeq % m_header->indexCapacity]);
+    entry.seq = m_header->nextSeq;
+    entry.offset = offset;
+    entry.length = static_cast<uint32_t>(length);
+    entry.nbReadings = static_cast<uint32_t>(readings->size());
+    entry.captureTimeUs = captureTimeUs;
+    m_header->writeOffset = offset + length;
+    m_header->nextSeq++;
+
+    m_batches++;
+    m_bytes += length;
+    return true;
+}
+
+bool
+ReadingCapture::readFile(const std::string& path, const BatchHandler_t& handler) {
+    const std::string fullPath(resolvePath(path));
+    const int fd(::open(fullPath.c_str(), O_RDONLY));
+    if (fd < 0) {
+        LOG_ERROR("Capture: cannot open '%s' (%s)", fullPath.c_str(), strerror(errno));
+        return false;
+    }
+    struct stat st;
+    void* map(MAP_FAILED);
+    if (fstat(fd, &st) == 0 && static_cast<uint64_t>(st.st_size) >= HeaderSize) {
+        map = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        LOG_ERROR("Capture: cannot map '%s'", fullPath.c_str());
+        return false;
+    }
+
+    const uint8_t* base(static_cast<const uint8_t*>(map));
+    const CaptureHeader* header(reinterpret_cast<const CaptureHeader*>(base));
+    const bool valid(isValidHeader(header, static_cast<uint64_t>(st.st_size)));
+    if (valid) {
+        const CaptureIndexEntry* index(reinterpret_cast<const CaptureIndexEntry*>(base + HeaderSize));
+        const uint8_t* data(base + HeaderSize + header->indexCapacity * sizeof(CaptureIndexEntry));
+        const uint64_t capacity(header->dataCapacity);
+        // Oldest data still present in the ring
+        const uint64_t minOffset(header->writeOffset > capacity ? header->writeOffset - capacity : 0);
+        const uint64_t firstSeq(header->nextSeq > header->indexCapacity ?
+                header->nextSeq - header->indexCapacity : 0);
+
+        for (uint64_t seq = firstSeq ; seq < header->nextSeq ; seq++) {
+            const CaptureIndexEntry& entry(index[seq % header->indexCapacity]);
+            if (entry.seq != seq || entry.offset < minOffset) continue;
+            if (entry.offset % capacity + entry.length > capacity) continue;
+            handler(entry, data + entry.offset % capacity);
+        }
+    } else {
+        LOG_ERROR("Capture: '%s' is not a valid capture file", fullPath.c_str());
+    }
+    munmap(map, static_cast<size_t>(st.st_size));
+    return valid;
+}
+
+std::vector<Reading*>
+ReadingCapture::decodeBatch(const uint8_t* data, size_t length, uint32_t nbReadings) {
+    Cursor cursor(data, length);
+    std::vector<Reading*> readings;
+    readings.reserve(nbReadings);
+    try {
+        for (uint32_t i = 0 ; i < nbReadings ; i++) {
+            readings.push_back(decodeReading(&cursor));
+        }
+    } catch (const std::exception&) {
+        for (Reading* reading : readings) {
+            delete reading;
+        }
+        throw;
+    }
+    return readings;
+}
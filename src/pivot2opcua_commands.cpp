@@ -0,0 +1,182 @@
+/*
+ * Fledge "pivottoopcua" filter plugin.
+ *
+ * Copyright (c) 2020 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include "pivot2opcua_commands.h"
+
+/**************************************************************************/
+const size_t CommandTracker::WheelSlots;
+const CommandTracker::Index_t CommandTracker::NoEntry;
+
+CommandTracker::
+CommandTracker(void):
+    m_timeoutUs(0),
+    m_tickUs(1),
+    m_lastTick(-1),
+    m_free(NoEntry),
+    m_commands(0),
+    m_untracked(0),
+    m_acks(0),
+    m_nacks(0),
+    m_timeouts(0),
+    m_unmatched(0) {
+    configure(0, 0);
+}
+
+void
+CommandTracker::configure(size_t maxPending, int64_t timeoutUs) {
+    m_timeoutUs = (timeoutUs > 0 && maxPending > 0) ? timeoutUs : 0;
+    // A deadline is never more than (WheelSlots - 1) ticks ahead, so that
+    // a slot only contains commands expiring within the same tick.
+    m_tickUs = m_timeoutUs / (WheelSlots - 1) + 1;
+    m_lastTick = -1;
+
+    m_index.clear();
+    m_index.reserve(m_timeoutUs > 0 ? maxPending : 0);
+    m_entries.assign(m_timeoutUs > 0 ? maxPending : 0, Entry());
+    m_slots.assign(WheelSlots, NoEntry);
+    m_free = NoEntry;
+    for (size_t i = m_entries.size() ; i > 0 ; i--) {
+        m_entries[i - 1].next = m_free;
+        m_free = static_cast<Index_t>(i - 1);
+    }
+}
+
+void
+CommandTracker::link(Index_t idx) {
+    Entry& entry(m_entries[idx]);
+    Index_t& head(m_slots[slotOf(entry.deadlineUs)]);
+    entry.prev = NoEntry;
+    entry.next = head;
+    if (head != NoEntry) m_entries[head].prev = idx;
+    head = idx;
+}
+
+void
+CommandTracker::unlink(Index_t idx) {
+    Entry& entry(m_entries[idx]);
+    if (entry.prev != NoEntry) {
+        m_entries[entry.prev].next = entry.next;
+    } else {
+        m_slots[slotOf(entry.deadlineUs)] = entry.next;
+    }
+    if (entry.next != NoEntry) m_entries[entry.next].prev = entry.prev;
+}
+
+void
+CommandTracker::release(Index_t idx) {
+    Entry& entry(m_entries[idx]);
+    m_index.erase(entry.id);
+    entry.next = m_free;
+    m_free = idx;
+}
+
+void
+CommandTracker::addCommand(const std::string& id, int64_t nowUs) {
+    m_commands++;
+    if (m_timeoutUs == 0) return;
+    expire(nowUs);
+
+    Index_t idx;
+    std::unordered_map<std::string, Index_t>::iterator it(m_index.find(id));
+    if (it != m_index.end()) {
+        // Command sent again before any reply: restart its timer
+        idx = it->second;
+        unlink(idx);
+    } else {
+        if (m_free == NoEntry) {
+            m_untracked++;
+            return;
+        }
+        idx = m_free;
+        m_free = m_entries[idx].next;
+        m_entries[idx].id.assign(id);
+        m_index.emplace(id, idx);
+    }
+    Entry& entry(m_entries[idx]);
+    entry.sentUs = nowUs;
+    entry.deadlineUs = nowUs + m_timeoutUs;
+    link(idx);
+}
+
+void
+CommandTracker::addReply(const std::string& id, bool ack, int64_t nowUs) {
+    if (ack) {
+        m_acks++;
+    } else {
+        m_nacks++;
+    }
+    if (m_timeoutUs == 0) return;
+    expire(nowUs);
+
+    std::unordered_map<std::string, Index_t>::const_iterator it(m_index.find(id));
+    if (it == m_index.end()) {
+        m_unmatched++;
+        return;
+    }
+    const Index_t idx(it->second);
+    const int64_t rtt(nowUs - m_entries[idx].sentUs);
+    (ack ? m_ackLatency : m_nackLatency).add(rtt);
+    unlink(idx);
+    release(idx);
+}
+
+void
+CommandTracker::expireSlot(size_t slot, int64_t nowUs) {
+    Index_t idx(m_slots[slot]);
+    while (idx != NoEntry) {
+        const Index_t next(m_entries[idx].next);
+        // After a long inactivity, a slot may also hold recent commands
+        if (m_entries[idx].deadlineUs <= nowUs) {
+            m_timeouts++;
+            unlink(idx);
+            release(idx);
+        }
+        idx = next;
+    }
+}
+
+void
+CommandTracker::expire(int64_t nowUs) {
+    if (m_timeoutUs == 0) return;
+    // Only ticks strictly before the current one are complete
+    const int64_t lastTick(tickOf(nowUs) - 1);
+    if (m_lastTick < 0 || lastTick - m_lastTick >= static_cast<int64_t>(WheelSlots)) {
+        for (size_t slot = 0 ; slot < WheelSlots ; slot++) {
+            expireSlot(slot, nowUs);
+        }
+    } else {
+        for (int64_t tick = m_lastTick + 1 ; tick <= lastTick ; tick++) {
+            expireSlot(static_cast<size_t>(tick % WheelSlots), nowUs);
+        }
+    }
+    if (lastTick > m_lastTick) m_lastTick = lastTick;
+}
+
+void
+CommandTracker::toJson(JsonWriter_t* writer)const {
+    writer->StartObject();
+    writer->Key("commands");
+    writer->Uint64(m_commands);
+    writer->Key("pending");
+    writer->Uint64(pending());
+    writer->Key("untracked");
+    writer->Uint64(m_untracked);
+    writer->Key("acks");
+    writer->Uint64(m_acks);
+    writer->Key("nacks");
+    writer->Uint64(m_nacks);
+    writer->Key("timeouts");
+    writer->Uint64(m_timeouts);
+    writer->Key("unmatched_replies");
+    writer->Uint64(m_unmatched);
+    writer->Key("ack_latency");
+    m_ackLatency.toJson(writer);
+    writer->Key("nack_latency");
+    m_nackLatency.toJson(writer);
+    writer->EndObject();
+}
@@ -0,0 +1,67 @@
+/*
+ * Fledge "pivottoopcua" filter plugin.
+ *
+ * Copyright (c) 2020 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include "pivot2opcua_compact.h"
+
+// System headers
+#include <stddef.h>
+
+namespace {
+
+struct Table {
+    const char* const*  values;
+    size_t              size;
+};
+
+const char* const ComingFromValues[] = {"iec104", "iec61850", "opcua"};
+const char* const OpcTypeValues[] = {"opcua_sps", "opcua_dps", "opcua_mvi", "opcua_mvf", "opcua_spc", "opcua_dpc",
+        "opcua_inc", "opcua_apc", "opcua_bsc"};
+const char* const ValidityValues[] = {"good", "invalid", "reserved", "questionable"};
+const char* const SourceValues[] = {"process", "substituted"};
+const char* const TmOrgValues[] = {"genuine", "substituted"};
+
+#define TABLE(values) Table{values, sizeof(values) / sizeof(values[0])}
+
+Table tableOf(CompactLayout::Field field) {
+    switch (field) {
+    case CompactLayout::Field::ComingFrom:
+        return TABLE(ComingFromValues);
+    case CompactLayout::Field::OpcType:
+        return TABLE(OpcTypeValues);
+    case CompactLayout::Field::Validity:
+        return TABLE(ValidityValues);
+    case CompactLayout::Field::Source:
+        return TABLE(SourceValues);
+    default:
+        return TABLE(TmOrgValues);
+    }
+}
+
+#undef TABLE
+
+}   // namespace
+
+const int64_t CompactLayout::Version;
+
+/**************************************************************************/
+int64_t
+CompactLayout::encode(Field field, const std::string& value) {
+    const Table table(tableOf(field));
+    for (size_t i = 0 ; i < table.size ; i++) {
+        if (value == table.values[i]) return static_cast<int64_t>(i);
+    }
+    return -1;
+}
+
+/**************************************************************************/
+const char*
+CompactLayout::decode(Field field, int64_t code) {
+    const Table table(tableOf(field));
+    if (code < 0 || static_cast<uint64_t>(code) >= table.size) return nullptr;
+    return table.values[code];
+}
@@ -11,13 +11,23 @@
 #include "pivot2opcua_data.h"
 
 // System headers
+#include <ctype.h>
+#include <string.h>
 #include <vector>
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <tuple>
 
 // Fledge headers
 #include "logger.h"
 #include "reading_set.h"
 #include "rapidjson/document.h"
+#include "rapidjson/reader.h"
 
 // Project headers
 #include "pivot2opcua_common.h"
@@ -30,110 +40,668 @@ using std::vector;
 namespace {
 
 /**************************************************************************/
-string getString(const Value& value,
-        const char* section, const string& context) {
-    ASSERT(value.HasMember(section), "Missing STRING '%s' in '%s'",
-            section, context.c_str());
-    const Value& object(value[section]);
-    ASSERT(object.IsString(), "Error :'%s' in '%s' must be an STRING",
-            section, context.c_str());
-    return object.GetString();
+bool isKey(const char* str, rapidjson::SizeType length, const char* key) {
+    return strlen(key) == length && memcmp(str, key, length) == 0;
 }
 
 /**************************************************************************/
-const Value& getObject(const Value& value,
-        const char* section, const string& context) {
-    ASSERT(value.HasMember(section), "Missing OBJECT '%s' in '%s'",
-            section, context.c_str());
-    const Value& object(value[section]);
-    ASSERT(object.IsObject(), "Error :'%s' in '%s' must be an OBJECT",
-            section, context.c_str());
-    return object;
+/** A dictionnary entry parsed by a worker thread, before being merged */
+struct ParsedEntry {
+    string pivotId;
+    string pivotType;
+    string opcType;
+    string address;
+    OpcuaMappings_t mappings;
+};
+
+/** Number of duplicate pivot ids logged individually */
+const size_t MaxDuplicateLogs = 10;
+
+/**************************************************************************/
+/** Insert an entry, keeping the first one for a given pivot id */
+void insertEntry(PivotElementMap_t* map, size_t* duplicates,
+        string pivotId, string pivotType, string opcType, string address, OpcuaMappings_t mappings) {
+    const std::pair<PivotElementMap_t::iterator, bool> result(map->emplace(std::piecewise_construct,
+            std::forward_as_tuple(std::move(pivotId)),
+            std::forward_as_tuple(std::move(pivotType), std::move(opcType), std::move(address),
+                    std::move(mappings))));
+    if (!result.second) {
+        (*duplicates)++;
+        if (*duplicates <= MaxDuplicateLogs) {
+            LOG_WARNING("Duplicate pivot id '%s' in '%s' ignored", result.first->first.c_str(), JSON_EXCHANGED_DATA);
+        }
+    }
 }
 
 /**************************************************************************/
-Value::ConstArray getArray(const Value& value,
-        const char* section, const string& context) {
-    ASSERT(value.HasMember(section), "Missing ARRAY '%s' in '%s'",
-            section, context.c_str());
-    const Value& object(value[section]);
-    ASSERT(object.IsArray(), "Error :'%s' in '%s' must be an ARRAY",
-            section, context.c_str());
-    return object.GetArray();
+/**
+ * rapidjson SAX handler building the dictionnary in a single pass, without DOM.
+ * Only "opcua" protocols are kept. Checks are the same as a DOM-based parsing:
+ * a std::exception is thrown on any invalid content.
+ * Members of a datapoint may appear in any order, so that the datapoint is
+ * only inserted when its object is complete.
+ */
+class ExchangedDataHandler {
+ public:
+    using Ch = char;
+    using SizeType = rapidjson::SizeType;
+
+    /** Parsing of a full "exchanged_data" document, entries are inserted in 'map' */
+    ExchangedDataHandler(PivotElementMap_t* map, size_t* duplicates, const std::atomic<bool>* cancel):
+        m_map(map), m_duplicates(duplicates), m_entries(nullptr), m_cancel(cancel) {}
+    /** Parsing of an array of datapoints only, entries are appended to 'entries' */
+    ExchangedDataHandler(std::vector<ParsedEntry>* entries, const std::atomic<bool>* cancel):
+        m_map(nullptr), m_duplicates(nullptr), m_entries(entries), m_cancel(cancel), m_item(Item::Datapoints) {}
+
+    /** Checks that the document contained the mandatory sections */
+    void checkComplete(void)const {
+        ASSERT(m_context == Context::Document && m_hasExchangedData,
+                "Missing OBJECT '%s' in '%s'", JSON_EXCHANGED_DATA, JSON_EXCHANGED_DATA);
+    }
+
+    bool Null(void) {return scalar();}
+    bool Bool(bool) {return scalar();}
+    bool Int(int) {return scalar();}
+    bool Uint(unsigned) {return scalar();}
+    bool Int64(int64_t) {return scalar();}
+    bool Uint64(uint64_t) {return scalar();}
+    bool Double(double) {return scalar();}
+    bool RawNumber(const Ch*, SizeType, bool) {return scalar();}
+    bool String(const Ch* str, SizeType length, bool copy);
+    bool Key(const Ch* str, SizeType length, bool copy);
+    bool StartObject(void);
+    bool EndObject(SizeType);
+    bool StartArray(void);
+    bool EndArray(SizeType);
+
+ private:
+    /** Current container being parsed */
+    enum class Context {Document, Root, ExchangedData, Datapoints, Datapoint, Protocols, Protocol};
+    /** Meaning of the next value (set by the previous key) */
+    enum class Item {None, Skip, ExchangedData, Version, Datapoints, Label, PivotId, PivotType, Protocols,
+        Name, Address, TypeId};
+
+    bool scalar(void);
+    void typeError(const char* expected)const;
+    void endProtocol(void);
+    void endDatapoint(void);
+    void endExchangedData(void)const;
+
+    PivotElementMap_t*  m_map;
+    size_t*             m_duplicates;
+    vector<ParsedEntry>* m_entries;
+    const std::atomic<bool>* m_cancel;
+    Context             m_context = Context::Document;
+    Item                m_item = Item::None;
+    unsigned            m_skipDepth = 0;    /// Depth in an ignored container
+    bool                m_hasExchangedData = false;
+    bool                m_hasVersion = false;
+    bool                m_hasDatapoints = false;
+    string              m_version;
+    // Current datapoint
+    bool                m_hasLabel = false;
+    bool                m_hasPivotId = false;
+    bool                m_hasPivotType = false;
+    bool                m_hasProtocols = false;
+    string              m_pivotId;
+    string              m_pivotType;
+    vector<string>      m_typeIds;      /// opcua "typeid" of the datapoint
+    vector<string>      m_addresses;    /// opcua "address" of the datapoint (same rank as m_typeIds)
+    size_t              m_nbTypeIds = 0;
+    // Current protocol
+    bool                m_hasName = false;
+    bool                m_isOpcua = false;
+    bool                m_hasAddress = false;
+    bool                m_hasTypeId = false;
+    string              m_typeId;
+    string              m_address;
+};
+
+/**************************************************************************/
+void
+ExchangedDataHandler::typeError(const char* expected)const {
+    switch (m_item) {
+    case Item::ExchangedData:
+        ASSERT(false, "Error :'%s' in '%s' must be an %s", JSON_EXCHANGED_DATA, JSON_EXCHANGED_DATA, expected);
+        break;
+    case Item::Version:
+        ASSERT(false, "Error :'%s' in '%s' must be an %s", JSON_VERSION, JSON_EXCHANGED_DATA, expected);
+        break;
+    case Item::Datapoints:
+        ASSERT(false, "Error :'%s' in '%s' must be an %s", JSON_DATAPOINTS, JSON_EXCHANGED_DATA, expected);
+        break;
+    case Item::Label:
+        ASSERT(false, "Error :'%s' in '%s' must be an %s", JSON_LABEL, JSON_DATAPOINTS, expected);
+        break;
+    case Item::PivotId:
+        ASSERT(false, "Error :'%s' in '%s' must be an %s", JSON_PIVOT_ID, JSON_DATAPOINTS, expected);
+        break;
+    case Item::PivotType:
+        ASSERT(false, "Error :'%s' in '%s' must be an %s", JSON_PIVOT_TYPE, JSON_DATAPOINTS, expected);
+        break;
+    case Item::Protocols:
+        ASSERT(false, "Error :'%s' in '%s' must be an %s", JSON_PROTOCOLS, JSON_DATAPOINTS, expected);
+        break;
+    case Item::Name:
+        ASSERT(false, "datapoint protocol description must have a 'name' key defining a STRING");
+        break;
+    default:
+        ASSERT(m_context != Context::Document, "Missing OBJECT '%s' in '%s'",
+                JSON_EXCHANGED_DATA, JSON_EXCHANGED_DATA);
+        ASSERT(m_context != Context::Datapoints, "Error : '%s' items must be OBJECT", JSON_DATAPOINTS);
+        ASSERT(false, "datapoint protocol description must be JSON");
+        break;
+    }
 }
 
-}   // namespace
+/**************************************************************************/
+bool
+ExchangedDataHandler::scalar(void) {
+    if (m_skipDepth > 0) return true;
+    switch (m_item) {
+    case Item::Skip:
+        break;
+    case Item::Address:     // Only checked for opcua protocols
+        m_hasAddress = false;
+        break;
+    case Item::TypeId:
+        m_hasTypeId = false;
+        break;
+    default:
+        typeError(m_item == Item::ExchangedData ? "OBJECT" :
+                (m_item == Item::Datapoints || m_item == Item::Protocols) ? "ARRAY" : "STRING");
+        break;
+    }
+    m_item = Item::None;
+    return true;
+}
+
+/**************************************************************************/
+bool
+ExchangedDataHandler::String(const Ch* str, SizeType length, bool) {
+    if (m_skipDepth > 0) return true;
+    switch (m_item) {
+    case Item::Skip:
+        break;
+    case Item::Version:
+        m_hasVersion = true;
+        m_version.assign(str, length);
+        break;
+    case Item::Label:
+        m_hasLabel = true;
+        break;
+    case Item::PivotId:
+        m_hasPivotId = true;
+        m_pivotId.assign(str, length);
+        break;
+    case Item::PivotType:
+        m_hasPivotType = true;
+        m_pivotType.assign(str, length);
+        break;
+    case Item::Name:
+        m_hasName = true;
+        m_isOpcua = isKey(str, length, PROTOCOL_S2OPC);
+        break;
+    case Item::Address:
+        m_hasAddress = true;
+        m_address.assign(str, length);
+        break;
+    case Item::TypeId:
+        m_hasTypeId = true;
+        m_typeId.assign(str, length);
+        break;
+    default:
+        return scalar();
+    }
+    m_item = Item::None;
+    return true;
+}
+
+/**************************************************************************/
+bool
+ExchangedDataHandler::Key(const Ch* str, SizeType length, bool) {
+    if (m_skipDepth > 0) return true;
+    m_item = Item::Skip;
+    switch (m_context) {
+    case Context::Root:
+        if (isKey(str, length, JSON_EXCHANGED_DATA)) m_item = Item::ExchangedData;
+        break;
+    case Context::ExchangedData:
+        if (isKey(str, length, JSON_VERSION)) m_item = Item::Version;
+        else if (isKey(str, length, JSON_DATAPOINTS)) m_item = Item::Datapoints;
+        break;
+    case Context::Datapoint:
+        if (isKey(str, length, JSON_LABEL)) m_item = Item::Label;
+        else if (isKey(str, length, JSON_PIVOT_ID)) m_item = Item::PivotId;
+        else if (isKey(str, length, JSON_PIVOT_TYPE)) m_item = Item::PivotType;
+        else if (isKey(str, length, JSON_PROTOCOLS)) m_item = Item::Protocols;
+        break;
+    case Context::Protocol:
+        if (isKey(str, length, JSON_PROT_NAME)) m_item = Item::Name;
+        else if (isKey(str, length, JSON_PROT_ADDR)) m_item = Item::Address;
+        else if (isKey(str, length, JSON_PROT_TYPEID)) m_item = Item::TypeId;
+        break;
+    default:
+        break;
+    }
+    return true;
+}
 
+/**************************************************************************/
+bool
+ExchangedDataHandler::StartObject(void) {
+    if (m_skipDepth > 0) {
+        m_skipDepth++;
+        return true;
+    }
+    switch (m_item) {
+    case Item::ExchangedData:
+        m_hasExchangedData = true;
+        m_context = Context::ExchangedData;
+        break;
+    case Item::None:
+        if (m_context == Context::Document) {
+            m_context = Context::Root;
+        } else if (m_context == Context::Datapoints) {
+            m_context = Context::Datapoint;
+            m_hasLabel = m_hasPivotId = m_hasPivotType = m_hasProtocols = false;
+            m_nbTypeIds = 0;
+        } else {
+            m_context = Context::Protocol;
+            m_hasName = m_isOpcua = m_hasAddress = m_hasTypeId = false;
+        }
+        break;
+    case Item::Skip:
+    case Item::Address:
+    case Item::TypeId:
+        // Ignored value (or invalid address/typeid, only checked for opcua protocols)
+        (void)scalar();
+        m_skipDepth = 1;
+        break;
+    default:
+        typeError((m_item == Item::Datapoints || m_item == Item::Protocols) ? "ARRAY" : "STRING");
+        break;
+    }
+    m_item = Item::None;
+    return true;
+}
 
 /**************************************************************************/
-ExchangedDataC::
-ExchangedDataC(const rapidjson::Value& json):
-mPreCheck(internalChecks(json)),
-address(json[JSON_PROT_ADDR].GetString()),
-typeId(json[JSON_PROT_TYPEID].GetString()) {
+bool
+ExchangedDataHandler::StartArray(void) {
+    if (m_skipDepth > 0) {
+        m_skipDepth++;
+        return true;
+    }
+    switch (m_item) {
+    case Item::Datapoints:
+        m_hasDatapoints = true;
+        m_context = Context::Datapoints;
+        break;
+    case Item::Protocols:
+        m_hasProtocols = true;
+        m_context = Context::Protocols;
+        break;
+    case Item::Skip:
+    case Item::Address:
+    case Item::TypeId:
+        // Ignored value (or invalid address/typeid, only checked for opcua protocols)
+        (void)scalar();
+        m_skipDepth = 1;
+        break;
+    default:
+        typeError(m_item == Item::ExchangedData ? "OBJECT" : "STRING");
+        break;
+    }
+    m_item = Item::None;
+    return true;
 }
 
+/**************************************************************************/
 bool
-ExchangedDataC::internalChecks(const rapidjson::Value& json)const {
-    ASSERT(json.IsObject(), "datapoint protocol description must be JSON");
-    ASSERT(json.HasMember(JSON_PROT_NAME) && json[JSON_PROT_NAME].IsString()
-            , "datapoint protocol description must have a 'name' key defining a STRING");
-    const string protocolName(json[JSON_PROT_NAME].GetString());
-    if (protocolName != PROTOCOL_S2OPC) {
-        throw NotAnS2opcInstance();
-    }
-    ASSERT(json.HasMember(JSON_PROT_ADDR) && json[JSON_PROT_ADDR].IsString()
-            , "datapoint protocol description must have a '%s' key defining a STRING",
-            JSON_PROT_ADDR);
-    ASSERT(json.HasMember(JSON_PROT_TYPEID) && json[JSON_PROT_TYPEID].IsString()
-            , "datapoint protocol description must have a '%s' key defining a STRING",
-            JSON_PROT_TYPEID);
+ExchangedDataHandler::EndObject(SizeType) {
+    if (m_skipDepth > 0) {
+        m_skipDepth--;
+        return true;
+    }
+    switch (m_context) {
+    case Context::Protocol:
+        endProtocol();
+        m_context = Context::Protocols;
+        break;
+    case Context::Datapoint:
+        endDatapoint();
+        m_context = Context::Datapoints;
+        break;
+    case Context::ExchangedData:
+        endExchangedData();
+        m_context = Context::Root;
+        break;
+    default:
+        m_context = Context::Document;
+        break;
+    }
     return true;
 }
 
 /**************************************************************************/
-DataDictionnary::
-DataDictionnary(const string& jsonExData) {
-    rapidjson::Document doc;
-    doc.Parse(jsonExData.c_str());
-    ASSERT(!doc.HasParseError(),
-            "Malformed JSON (section '%s', index = %u, near %50s)",
-            JSON_EXCHANGED_DATA, doc.GetErrorOffset(),
-            jsonExData.c_str() + doc.GetErrorOffset());
+bool
+ExchangedDataHandler::EndArray(SizeType) {
+    if (m_skipDepth > 0) {
+        m_skipDepth--;
+        return true;
+    }
+    m_context = (m_context == Context::Protocols ? Context::Datapoint : Context::ExchangedData);
+    return true;
+}
+
+/**************************************************************************/
+void
+ExchangedDataHandler::endProtocol(void) {
+    ASSERT(m_hasName, "datapoint protocol description must have a 'name' key defining a STRING");
+    // Only consider matching protocol ("opcua")
+    if (!m_isOpcua) return;
+    ASSERT(m_hasAddress, "datapoint protocol description must have a '%s' key defining a STRING",
+            JSON_PROT_ADDR);
+    ASSERT(m_hasTypeId, "datapoint protocol description must have a '%s' key defining a STRING",
+            JSON_PROT_TYPEID);
+    // Buffers are reused from one datapoint to the other
+    if (m_nbTypeIds == m_typeIds.size()) {
+        m_typeIds.emplace_back();
+        m_addresses.emplace_back();
+    }
+    m_addresses[m_nbTypeIds].swap(m_address);
+    m_typeIds[m_nbTypeIds++].swap(m_typeId);
+}
 
-    // Parse "exchanged_data" section
-    const Value& exData(::getObject(doc, JSON_EXCHANGED_DATA, JSON_EXCHANGED_DATA));
-    const Value::ConstArray datapoints(::getArray(exData, JSON_DATAPOINTS, JSON_EXCHANGED_DATA));
+/**************************************************************************/
+void
+ExchangedDataHandler::endDatapoint(void) {
+    ASSERT(m_hasLabel, "Missing STRING '%s' in '%s'", JSON_LABEL, JSON_DATAPOINTS);
+    ASSERT(m_hasPivotId, "Missing STRING '%s' in '%s'", JSON_PIVOT_ID, JSON_DATAPOINTS);
+    ASSERT(m_hasPivotType, "Missing STRING '%s' in '%s'", JSON_PIVOT_TYPE, JSON_DATAPOINTS);
+    ASSERT(m_hasProtocols, "Missing ARRAY '%s' in '%s'", JSON_PROTOCOLS, JSON_DATAPOINTS);
+    if (m_cancel != nullptr && m_cancel->load(std::memory_order_relaxed)) {
+        throw DataDictionnary::BuildCancelled();
+    }
+    if (m_nbTypeIds == 0) return;
+    // Several "opcua" protocols: one element, published to all of them
+    OpcuaMappings_t mappings;
+    if (m_nbTypeIds > 1) {
+        for (size_t i = 0 ; i < m_nbTypeIds ; i++) {
+            mappings.push_back(OpcuaMapping{m_typeIds[i], m_addresses[i]});
+        }
+    }
+    // Insert element
+    if (m_entries != nullptr) {
+        m_entries->push_back(ParsedEntry{m_pivotId, m_pivotType, m_typeIds[0], m_addresses[0], std::move(mappings)});
+    } else {
+        insertEntry(m_map, m_duplicates, m_pivotId, m_pivotType, m_typeIds[0], m_addresses[0], std::move(mappings));
+    }
+}
 
+/**************************************************************************/
+void
+ExchangedDataHandler::endExchangedData(void)const {
+    ASSERT(m_hasDatapoints, "Missing ARRAY '%s' in '%s'", JSON_DATAPOINTS, JSON_EXCHANGED_DATA);
     // Check version compatibility
-    const string version(::getString(exData, JSON_VERSION, JSON_EXCHANGED_DATA));
-    ASSERT(version == EXCH_DATA_VERSION,
+    ASSERT(m_hasVersion, "Missing STRING '%s' in '%s'", JSON_VERSION, JSON_EXCHANGED_DATA);
+    ASSERT(m_version == EXCH_DATA_VERSION,
             "Incompatible '%s' version. Found '%s', expected '%s'",
-            JSON_EXCHANGED_DATA, version.c_str(), EXCH_DATA_VERSION);
+            JSON_EXCHANGED_DATA, m_version.c_str(), EXCH_DATA_VERSION);
+}
+
+/**************************************************************************/
+/**
+ * @return An upper bound of the number of datapoints, so that the dictionnary
+ *      can be reserved before parsing
+ */
+size_t estimateDatapoints(const string& json) {
+    static const string pivotIdKey(string("\"") + JSON_PIVOT_ID + "\"");
+    size_t count(0);
+    for (size_t pos(json.find(pivotIdKey)) ; pos != string::npos ; pos = json.find(pivotIdKey, pos + 1)) {
+        count++;
+    }
+    return count;
+}
+
+/**************************************************************************/
+/** A [begin, end) range in the JSON text */
+using Range_t = std::pair<size_t, size_t>;
+
+/** Minimum size of the "datapoints" array for a parallel parsing */
+const size_t ParallelMinBytes = 1 << 20;
+/** Minimum size of a chunk of datapoints parsed by a worker */
+const size_t MinChunkBytes = 256 * 1024;
+
+/**
+ * Locates the "datapoints" array of "exchanged_data" and splits its elements into
+ * chunks of about 'chunkBytes', using a structural scan only (strings and nesting).
+ * Content is not validated: it will be by the parsing of the chunks and of the rest of the document.
+ * @param array Set to the positions of the array brackets
+ * @return false if the array was not found
+ */
+bool splitDatapoints(const string& json, size_t chunkBytes, Range_t* array, vector<Range_t>* chunks) {
+    const char* const text(json.c_str());
+    const size_t size(json.size());
+    size_t depth(0);
+    size_t exDataDepth(0);      // Depth of the "exchanged_data" object, 0 when outside
+    size_t arrayDepth(0);       // Depth of the "datapoints" array, 0 when outside
+    size_t chunkBegin(0);
+    const char* key(nullptr);   // Key of the next value
+    size_t keyLen(0);
+    for (size_t i = 0 ; i < size ; i++) {
+        const char c(text[i]);
+        if (c == '"') {
+            const size_t begin(i + 1);
+            for (i++ ; i < size && text[i] != '"' ; i++) {
+                if (text[i] == '\\') i++;
+            }
+            if (i >= size) return false;
+            size_t next(i + 1);
+            while (next < size && isspace(static_cast<unsigned char>(text[next]))) next++;
+            if (arrayDepth == 0 && next < size && text[next] == ':') {
+                key = text + begin;
+                keyLen = i - begin;
+            }
+        } else if (c == '{' || c == '[') {
+            depth++;
+            if (arrayDepth > 0) continue;
+            if (c == '{' && depth == 2 && key != nullptr && isKey(key, keyLen, JSON_EXCHANGED_DATA)) {
+                exDataDepth = depth;
+            } else if (c == '[' && exDataDepth == 2 && depth == 3 && key != nullptr &&
+                    isKey(key, keyLen, JSON_DATAPOINTS)) {
+                arrayDepth = depth;
+                array->first = i;
+                chunkBegin = i + 1;
+            }
+            key = nullptr;
+        } else if (c == '}' || c == ']') {
+            if (depth == 0) return false;
+            if (depth == arrayDepth) {
+                // End of "datapoints": last chunk, unless empty
+                size_t pos(chunkBegin);
+                while (pos < i && isspace(static_cast<unsigned char>(text[pos]))) pos++;
+                if (pos < i) chunks->emplace_back(chunkBegin, i);
+                array->second = i;
+                return c == ']';
+            }
+            if (depth == exDataDepth) exDataDepth = 0;
+            depth--;
+            key = nullptr;
+        } else if (c == ',') {
+            if (arrayDepth > 0 && depth == arrayDepth && i - chunkBegin >= chunkBytes) {
+                chunks->emplace_back(chunkBegin, i);
+                chunkBegin = i + 1;
+            }
+            key = nullptr;
+        }
+    }
+    return false;
+}
+
+/**************************************************************************/
+/** Joins threads when leaving the scope: an exception must not leave a thread joinable */
+class ThreadJoiner {
+ public:
+    explicit ThreadJoiner(vector<std::thread>* threads): m_threads(threads) {}
+    ~ThreadJoiner(void) {
+        for (std::thread& thread : *m_threads) {
+            if (thread.joinable()) thread.join();
+        }
+    }
+    ThreadJoiner(const ThreadJoiner&) = delete;
+    ThreadJoiner& operator=(const ThreadJoiner&) = delete;
+
+ private:
+    vector<std::thread>* const m_threads;
+};
 
-    // Parse "datapoints" section
-    for (const Value& datapoint : datapoints) {
-        const string label(::getString(datapoint, JSON_LABEL, JSON_DATAPOINTS));
-        LOG_DEBUG("Parsing DATAPOINT(%s)", label.c_str());
-        const string pivot_id(::getString(datapoint, JSON_PIVOT_ID, JSON_DATAPOINTS));
-        const string pivot_type(::getString(datapoint, JSON_PIVOT_TYPE, JSON_DATAPOINTS));
-        const Value::ConstArray& protocols(getArray(datapoint, JSON_PROTOCOLS, JSON_DATAPOINTS));
+}   // namespace
+
+
+/**************************************************************************/
+DataDictionnary::
+DataDictionnary(const string& jsonExData, unsigned nbThreads, const std::atomic<bool>* cancel) {
+    if (nbThreads == 0) nbThreads = std::max(1u, std::thread::hardware_concurrency());
+    // Note: executed with huge configurations: no per-entry log, no exception, no temporary string
+    m_map.reserve(::estimateDatapoints(jsonExData));
+    if (nbThreads > 1 && jsonExData.size() >= ParallelMinBytes) {
+        parseParallel(jsonExData, nbThreads, cancel);
+    } else {
+        parse(jsonExData, cancel);
+    }
+    buildIndexes();
+    if (m_duplicates > 0) {
+        LOG_WARNING("%u duplicate pivot ids ignored in '%s'", static_cast<unsigned>(m_duplicates),
+                JSON_EXCHANGED_DATA);
+    }
+    LOG_INFO("Exchanged data: %u OPC UA entries (%u patterns)", static_cast<unsigned>(m_map.size()),
+            static_cast<unsigned>(m_patterns.size()));
+}
 
-        for (const Value& protocol : protocols) {
+/**************************************************************************/
+DataDictionnary::
+DataDictionnary(PivotElementMap_t&& map, size_t duplicates):
+    m_map(std::move(map)),
+    m_duplicates(duplicates) {
+    buildIndexes();
+}
+
+/**************************************************************************/
+void
+DataDictionnary::buildIndexes(void) {
+    m_known = BloomFilter(m_map.size());
+    uint32_t index(0);
+    for (PivotElementMap_t::value_type& item : m_map) {
+        item.second.m_index = index++;
+        item.second.m_isPattern = PivotIdTrie::isPattern(item.first);
+        if (item.second.m_isPattern) {
+            m_patterns.insert(item.first, &item.second);
+        } else {
+            m_known.add(item.first);
+        }
+    }
+}
+
+/**************************************************************************/
+void
+DataDictionnary::parse(const string& jsonExData, const std::atomic<bool>* cancel) {
+    // Single pass SAX parsing: the JSON is never loaded as a DOM
+    ExchangedDataHandler handler(&m_map, &m_duplicates, cancel);
+    rapidjson::Reader reader;
+    rapidjson::StringStream stream(jsonExData.c_str());
+    reader.Parse(stream, handler);
+    ASSERT(!reader.HasParseError(),
+            "Malformed JSON (section '%s', index = %u, near %50s)",
+            JSON_EXCHANGED_DATA, static_cast<unsigned>(reader.GetErrorOffset()),
+            jsonExData.c_str() + reader.GetErrorOffset());
+    handler.checkComplete();
+}
+
+/**************************************************************************/
+void
+DataDictionnary::parseParallel(const string& jsonExData, unsigned nbThreads, const std::atomic<bool>* cancel) {
+    // Chunks of the "datapoints" array are parsed by workers, in any order
+    Range_t array;
+    vector<Range_t> chunks;
+    const size_t chunkBytes(std::max(MinChunkBytes, jsonExData.size() / (nbThreads * 8)));
+    if (!::splitDatapoints(jsonExData, chunkBytes, &array, &chunks) || chunks.size() < 2) {
+        parse(jsonExData, cancel);
+        return;
+    }
+
+    // The rest of the document is checked first, with an empty "datapoints" array
+    parse(jsonExData.substr(0, array.first + 1) + jsonExData.substr(array.second), cancel);
+
+    struct Chunk {
+        vector<ParsedEntry> entries;
+        std::exception_ptr  error;
+        bool                done = false;
+    };
+    vector<Chunk> results(chunks.size());
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::atomic<size_t> nextChunk(0);
+    const std::function<void(void)> worker([&]() {
+        string text;
+        for (size_t index(nextChunk++) ; index < chunks.size() ; index = nextChunk++) {
+            Chunk& chunk(results[index]);
             try {
-                // Check for matching protocol ("s2opcua")
-                // ExchangedDataC will throw if protocol does not match
-                const ExchangedDataC data(protocol);
-
-                // Insert element
-                LOG_INFO("Add Pivot id '%s' : {'%s', '%s', '%s'}",
-                        pivot_id.c_str(),
-                        pivot_type.c_str(), data.address.c_str(), data.typeId.c_str());
-                m_map.emplace(std::make_pair(pivot_id, PivotElement(pivot_type, data.typeId)));
+                text.assign(1, '[');
+                text.append(jsonExData, chunks[index].first, chunks[index].second - chunks[index].first);
+                text.push_back(']');
+                ExchangedDataHandler handler(&chunk.entries, cancel);
+                rapidjson::Reader reader;
+                rapidjson::StringStream stream(text.c_str());
+                reader.Parse(stream, handler);
+                const size_t offset(chunks[index].first + reader.GetErrorOffset() - 1);
+                ASSERT(!reader.HasParseError(),
+                        "Malformed JSON (section '%s', index = %u, near %50s)",
+                        JSON_EXCHANGED_DATA, static_cast<unsigned>(offset), jsonExData.c_str() + offset);
+            }
+            catch (...) {
+                chunk.error = std::current_exception();
+            }
+            std::lock_guard<std::mutex> guard(mutex);
+            chunk.done = true;
+            cond.notify_one();
+        }
+    });
+    vector<std::thread> threads;
+    std::exception_ptr error;
+    {
+        const ThreadJoiner joiner(&threads);
+        for (size_t i = 0 ; i < std::min(static_cast<size_t>(nbThreads), chunks.size()) ; i++) {
+            threads.emplace_back(worker);
+        }
+
+        // Deterministic merge, in document order, while workers are still parsing
+        for (Chunk& chunk : results) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cond.wait(lock, [&chunk]() {return chunk.done;});
+            }
+            if (error == nullptr) error = chunk.error;
+            if (error == nullptr) {
+                try {
+                    for (ParsedEntry& entry : chunk.entries) {
+                        ::insertEntry(&m_map, &m_duplicates, std::move(entry.pivotId),
+                                std::move(entry.pivotType), std::move(entry.opcType), std::move(entry.address),
+                                std::move(entry.mappings));
+                    }
+                }
+                catch (...) {
+                    error = std::current_exception();
+                }
             }
-            catch (const ExchangedDataC::NotAnS2opcInstance&) {     // //NOSONAR
-                // Just ignore other protocols
+            if (error != nullptr) {
+                // Remaining chunks are not parsed
+                nextChunk = chunks.size();
+                break;
             }
+            vector<ParsedEntry>().swap(chunk.entries);
         }
     }
+    if (error != nullptr) std::rethrow_exception(error);
 }
@@ -12,6 +12,9 @@
 
 // System headers
 #include <time.h>
+#include <sys/time.h>
+#include <algorithm>
+#include <future>
 #include <memory>
 #include <regex>
 #include <mutex>
@@ -24,6 +27,9 @@
 #include "pivot2opcua_common.h"
 #include "pivot2opcua_rules.h"
 #include "pivot2opcua_data.h"
+#include "pivot2opcua_snapshot.h"
+#include "pivot2opcua_compact.h"
+#include "pivot2opcua_packed.h"
 
 //SOP2C headers
 extern "C" {
@@ -93,6 +99,21 @@ createDpWithIntValue(const string& name, const long value) {  // //NOLINT  Fledg
     return createDpWithValue(name, value);
 }
 
+/**
+ * Add an enum-like field of the compact layout: its code if it has one, the
+ * string otherwise. Code 0 is omitted when 'omitDefault' is set.
+ */
+void
+addCompactField(Datapoints* dps, const string& name, CompactLayout::Field field, const string& value,
+        bool omitDefault) {
+    const int64_t code(CompactLayout::encode(field, value));
+    if (code < 0) {
+        dps->push_back(createDpWithValue(name, value));
+    } else if (code > 0 || !omitDefault) {
+        dps->push_back(createDpWithIntValue(name, code));
+    }
+}
+
 template <class T>
 Datapoint*
 datapointAddElementWithValue(Datapoint* dp, const string& name, const T value) {
@@ -121,6 +142,18 @@ const char* opcuaToPivotTypes(const string &opcType) {
     return "UNKTyp";
 }
 
+/**
+ * @param field A field of a PIVOT object
+ * @param opcType The target OPC UA type
+ * @return 1 if 'field' is a value sub-section that can be converted to 'opcType',
+ *      -1 if it is a value sub-section that cannot, 0 if it is not a value sub-section
+ */
+int valueFieldMatch(const string& field, const string& opcType) {
+    const Str2Vect_map_t::const_iterator it(Rules::pivotType2opcTypesMap.find(field));
+    if (it == Rules::pivotType2opcTypesMap.end()) return 0;
+    return std::find(it->second.begin(), it->second.end(), opcType) != it->second.end() ? 1 : -1;
+}
+
 }  // namespace
 
 /**
@@ -138,8 +171,18 @@ Pivot2OpcuaFilter::Pivot2OpcuaFilter(const string& filterName,
         ConfigCategory& filterConfig,
         OUTPUT_HANDLE *outHandle,    // //NOSONAR (Use of Fledge API)
         OUTPUT_STREAM output) :      // //NOSONAR (Use of Fledge API)
-                FledgeFilter(filterName, filterConfig, outHandle, output) {
+                FledgeFilter(filterName, filterConfig, outHandle, output),
+                m_batcher([this](ReadingSet* readingSet, bool timeout) {
+                    m_statistics.addOutput(readingSet->getAllReadings().size(), timeout);
+                    (*m_func)(m_data, readingSet);
+                }) {
+    m_conversion.router = std::make_shared<AssetRouter>();
+    m_conversion.statistics = &m_conversionStats;
     handleConfig(filterConfig);
+    if (m_asyncDepth > 0) {
+        m_async.reset(new AsyncIngest(m_asyncDepth, m_asyncPolicy,
+                [this](ReadingSet* readingSet) {process(readingSet, true);}, &m_statistics));
+    }
 }
 
 Pivot2OpcuaFilter::Datapoints*
@@ -191,8 +234,10 @@ Pivot2OpcuaFilter::getIntStVal(const Datapoints* dict, const string& context) {
  * @param dict The object under "PIVOT.GTxx"
  */
 Pivot2OpcuaFilter::CommonMeasurePivot::
-CommonMeasurePivot(const Datapoints* dict) :
+CommonMeasurePivot(const Datapoints* dict, const DataDictionnary* dictionnary) :
 m_readFields(0),            // //NOSONAR (FP)
+m_unknown(false),           // //NOSONAR (FP)
+m_element(nullptr),         // //NOSONAR (FP)
 m_pivotType("unknown"),     // //NOSONAR (FP)
 m_Confirmation(false),      // //NOSONAR (FP)
 m_Cause(0),                 // //NOSONAR (FP)
@@ -203,8 +248,56 @@ m_TmValidity("good"),       // //NOSONAR (FP)
 m_MagVal(nullptr),          // //NOSONAR (FP)
 m_Qualified(nullptr) {      // //NOSONAR (FP)
     static const FieldDecoder notFound(nullptr);
+    static const string identifier("Identifier");
+
+    // Identifier first: nothing else is decoded for an unknown id.
+    // Then, only the value sub-section matching the target type is decoded.
+    // Others are decoded only if none matches, so that the mismatch is reported.
+    static const size_t MaxValueFields = 4;
+    const Datapoint* skipped[MaxValueFields];
+    size_t nbSkipped(0);
+    Datapoint* identifierDp(nullptr);
+    if (dictionnary != nullptr) {
+        const Datapoint* values[MaxValueFields];
+        size_t nbValues(0);
+        for (Datapoint* dp : *dict) {
+            const string name(dp->getName());
+            if (name == identifier) {
+                identifierDp = dp;
+            } else if (nbValues < MaxValueFields && name.size() > 3 && name.compare(name.size() - 3, 3, "Typ") == 0) {
+                values[nbValues++] = dp;
+            }
+        }
+        if (identifierDp != nullptr && identifierDp->getData().getType() == DatapointValue::T_STRING) {
+            m_Identifier = identifierDp->getData().toStringValue();
+            m_readFields |= FieldMask_idt | FieldMask_typ;
+            if (dictionnary->mayContain(m_Identifier)) m_element = dictionnary->lookup(m_Identifier);
+            if (m_element == nullptr) {
+                m_unknown = true;
+                return;
+            }
+            bool matched(false);
+            for (size_t i = 0 ; i < nbValues ; i++) {
+                int match(valueFieldMatch(values[i]->getName(), m_element->m_opcType));
+                // With several OPC UA mappings, the section is needed if any of them matches
+                for (const OpcuaMapping& mapping : m_element->m_mappings) {
+                    match = std::max(match, valueFieldMatch(values[i]->getName(), mapping.m_opcType));
+                }
+                if (match > 0) matched = true;
+                if (match < 0) skipped[nbSkipped++] = values[i];
+            }
+            if (!matched) nbSkipped = 0;
+        } else {
+            identifierDp = nullptr;
+        }
+    }
 
     for (Datapoint* dp : *dict) {
+        if (dp == identifierDp) continue;   // Already decoded
+        if (nbSkipped > 0 && std::find(skipped, skipped + nbSkipped, dp) != skipped + nbSkipped) {
+            LOG_DEBUG("Skipping PIVOT field '%s' (not a '%s')", dp->getName().c_str(), m_element->m_opcType.c_str());
+            continue;
+        }
         const string name(dp->getName());
         DatapointValue& data = dp->getData();
         FieldDecoder decoder(Rules::find_T(decoder_map, name, notFound));
@@ -369,68 +462,161 @@ logMissingMandatoryFields(const std::string& pivotName, uint32_t fields) {
     }
 }
 
-void
+size_t
 Pivot2OpcuaFilter::CommonMeasurePivot::
-updateReading(const DataDictionnary* dictPtr, Reading* reading)const {
+createDataObjects(const DataDictionnary* dictPtr, const SignalHandles* handles, Datapoints* outputs,
+        OutputLayout layout)const {
     // Search for initial data in "exchanged_data" section
-    if (dictPtr == nullptr || m_Qualified == nullptr) return;
+    if (dictPtr == nullptr || handles == nullptr || m_Qualified == nullptr) return 0;
     if (m_Identifier.empty()) {
         LOG_WARNING("Mandatory field 'Identifier' from PIVOT is missing ");
-        return;
+        return 0;
     }
 
     if ((m_readFields & Mandatory_fields) != Mandatory_fields) {
         LOG_WARNING("Mandatory fields from PIVOT are missing for PIVOT ID='%s' (Missing mask = 0x%04X)",
                 m_Identifier.c_str(), Mandatory_fields & (~m_readFields));
         logMissingMandatoryFields(m_Identifier.c_str(), m_readFields);
-        return;
+        return 0;
     }
 
-    const DataDictionnary& dict(*dictPtr);
-
-    const PivotElementMap_t::const_iterator search = dict.find(m_Identifier);
-    if (dict.isEmpty(search)) {
+    const PivotElement* search(m_element != nullptr ? m_element : dictPtr->lookup(m_Identifier));
+    if (search == nullptr) {
         LOG_WARNING("Could not identify PIVOT ID='%s'", m_Identifier.c_str());
-        return;
+        return 0;
     }
 
     // Elment found in dictionary
-    const PivotElement& element(search->second);
+    const PivotElement& element(*search);
+    const uint32_t handle(handles->handle(element));
+    if (element.m_mappings.empty()) {
+        outputs->push_back(createDataObject(element, handle, 0, layout));
+        return 1;
+    }
 
-    // Ensure all elements can be created before deleting previous item
+    // Several OPC UA variables: the decoded content is encoded for each of them
+    // (packed records hold a limited mapping rank, @see warnPackedMappings)
+    const size_t nbMappings(layout == OutputLayout::Packed ?
+            std::min(element.m_mappings.size(), static_cast<size_t>(PackedRecord::MaxMappings)) :
+            element.m_mappings.size());
+    size_t nbCreated(0);
+    for (size_t mapping = 0 ; mapping < nbMappings ; mapping++) {
+        try {
+            outputs->push_back(createDataObject(element, handle, mapping, layout));
+            nbCreated++;
+        } catch (const InvalidPivotContent&) {
+            // Already reported, other mappings are still published
+        }
+    }
+    return nbCreated;
+}
+
+Datapoint*
+Pivot2OpcuaFilter::CommonMeasurePivot::
+createDataObject(const PivotElement& element, uint32_t handle, size_t mapping, OutputLayout layout)const {
+    const bool multiple(!element.m_mappings.empty());
+    const std::string& opcType(multiple ? element.m_mappings[mapping].m_opcType : element.m_opcType);
+    const std::string* address(multiple ? &element.m_mappings[mapping].m_address : nullptr);
     Datapoint* dp_value(nullptr);
     try {
-        dp_value = m_Qualified->createData(element.m_opcType);
+        dp_value = m_Qualified->createData(opcType);
     } catch (const InvalidPivotContent& e) {
         LOG_WARNING("Failed to extract PIVOT content for '%s'",
                 m_Identifier.c_str());
         LOG_WARNING("... Reason : %s", e.context());
         throw;
     }
-
-    reading->removeAllDatapoints();
+    if (layout == OutputLayout::Packed) return createPackedObject(handle, mapping, opcType, dp_value);
 
     // Build content of "data_object" Object
     Datapoints* dp_vect = new Datapoints;    // //NOSONAR (Use of Fledge API)
 
-    dp_vect->push_back(createDpWithIntValue("do_cot", m_Cause));
-    dp_vect->push_back(createDpWithIntValue("do_confirmation", m_Confirmation));
-    dp_vect->push_back(createDpWithValue("do_comingfrom", m_ComingFrom));
-    dp_vect->push_back(createDpWithValue("do_id", m_Identifier));
-    dp_vect->push_back(createDpWithValue("do_type", element.m_opcType));
-    dp_vect->push_back(createDpWithIntValue("do_quality", m_Qualified->quality.toDetails()));
-    dp_vect->push_back(createDpWithIntValue("do_ts_quality", m_Qualified->ts.toDetails()));
-    dp_vect->push_back(createDpWithValue("do_value_quality", m_Qualified->quality.validity()));
-    dp_vect->push_back(createDpWithValue("do_source", m_Qualified->quality.getSource()));
-    dp_vect->push_back(createDpWithValue("do_ts", m_Qualified->ts.nbSec()));
-    dp_vect->push_back(createDpWithValue("do_ts_org", m_TmOrg));
-    dp_vect->push_back(createDpWithValue("do_ts_validity", m_TmValidity));
+    if (layout == OutputLayout::Compact) {
+        dp_vect->push_back(createDpWithIntValue("do_layout", CompactLayout::Version));
+        dp_vect->push_back(createDpWithIntValue("do_cot", m_Cause));
+        if (m_Confirmation) dp_vect->push_back(createDpWithIntValue("do_confirmation", m_Confirmation));
+        addCompactField(dp_vect, "do_comingfrom", CompactLayout::Field::ComingFrom, m_ComingFrom, false);
+        dp_vect->push_back(createDpWithValue("do_id", m_Identifier));
+        dp_vect->push_back(createDpWithIntValue("do_handle", handle));
+        addCompactField(dp_vect, "do_type", CompactLayout::Field::OpcType, opcType, false);
+        if (address != nullptr) dp_vect->push_back(createDpWithValue("do_address", *address));
+        const uint32_t quality(m_Qualified->quality.toDetails());
+        if (quality != 0) dp_vect->push_back(createDpWithIntValue("do_quality", quality));
+        const uint32_t tsQuality(m_Qualified->ts.toDetails());
+        if (tsQuality != 0) dp_vect->push_back(createDpWithIntValue("do_ts_quality", tsQuality));
+        addCompactField(dp_vect, "do_value_quality", CompactLayout::Field::Validity,
+                m_Qualified->quality.validity(), true);
+        addCompactField(dp_vect, "do_source", CompactLayout::Field::Source, m_Qualified->quality.getSource(), true);
+        dp_vect->push_back(createDpWithValue("do_ts", m_Qualified->ts.nbSec()));
+        addCompactField(dp_vect, "do_ts_org", CompactLayout::Field::TmOrg, m_TmOrg, true);
+        addCompactField(dp_vect, "do_ts_validity", CompactLayout::Field::Validity, m_TmValidity, true);
+    } else {
+        dp_vect->push_back(createDpWithIntValue("do_cot", m_Cause));
+        dp_vect->push_back(createDpWithIntValue("do_confirmation", m_Confirmation));
+        dp_vect->push_back(createDpWithValue("do_comingfrom", m_ComingFrom));
+        dp_vect->push_back(createDpWithValue("do_id", m_Identifier));
+        dp_vect->push_back(createDpWithIntValue("do_handle", handle));
+        dp_vect->push_back(createDpWithValue("do_type", opcType));
+        if (address != nullptr) dp_vect->push_back(createDpWithValue("do_address", *address));
+        dp_vect->push_back(createDpWithIntValue("do_quality", m_Qualified->quality.toDetails()));
+        dp_vect->push_back(createDpWithIntValue("do_ts_quality", m_Qualified->ts.toDetails()));
+        dp_vect->push_back(createDpWithValue("do_value_quality", m_Qualified->quality.validity()));
+        dp_vect->push_back(createDpWithValue("do_source", m_Qualified->quality.getSource()));
+        dp_vect->push_back(createDpWithValue("do_ts", m_Qualified->ts.nbSec()));
+        dp_vect->push_back(createDpWithValue("do_ts_org", m_TmOrg));
+        dp_vect->push_back(createDpWithValue("do_ts_validity", m_TmValidity));
+    }
     dp_vect->push_back(dp_value);
     DatapointValue dpVal(dp_vect, true);
     Datapoint* dp(new Datapoint("data_object", dpVal));  // //NOSONAR (Use of Fledge API)
     LOG_INFO("Successfully converted PIVOT ID='%s' from type '%s' to OPCUA '%s'",
-            m_Identifier.c_str(), m_pivotType.c_str(), element.m_opcType.c_str());
-    reading->addDatapoint(dp);
+            m_Identifier.c_str(), m_pivotType.c_str(), opcType.c_str());
+    return dp;
+}
+
+/**
+ * Encode the decoded object as a packed record
+ * @param dp_value The converted value ("do_value"), deleted
+ * @return The "do_packed" datapoint
+ */
+Datapoint*
+Pivot2OpcuaFilter::CommonMeasurePivot::
+createPackedObject(uint32_t handle, size_t mapping, const std::string& opcType, Datapoint* dp_value)const {
+    const auto code = [](CompactLayout::Field field, const std::string& value) -> uint8_t {
+        const int64_t result(CompactLayout::encode(field, value));
+        return result < 0 ? static_cast<uint8_t>(PackedRecord::NoCode) : static_cast<uint8_t>(result);
+    };
+    PackedRecord record;
+    record.opcType = code(CompactLayout::Field::OpcType, opcType);
+    record.comingFrom = code(CompactLayout::Field::ComingFrom, m_ComingFrom);
+    record.valueQuality = code(CompactLayout::Field::Validity, m_Qualified->quality.validity());
+    record.source = code(CompactLayout::Field::Source, m_Qualified->quality.getSource());
+    record.tmOrg = code(CompactLayout::Field::TmOrg, m_TmOrg);
+    record.tmValidity = code(CompactLayout::Field::Validity, m_TmValidity);
+    record.handle = handle;
+    record.confirmation = m_Confirmation;
+    record.mapping = static_cast<uint8_t>(mapping);
+    record.cot = static_cast<uint32_t>(m_Cause);
+    record.quality = m_Qualified->quality.toDetails();
+    record.tsQuality = m_Qualified->ts.toDetails();
+    record.tsMicros = static_cast<uint32_t>(m_Qualified->ts.toMicroSeconds() % 1000000);
+    record.ts = m_Qualified->ts.nbSec();
+    record.id = m_Identifier;
+
+    const DatapointValue& value(dp_value->getData());
+    if (value.getType() == DatapointValue::T_FLOAT) {
+        record.kind = PackedRecord::ValueKind::Float;
+        record.floatValue = value.toDouble();
+    } else if (value.getType() == DatapointValue::T_STRING) {
+        record.kind = PackedRecord::ValueKind::String;
+        record.stringValue = value.toStringValue();
+    } else {
+        record.intValue = value.toInt();
+    }
+    delete dp_value;
+    LOG_INFO("Successfully converted PIVOT ID='%s' from type '%s' to OPCUA '%s' (packed)",
+            m_Identifier.c_str(), m_pivotType.c_str(), opcType.c_str());
+    return createDpWithValue("do_packed", record.encode());
 }
 
 Pivot2OpcuaFilter::
@@ -488,19 +674,16 @@ TelecommandReplyPivot::parseConfirmation(const string& name, DatapointValue* dpv
     }
 }
 
-void
+Datapoint*
 Pivot2OpcuaFilter::
-TelecommandReplyPivot::updateReading(const DataDictionnary* dictPtr, Reading* orig)const {
-    (void)dictPtr;
+TelecommandReplyPivot::createReply(void)const {
     if (!(m_ConfStVal >= 0 && m_Identifier.length() > 0)) {
-        LOG_WARNING("TelecommandReplyPivot::updateReading() : Element incomplete/invalid. Skipped");
-        return;
+        LOG_WARNING("TelecommandReplyPivot::createReply() : Element incomplete/invalid. Skipped");
+        return nullptr;
     }
-    LOG_INFO("TelecommandReplyPivot::updateReading(id='%s', stVal=%d)",
+    LOG_INFO("TelecommandReplyPivot::createReply(id='%s', stVal=%d)",
             m_Identifier.c_str(), m_ConfStVal);
 
-    orig->removeAllDatapoints();
-
     Datapoints* dp_vect = new Datapoints;    // //NOSONAR (Use of Fledge API)
     dp_vect->push_back(createDpWithValue("ro_id", m_Identifier));
     // Note: m_ConfStVal has a NEGATIVE meaning (0=ACK, 1= Not ACK)
@@ -511,7 +694,7 @@ TelecommandReplyPivot::updateReading(const DataDictionnary* dictPtr, Reading* or
     Datapoint* dp(new Datapoint("opcua_reply", dpVal));  // //NOSONAR (Use of Fledge API)
     LOG_INFO("Successfully converted PIVOT ID='%s' from type 'PIVOT.GTIC' to OPCUA 'opcua_reply'",
             m_Identifier.c_str());
-    orig->addDatapoint(dp);
+    return dp;
 }
 
 namespace {
@@ -743,14 +926,18 @@ createData(const std::string& typeName) {
 /**
  * Convert a Reading from PIVOT to OPCUA.
  * @param readingRef The Reading.
- *      It is expected as an array of 1 Datapoint, eah of them containing:
+ *      It is expected as an array of Datapoints, each of them containing:
  *        - PIVOT.GTIx....
  *      If the reading content is compatible, it is replaced by the equivalent OPC data
- *      ("data_object")
- *      Only One datapoint is translated.
+ *      ("data_object" or "opcua_reply").
+ *      All PIVOT objects of the reading are translated, in one pass: the first one
+ *      replaces the reading content, each other one is output in a new reading.
+ * @param fanOut Receives the new readings (same asset and timestamps as 'readingRef')
  */
 void
-Pivot2OpcuaFilter::pivot2opcua(Reading* readingRef)const {
+Pivot2OpcuaFilter::pivot2opcua(const Conversion& conversion, Reading* readingRef, int64_t ingestTimeUs,
+        Readings* fanOut) {
+    Datapoints outputs;
     Datapoints& readDp(readingRef->getReadingData());
     for (Datapoint* dp : readDp) {
         // Expecting "PIVOT" in first level
@@ -774,14 +961,15 @@ Pivot2OpcuaFilter::pivot2opcua(Reading* readingRef)const {
             if (gtName == "GTIC") {
                 try {
                     TelecommandReplyPivot pivot(gtData.getDpVec());
-                    pivot.updateReading(m_dictionnary.get(), readingRef);
-                    return;
+                    Datapoint* reply(pivot.createReply());
+                    if (reply != nullptr) outputs.push_back(reply);
+                    m_statistics.addCommandReply(pivot.pivotId(), pivot.isAck(), ingestTimeUs);
                 } catch (const InvalidPivotContent& e) {
                     LOG_WARNING("Failed to extract PIVOT content from '%s.%s'",
                             name.c_str(), gtName.c_str());
                     LOG_WARNING("... Reason : %s", e.context());
-                    continue;
                 }
+                continue;
             }
 
             Str2Vect_map_t::const_iterator gtIter(Rules::gtix2pivotTypeMap.find(gtName));
@@ -800,28 +988,125 @@ Pivot2OpcuaFilter::pivot2opcua(Reading* readingRef)const {
             }
 
             try {
-                CommonMeasurePivot pivot(gtData.getDpVec());
-                pivot.updateReading(m_dictionnary.get(), readingRef);
-                return;
+                CommonMeasurePivot pivot(gtData.getDpVec(), conversion.dictionnary.get());
+                if (pivot.isUnknown()) {
+                    reportUnknownId(pivot.pivotId());
+                    continue;
+                }
+                const size_t first(outputs.size());
+                if (pivot.createDataObjects(conversion.dictionnary.get(), conversion.handles.get(), &outputs,
+                        conversion.layout) > 0) {
+                    if (pivot.element() != nullptr) {
+                        conversion.usage->hit(*pivot.element());
+                        if (conversion.statistics != nullptr) {
+                            conversion.statistics->addConversion(conversion.handles->handle(*pivot.element()),
+                                    ingestTimeUs);
+                        }
+                    }
+                    recordSourceLatency(conversion, pivot, outputs.data() + first, outputs.data() + outputs.size(),
+                            ingestTimeUs);
+                }
             } catch (const InvalidPivotContent& e) {
                 LOG_WARNING("Failed to extract PIVOT content from '%s.%s'",
                         name.c_str(), gtName.c_str());
                 LOG_WARNING("... Reason : %s", e.context());
-                continue;
             }
         }
     }
-    LOG_DEBUG("Received 'Reading' with no known content.");
-    return;
+    if (outputs.empty()) {
+        LOG_DEBUG("Received 'Reading' with no known content.");
+        return;
+    }
+
+    // The input datapoints are only released once all objects are converted
+    readingRef->removeAllDatapoints();
+    readingRef->addDatapoint(outputs.front());
+    for (size_t i = 1 ; i < outputs.size() ; i++) {
+        Reading* reading(new Reading(readingRef->getAssetName(), outputs[i]));  // //NOSONAR  Owned by the set
+        struct timeval tm;
+        readingRef->getTimestamp(&tm);
+        reading->setTimestamp(tm);
+        readingRef->getUserTimestamp(&tm);
+        reading->setUserTimestamp(tm);
+        fanOut->push_back(reading);
+    }
+}
+
+/**
+ * Account the delay between the source timestamp of a converted PIVOT object and
+ * its ingestion by the filter, and optionally add it to the output "data_object"
+ * @param pivot The converted PIVOT object
+ * @param first, last The converted objects ("data_object", one per OPC UA mapping)
+ * @param ingestTimeUs The time when the reading was received by the filter
+ */
+void
+Pivot2OpcuaFilter::recordSourceLatency(const Conversion& conversion, const CommonMeasurePivot& pivot,
+        Datapoint* const* first, Datapoint* const* last, int64_t ingestTimeUs) {
+    const int64_t delayUs(ingestTimeUs - pivot.sourceTimeUs());
+    if (conversion.statistics != nullptr) conversion.statistics->addSourceLatency(pivot.comingFrom(), delayUs);
+
+    // Packed records have no room for it
+    if (conversion.stampLatency && conversion.layout != OutputLayout::Packed) {
+        for (Datapoint* const* it = first ; it != last ; ++it) {
+            datapointAddElementWithValue(*it, "do_filter_latency_us", static_cast<long>(delayUs));  // //NOLINT
+        }
+    }
+}
+
+/**
+ * Account a PIVOT object rejected because its id is not in the dictionnary.
+ * Only the first occurrence of a (recently seen) unknown id is logged.
+ */
+void
+Pivot2OpcuaFilter::reportUnknownId(const std::string& pivotId) {
+    if (m_statistics.addUnknownId(pivotId)) {
+        LOG_WARNING("Could not identify PIVOT ID='%s'", pivotId.c_str());
+    }
+}
+
+/**
+ * @return The current time, in micro-seconds since Epoch
+ */
+int64_t
+Pivot2OpcuaFilter::nowUs(void) {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return static_cast<int64_t>(tv.tv_sec) * 1000000 + tv.tv_usec;
+}
+
+/**
+ * Log the statistics if the configured period is elapsed
+ * @param now The current time, in micro-seconds since Epoch
+ */
+void
+Pivot2OpcuaFilter::reportStatistics(int64_t now) {
+    if (m_statsPeriodUs <= 0) return;
+    if (m_lastStatsReportUs == 0) {
+        m_lastStatsReportUs = now;
+    } else if (now - m_lastStatsReportUs >= m_statsPeriodUs) {
+        m_lastStatsReportUs = now;
+        LOG_INFO("Statistics: %s", m_statistics.toJson(&m_conversionStats).c_str());
+    }
+}
+
+/**
+ * @return The statistics collected by the filter, as a JSON object
+ */
+std::string
+Pivot2OpcuaFilter::getStatistics(void) {
+    // The statistics of the conversions are only read between two conversions
+    std::lock_guard<mutex> guard(m_configMutex);
+    return m_statistics.toJson(&m_conversionStats);
 }
 
 /**
  * Convert a Reading from OPCUA to PIVOT.
  * @param readingRef The Reading.
  *      If the reading content is compatible, it is replaced by the equivalent PIVOT data
+ * @param ingestTimeUs The time when the reading was received by the filter
  */
 void
-Pivot2OpcuaFilter::opcua2pivot(Reading* reading)const {
+Pivot2OpcuaFilter::opcua2pivot(Reading* reading, int64_t ingestTimeUs) {
     if (reading == nullptr) return;
 
     Datapoints& readDp(reading->getReadingData());
@@ -919,6 +1204,7 @@ Pivot2OpcuaFilter::opcua2pivot(Reading* reading)const {
         LOG_INFO("Successfully created PIVOT ID='%s' with type '%s'",
                 co_id.c_str(), co_type.c_str());
         reading->addDatapoint(pivot);
+        m_statistics.addCommand(co_id, ingestTimeUs);
     } else {
         LOG_WARNING("'opcua_operation' ignored since some mandatory fields were not provided.");
     }
@@ -928,36 +1214,281 @@ Pivot2OpcuaFilter::opcua2pivot(Reading* reading)const {
 /**
  * The actual filtering code
  *
- * @param readingSet The reading data to filter
+ * @param readingSet The reading data to filter. In asynchronous mode, its commands
+ *      are converted and passed on at once, and the rest is queued for the conversion thread.
  */
 void
 Pivot2OpcuaFilter::ingest(ReadingSet *readingSet) {
+    if (m_async == nullptr) {
+        process(readingSet, false);
+        return;
+    }
+    if (m_inputEnabled) {
+        // Priority lane: commands are converted by this thread, they do not wait behind the queued measurements
+        const int64_t ingestTimeUs(nowUs());
+        Conversion conversion;
+        {
+            std::lock_guard<mutex> guard(m_inputMutex);
+            // Recorded as received, before the commands are split out
+            captureInput(readingSet, ingestTimeUs);
+            conversion = m_conversion;
+        }
+        Readings commands;
+        Readings measurements;
+        splitCommands(*conversion.router, *readingSet->getAllReadingsPtr(), &commands, &measurements);
+        if (!commands.empty()) {
+            // The statistics of conversions are only updated by the conversion thread
+            conversion.statistics = nullptr;
+            trackAssets(*conversion.router, commands);
+            ReadingSet* commandSet(readingSet);
+            if (!measurements.empty()) {
+                commandSet = new ReadingSet(&commands);  // //NOSONAR  Owned by the next filter
+                readingSet->clear();
+                readingSet->append(measurements);
+            }
+            convertSet(conversion, commandSet, ingestTimeUs);
+            m_statistics.expireCommands(ingestTimeUs);
+            passOn(commandSet, true, ingestTimeUs);
+            if (measurements.empty()) {
+                // Never waits for the conversion thread, which reports too
+                std::unique_lock<mutex> lock(m_configMutex, std::try_to_lock);
+                if (lock.owns_lock()) reportStatistics(ingestTimeUs);
+                return;
+            }
+        }
+    }
+    m_async->push(readingSet);
+}
+
+/**
+ * Record input readings, if the capture is enabled.
+ * Called holding the configMutex or the inputMutex.
+ */
+void
+Pivot2OpcuaFilter::captureInput(ReadingSet* readingSet, int64_t ingestTimeUs) {
+    if (m_capture.isOpen()) m_capture.capture(readingSet, ingestTimeUs);
+}
+
+/**
+ * @return true if 'reading' is a command (asset routed to "opcua2pivot") or a command reply (PIVOT GTIC)
+ */
+bool
+Pivot2OpcuaFilter::isCommand(const AssetRouter& router, Reading* reading) {
+    if (router.route(reading->getAssetName()) == AssetRouter::Route::Opcua2Pivot) return true;
+    for (Datapoint* dp : reading->getReadingData()) {
+        if (dp->getName() != "PIVOT") continue;
+        DatapointValue& data(dp->getData());
+        if (data.getType() != DatapointValue::T_DP_DICT) continue;
+        for (Datapoint* gtElem : *data.getDpVec()) {
+            if (gtElem->getName() == "GTIC") return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Sort readings between commands (and command replies) and measurements, keeping their order
+ */
+void
+Pivot2OpcuaFilter::splitCommands(const AssetRouter& router, const Readings& readings, Readings* commands,
+        Readings* measurements) {
+    for (Reading* reading : readings) {
+        (isCommand(router, reading) ? commands : measurements)->push_back(reading);
+    }
+}
+
+/**
+ * Hand converted readings to the output stage
+ * @param command true for the priority lane: passed on at once, before any pending measurement
+ * @param ingestTimeUs The time when the readings were received by the filter
+ */
+void
+Pivot2OpcuaFilter::passOn(ReadingSet* readingSet, bool command, int64_t ingestTimeUs) {
+    m_statistics.addLaneLatency(command, nowUs() - ingestTimeUs);
+    if (command) {
+        m_batcher.bypass(readingSet);
+    } else {
+        m_batcher.push(readingSet);
+    }
+}
+
+/**
+ * Convert the readings and pass them on
+ * @param queued true if the set comes from the asynchronous queue: it is already
+ *      recorded, and its commands were already passed on (@see ingest)
+ */
+void
+Pivot2OpcuaFilter::process(ReadingSet *readingSet, bool queued) {
     std::lock_guard<mutex> guard(m_configMutex);
 
     // Filter enable, process the readings
     if (isEnabled()) {
+        const int64_t ingestTimeUs(nowUs());
         Readings* readings(readingSet->getAllReadingsPtr());
         LOG_DEBUG("Pivot2OpcuaFilter::ingest(%d readings)", readings->size());
-        for (Reading* reading : *readings) {
-            std::string assetName = reading->getAssetName();
-            AssetTracker* tracker(AssetTracker::getAssetTracker());
-            if (nullptr != tracker) {
-                // We are modifying this asset so put an entry in the asset tracker
-                AssetTracker::getAssetTracker()->addAssetTrackingTuple(
-                        getName(), reading->getAssetName(), string("Filter"));
+        trackAssets(*m_conversion.router, *readings);
+
+        if (!queued) {
+            // Record input before any conversion
+            captureInput(readingSet, ingestTimeUs);
+
+            // Priority lane: commands and command replies are converted and passed on first, in their own set
+            Readings commands;
+            Readings measurements;
+            splitCommands(*m_conversion.router, *readings, &commands, &measurements);
+            if (!commands.empty()) {
+                if (measurements.empty()) {
+                    convertSet(m_conversion, readingSet, ingestTimeUs);
+                    m_statistics.expireCommands(ingestTimeUs);
+                    reportStatistics(ingestTimeUs);
+                    passOn(readingSet, true, ingestTimeUs);
+                    return;
+                }
+                ReadingSet* commandSet(new ReadingSet(&commands));  // //NOSONAR  Owned by the next filter
+                convertSet(m_conversion, commandSet, ingestTimeUs);
+                passOn(commandSet, true, ingestTimeUs);
+                readingSet->clear();
+                readingSet->append(measurements);
             }
-            // proceed to conversion
-            if (assetName == "opcua_operation") {
-                opcua2pivot(reading);
-                reading->setAssetName("PivotCommand");
+        }
+
+        if (m_chunkSize > 0 && readings->size() > m_chunkSize) {
+            ingestChunks(readingSet, ingestTimeUs);
+            return;
+        }
+        convertSet(m_conversion, readingSet, ingestTimeUs);
+        m_statistics.expireCommands(ingestTimeUs);
+        reportStatistics(ingestTimeUs);
+        // Pass on all readings (possibly merged with the next sets)
+        passOn(readingSet, false, ingestTimeUs);
+        return;
+    }
+    // Pass on all readings, after the ones converted before
+    m_batcher.flush();
+    (*m_func)(m_data, readingSet);
+}
+
+/**
+ * Put an entry in the asset tracker for each reading that may be modified (not passed through)
+ */
+void
+Pivot2OpcuaFilter::trackAssets(const AssetRouter& router, const Readings& readings) {
+    AssetTracker* tracker(AssetTracker::getAssetTracker());
+    if (nullptr == tracker) return;
+    for (const Reading* reading : readings) {
+        if (router.route(reading->getAssetName()) == AssetRouter::Route::Passthrough) continue;
+        tracker->addAssetTrackingTuple(getName(), reading->getAssetName(), string("Filter"));
+    }
+}
+
+/**
+ * Convert the readings of 'readingSet', in place
+ */
+void
+Pivot2OpcuaFilter::convertSet(const Conversion& conversion, ReadingSet* readingSet, int64_t ingestTimeUs) {
+    Readings* readings(readingSet->getAllReadingsPtr());
+    Readings converted;
+    if (convertReadings(conversion, readings->data(), readings->data() + readings->size(), ingestTimeUs,
+            &converted)) {
+        readingSet->clear();
+        readingSet->append(converted);
+    }
+}
+
+/**
+ * Convert the readings in [first, last)
+ * @param ingestTimeUs The time when the readings were received by the filter
+ * @param output Only filled if readings holding several PIVOT objects were fanned out:
+ *      receives all the converted readings, each one followed by the new readings fanned out of it
+ * @return true if 'output' was filled
+ */
+bool
+Pivot2OpcuaFilter::convertReadings(const Conversion& conversion, Reading* const* first, Reading* const* last,
+        int64_t ingestTimeUs, Readings* output) {
+    bool fannedOut(false);
+    Readings fanOut;
+    for (Reading* const* it = first ; it != last ; ++it) {
+        Reading* reading(*it);
+        // proceed to conversion
+        switch (conversion.router->route(reading->getAssetName())) {
+        case AssetRouter::Route::Opcua2Pivot:
+            opcua2pivot(reading, ingestTimeUs);
+            reading->setAssetName("PivotCommand");
+            break;
+        case AssetRouter::Route::Pivot2Opcua:
+            pivot2opcua(conversion, reading, ingestTimeUs, &fanOut);
+            break;
+        default:
+            // Unrelated asset: passed on unchanged
+            break;
+        }
+        if (fannedOut) {
+            output->push_back(reading);
+        } else if (!fanOut.empty()) {
+            output->assign(first, it + 1);
+            fannedOut = true;
+        }
+        output->insert(output->end(), fanOut.begin(), fanOut.end());
+        fanOut.clear();
+    }
+    return fannedOut;
+}
+
+/**
+ * Convert and forward a large set by chunks of m_chunkSize readings: each chunk
+ * is passed on as soon as it is converted, while the next one is converted by a
+ * worker thread. Conversions never run concurrently: only the forwarding overlaps.
+ * The first chunks are passed on in new ReadingSets, the last one in 'readingSet'.
+ * Called holding the configMutex.
+ */
+void
+Pivot2OpcuaFilter::ingestChunks(ReadingSet* readingSet, int64_t ingestTimeUs) {
+    const Readings all(readingSet->getAllReadings());
+    readingSet->clear();
+    const size_t nbChunks((all.size() + m_chunkSize - 1) / m_chunkSize);
+    // Converted chunks, when readings were fanned out
+    std::vector<Readings> fanned(nbChunks);
+    const auto chunkReadings = [this, &all, &fanned](size_t chunk) -> Readings {
+        if (!fanned[chunk].empty()) return fanned[chunk];
+        const size_t begin(chunk * m_chunkSize);
+        const size_t end(std::min(begin + m_chunkSize, all.size()));
+        return Readings(all.begin() + begin, all.begin() + end);
+    };
+    const auto convertChunk = [this, &all, &fanned, ingestTimeUs](size_t chunk) -> void {
+        const size_t begin(chunk * m_chunkSize);
+        const size_t end(std::min(begin + m_chunkSize, all.size()));
+        convertReadings(m_conversion, all.data() + begin, all.data() + end, ingestTimeUs, &fanned[chunk]);
+    };
+    LOG_DEBUG("Pivot2OpcuaFilter::ingest: %u chunks", static_cast<unsigned>(nbChunks));
+
+    size_t forwarded(0);
+    std::future<void> pending;
+    try {
+        convertChunk(0);
+        for (size_t chunk = 0 ; chunk < nbChunks ; chunk++) {
+            if (chunk > 0) pending.get();
+            Readings readings(chunkReadings(chunk));
+            if (chunk + 1 < nbChunks) {
+                pending = std::async(std::launch::async, convertChunk, chunk + 1);
+                forwarded++;
+                passOn(new ReadingSet(&readings), false, ingestTimeUs);  // //NOSONAR  Owned by the next filter
             } else {
-                // Default case convert PIVOT to OPCUA
-                pivot2opcua(reading);
+                m_statistics.expireCommands(ingestTimeUs);
+                reportStatistics(ingestTimeUs);
+                forwarded++;
+                readingSet->append(readings);
+                passOn(readingSet, false, ingestTimeUs);
             }
         }
+    } catch (...) {
+        // Give back the readings not forwarded yet, as without chunks
+        if (pending.valid()) pending.wait();
+        for (size_t chunk = forwarded ; chunk < nbChunks ; chunk++) {
+            Readings remaining(chunkReadings(chunk));
+            readingSet->append(remaining);
+        }
+        throw;
     }
-    // Pass on all readings
-    (*m_func)(m_data, readingSet);
 }
 
 /**
@@ -977,6 +1508,99 @@ Pivot2OpcuaFilter::reconfigure(const string& newConfig) {
     std::lock_guard<mutex> guard(m_configMutex);
     setConfig(newConfig);    // Pass the configuration to the base class
     handleConfig(m_config);
+    if (m_asyncDepth != (m_async != nullptr ? m_async->depth() : 0)) {
+        LOG_WARNING("'%s' change will only be applied on restart", JSON_ASYNC_QUEUE);
+    }
+}
+
+/**
+ * @param jsonExData The "exchanged_data" configuration
+ * @param hash The content hash of jsonExData (@see DictionarySnapshot::contentHash)
+ * @param snapshotName The name of the snapshot (one per filter instance)
+ * @param useSnapshot If true, the dictionnary is read from its snapshot when it
+ *      matches the configuration. Otherwise, the snapshot is updated after parsing.
+ * @param cancel @see DataDictionnary
+ * @return The dictionnary, shared with other instances using the same "exchanged_data"
+ */
+DataDictionnary_SharedPtr
+Pivot2OpcuaFilter::loadDictionnary(const string& jsonExData, uint64_t hash, const string& snapshotName,
+        unsigned nbThreads, bool useSnapshot, const std::atomic<bool>* cancel) {
+    return DictionaryCache::get(hash, jsonExData.size(), [&]() -> DataDictionnary_Ptr {
+        if (!useSnapshot) return DataDictionnary_Ptr(new DataDictionnary(jsonExData, nbThreads, cancel));
+
+        const string path(DictionarySnapshot::defaultPath(snapshotName));
+        DataDictionnary_Ptr result(DictionarySnapshot::load(path, hash));
+        if (result == nullptr) {
+            result.reset(new DataDictionnary(jsonExData, nbThreads, cancel));
+            if (!path.empty()) DictionarySnapshot::save(path, hash, *result);
+        }
+        return result;
+    });
+}
+
+/**
+ * Assign the handles of a new dictionnary (they are exported once published)
+ * @param previous The handles of the dictionnary being replaced. If none (on start),
+ *      those of the table saved by the previous run are kept.
+ * @param filterName Name of the table file (@see SignalHandles::defaultPath)
+ */
+SignalHandles_SharedPtr
+Pivot2OpcuaFilter::assignHandles(const DataDictionnary_SharedPtr& dictionnary, const SignalHandles_SharedPtr& previous,
+        const string& filterName) {
+    const string path(SignalHandles::defaultPath(filterName));
+    std::vector<string> savedIds;
+    const SignalHandles_SharedPtr handles(previous == nullptr && !path.empty() &&
+            SignalHandles::load(path, &savedIds) ?
+            std::make_shared<SignalHandles>(dictionnary, savedIds) :
+            std::make_shared<SignalHandles>(dictionnary, previous.get()));
+    return handles;
+}
+
+/**
+ * Report the pivot ids whose mappings do not all fit in packed records
+ */
+void
+Pivot2OpcuaFilter::warnPackedMappings(const DataDictionnary& dictionnary) {
+    size_t nbTruncated(0);
+    for (const PivotElementMap_t::value_type& item : dictionnary) {
+        if (item.second.m_mappings.size() <= PackedRecord::MaxMappings) continue;
+        if (nbTruncated++ == 0) {
+            LOG_WARNING("Packed output: pivot id '%s' has %u OPC UA mappings, only the first %u are published",
+                    item.first.c_str(), static_cast<unsigned>(item.second.m_mappings.size()),
+                    static_cast<unsigned>(PackedRecord::MaxMappings));
+        }
+    }
+    if (nbTruncated > 1) {
+        LOG_WARNING("Packed output: %u pivot ids have more than %u OPC UA mappings", static_cast<unsigned>(nbTruncated),
+                static_cast<unsigned>(PackedRecord::MaxMappings));
+    }
+}
+
+/**
+ * Replace the dictionnary used for conversions, with its handles.
+ * Called holding the configMutex (or from the constructor)
+ */
+void
+Pivot2OpcuaFilter::publishDictionnary(const DataDictionnary_SharedPtr& dictionnary,
+        const SignalHandles_SharedPtr& handles, int64_t durationUs) {
+    {
+        std::lock_guard<mutex> guard(m_inputMutex);
+        m_conversion.dictionnary = dictionnary;
+        if (m_conversion.usage == nullptr || m_conversion.usage->dictionnary() != dictionnary) {
+            // Hits of the ids still configured are kept
+            m_conversion.usage = std::make_shared<DictionaryUsage>(dictionnary, m_conversion.usage.get());
+        }
+        m_conversion.handles = handles;
+    }
+    m_statistics.setDictionaryUsage(m_conversion.usage);
+    m_conversionStats.setHandles(handles);
+    if (m_conversion.layout == OutputLayout::Packed) warnPackedMappings(*dictionnary);
+    m_dictGeneration++;
+    m_statistics.addDictionaryBuild(m_dictGeneration, dictionnary->size(), durationUs);
+    LOG_INFO("Exchanged data: %lu entries (generation %lu) built in %ld ms",
+            static_cast<unsigned long>(dictionnary->size()),        // //NOLINT
+            static_cast<unsigned long>(m_dictGeneration),           // //NOLINT
+            static_cast<long>(durationUs / 1000));                  // //NOLINT
 }
 
 /**
@@ -990,8 +1614,159 @@ void
 Pivot2OpcuaFilter::handleConfig(const ConfigCategory& config) {
     // Parse exchanged_data section and create a fast-search dictionnary
     LOG_INFO("Receiving new configuration '%s'", config.getDisplayName().c_str());
+    unsigned dictThreads(static_cast<unsigned>(DEFAULT_DICT_THREADS));
+    if (config.itemExists(JSON_DICT_THREADS)) {
+        const int64_t value(atoll(config.getValue(JSON_DICT_THREADS).c_str()));
+        dictThreads = (value > 0 ? static_cast<unsigned>(value) : 0);
+    }
+    const bool dictSnapshot(!config.itemExists(JSON_DICT_SNAPSHOT) ||
+            config.getValue(JSON_DICT_SNAPSHOT) == "true");
     if (config.itemExists(JSON_EXCHANGED_DATA)) {
-        LOG_INFO("Updating Exchanged data section...");
-        m_dictionnary.reset(new DataDictionnary(config.getValue(JSON_EXCHANGED_DATA)));
+        const string jsonExData(config.getValue(JSON_EXCHANGED_DATA));
+        // One snapshot per filter instance (configuration category)
+        const string snapshotName(config.getName().empty() ? getName() : config.getName());
+        const uint64_t hash(DictionarySnapshot::contentHash(jsonExData.data(), jsonExData.size()));
+        const bool unchanged(m_conversion.dictionnary != nullptr && hash == m_exDataHash &&
+                jsonExData.size() == m_exDataSize);
+        m_exDataHash = hash;
+        m_exDataSize = jsonExData.size();
+        if (unchanged) {
+            // Other settings changed: the current (or pending) dictionnary is kept
+            LOG_INFO("Exchanged data section unchanged");
+        } else if (m_conversion.dictionnary == nullptr) {
+            // Initial configuration: nothing to convert with until it is built
+            LOG_INFO("Building Exchanged data section...");
+            const int64_t startUs(nowUs());
+            const DataDictionnary_SharedPtr dictionnary(
+                    loadDictionnary(jsonExData, hash, snapshotName, dictThreads, dictSnapshot, nullptr));
+            const SignalHandles_SharedPtr handles(assignHandles(dictionnary, nullptr, snapshotName));
+            publishDictionnary(dictionnary, handles, nowUs() - startUs);
+            const string handlesPath(SignalHandles::defaultPath(snapshotName));
+            if (!handlesPath.empty()) handles->save(handlesPath);
+        } else {
+            // Ingest goes on with the current dictionnary until the new one is ready
+            LOG_INFO("Updating Exchanged data section in background...");
+            m_builder.submit([this, jsonExData, hash, snapshotName, dictThreads, dictSnapshot]
+                    (const std::atomic<bool>& cancelled) {
+                const int64_t startUs(nowUs());
+                try {
+                    const DataDictionnary_SharedPtr dictionnary(
+                            loadDictionnary(jsonExData, hash, snapshotName, dictThreads, dictSnapshot, &cancelled));
+                    // Only published by this thread: handles are assigned without blocking ingest
+                    SignalHandles_SharedPtr previous;
+                    {
+                        std::lock_guard<mutex> guard(m_configMutex);
+                        previous = m_conversion.handles;
+                    }
+                    if (cancelled) throw DataDictionnary::BuildCancelled();
+                    const SignalHandles_SharedPtr handles(assignHandles(dictionnary, previous, snapshotName));
+                    {
+                        // A newer configuration is only submitted holding the configMutex: once checked
+                        // here, this dictionnary cannot become obsolete before it is published
+                        std::lock_guard<mutex> guard(m_configMutex);
+                        if (cancelled) throw DataDictionnary::BuildCancelled();
+                        publishDictionnary(dictionnary, handles, nowUs() - startUs);
+                    }
+                    // Jobs run one after the other: the table of a newer dictionnary is written later
+                    const string handlesPath(SignalHandles::defaultPath(snapshotName));
+                    if (!handlesPath.empty()) handles->save(handlesPath);
+                } catch (const DataDictionnary::BuildCancelled&) {
+                    LOG_INFO("Exchanged data: build cancelled by a newer configuration");
+                    m_statistics.addDictionaryBuildFailure(true);
+                } catch (const std::exception& e) {
+                    LOG_ERROR("Exchanged data: invalid configuration, previous one kept (%s)", e.what());
+                    m_statistics.addDictionaryBuildFailure(false);
+                }
+            });
+        }
+    }
+    if (config.itemExists(JSON_ASSET_ROUTING)) {
+        try {
+            const std::shared_ptr<const AssetRouter> router(new AssetRouter(config.getValue(JSON_ASSET_ROUTING)));
+            std::lock_guard<mutex> guard(m_inputMutex);
+            m_conversion.router = router;
+            LOG_INFO("Asset routing: %u rules", static_cast<unsigned>(router->size()));
+        } catch (const std::exception& e) {
+            LOG_ERROR("Asset routing: invalid configuration, previous one kept (%s)", e.what());
+        }
+    }
+    if (config.itemExists(JSON_LATENCY_STAMP)) {
+        std::lock_guard<mutex> guard(m_inputMutex);
+        m_conversion.stampLatency = (config.getValue(JSON_LATENCY_STAMP) == "true");
+    }
+    if (config.itemExists(JSON_COMPACT_OUTPUT) || config.itemExists(JSON_PACKED_OUTPUT)) {
+        const bool compact(config.itemExists(JSON_COMPACT_OUTPUT) && config.getValue(JSON_COMPACT_OUTPUT) == "true");
+        const bool packed(config.itemExists(JSON_PACKED_OUTPUT) && config.getValue(JSON_PACKED_OUTPUT) == "true");
+        const OutputLayout layout(packed ? OutputLayout::Packed : (compact ? OutputLayout::Compact :
+                OutputLayout::Default));
+        if (layout == OutputLayout::Packed && m_conversion.layout != layout && m_conversion.dictionnary != nullptr) {
+            warnPackedMappings(*m_conversion.dictionnary);
+        }
+        std::lock_guard<mutex> guard(m_inputMutex);
+        m_conversion.layout = layout;
+    }
+    if (config.itemExists(JSON_CHUNK_SIZE)) {
+        const int64_t value(atoll(config.getValue(JSON_CHUNK_SIZE).c_str()));
+        m_chunkSize = (value > 0 ? static_cast<size_t>(value) : 0);
+    }
+    size_t batchSize(0);
+    int64_t batchDelayUs(DEFAULT_BATCH_DELAY_US);
+    if (config.itemExists(JSON_BATCH_SIZE)) {
+        const int64_t value(atoll(config.getValue(JSON_BATCH_SIZE).c_str()));
+        batchSize = (value > 0 ? static_cast<size_t>(value) : 0);
+    }
+    if (config.itemExists(JSON_BATCH_DELAY)) {
+        batchDelayUs = atoll(config.getValue(JSON_BATCH_DELAY).c_str());
+    }
+    m_batcher.configure(batchSize, batchDelayUs);
+
+    // Asynchronous ingest (the queue depth is only applied on start)
+    if (config.itemExists(JSON_ASYNC_QUEUE)) {
+        const int64_t value(atoll(config.getValue(JSON_ASYNC_QUEUE).c_str()));
+        m_asyncDepth = (value > 0 ? static_cast<size_t>(value) : 0);
+    }
+    if (config.itemExists(JSON_ASYNC_POLICY)) {
+        m_asyncPolicy = AsyncIngest::policyOf(config.getValue(JSON_ASYNC_POLICY));
+    }
+    if (m_async != nullptr) m_async->setPolicy(m_asyncPolicy);
+    if (config.itemExists(JSON_STATS_PERIOD)) {
+        m_statsPeriodUs = atoll(config.getValue(JSON_STATS_PERIOD).c_str()) * 1000000;
+        m_lastStatsReportUs = 0;
+    }
+
+    // Command round-trip tracking (pending commands are dropped on change)
+    int64_t cmdTimeoutUs(DEFAULT_CMD_TIMEOUT_S * 1000000);
+    int64_t cmdMaxPending(DEFAULT_CMD_MAX_PENDING);
+    if (config.itemExists(JSON_CMD_TIMEOUT)) {
+        cmdTimeoutUs = atoll(config.getValue(JSON_CMD_TIMEOUT).c_str()) * 1000000;
+    }
+    if (config.itemExists(JSON_CMD_MAX_PENDING)) {
+        cmdMaxPending = atoll(config.getValue(JSON_CMD_MAX_PENDING).c_str());
+    }
+    if (cmdTimeoutUs != m_cmdTimeoutUs || cmdMaxPending != m_cmdMaxPending) {
+        m_cmdTimeoutUs = cmdTimeoutUs;
+        m_cmdMaxPending = cmdMaxPending;
+        m_statistics.configureCommands(cmdMaxPending > 0 ? static_cast<size_t>(cmdMaxPending) : 0, cmdTimeoutUs);
+    }
+
+    // Input capture (empty file name disables it)
+    string captureFile;
+    int64_t captureSizeMb(DEFAULT_CAPTURE_SIZE_MB);
+    if (config.itemExists(JSON_CAPTURE_FILE)) {
+        captureFile = config.getValue(JSON_CAPTURE_FILE);
+    }
+    if (config.itemExists(JSON_CAPTURE_SIZE)) {
+        captureSizeMb = atoll(config.getValue(JSON_CAPTURE_SIZE).c_str());
+    }
+    const uint64_t captureSize(captureSizeMb > 0 ? static_cast<uint64_t>(captureSizeMb) << 20 : 0);
+    std::lock_guard<mutex> guard(m_inputMutex);
+    if (captureFile.empty()) {
+        m_capture.close();
+    } else if (!m_capture.isOpen() || ReadingCapture::resolvePath(captureFile) != m_capture.path() ||
+            captureSize != m_captureSize) {
+        m_captureSize = captureSize;
+        m_capture.open(captureFile, captureSize);
     }
+    // The base class flag is only read holding the configMutex
+    m_inputEnabled = isEnabled();
 }
@@ -0,0 +1,188 @@
+/*
+ * Fledge "pivottoopcua" filter plugin.
+ *
+ * Copyright (c) 2020 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include "pivot2opcua_handles.h"
+
+// System headers
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+
+// Project headers
+#include "pivot2opcua_common.h"
+#include "pivot2opcua_snapshot.h"
+#include "rapidjson/document.h"
+
+/**************************************************************************/
+SignalHandles::SignalHandles(DataDictionnary_SharedPtr dictionnary, const SignalHandles* previous):
+    m_dictionnary(std::move(dictionnary)),
+    m_handles(m_dictionnary->size(), 0) {
+    std::vector<const std::string*> previousIds;
+    if (previous != nullptr) {
+        previousIds.reserve(previous->m_entries.size());
+        for (const PivotElementMap_t::value_type* old : previous->m_entries) {
+            previousIds.push_back(old != nullptr ? &old->first : nullptr);
+        }
+    }
+    assign(previousIds);
+}
+
+/**************************************************************************/
+SignalHandles::SignalHandles(DataDictionnary_SharedPtr dictionnary, const std::vector<std::string>& previousIds):
+    m_dictionnary(std::move(dictionnary)),
+    m_handles(m_dictionnary->size(), 0) {
+    std::vector<const std::string*> ids;
+    ids.reserve(previousIds.size());
+    for (const std::string& id : previousIds) {
+        ids.push_back(id.empty() ? nullptr : &id);
+    }
+    assign(ids);
+}
+
+/**************************************************************************/
+void
+SignalHandles::assign(const std::vector<const std::string*>& previousIds) {
+    using Entry_t = PivotElementMap_t::value_type;
+    std::vector<bool> assigned(m_dictionnary->size(), false);
+
+    // Unchanged ids keep their handle
+    m_entries.resize(previousIds.size(), nullptr);
+    for (size_t handle = 0 ; handle < previousIds.size() ; handle++) {
+        if (previousIds[handle] == nullptr) continue;
+        const PivotElementMap_t::const_iterator it(m_dictionnary->find(*previousIds[handle]));
+        if (m_dictionnary->isEmpty(it) || assigned[it->second.m_index]) continue;
+        m_entries[handle] = &*it;
+        m_handles[it->second.m_index] = static_cast<uint32_t>(handle);
+        assigned[it->second.m_index] = true;
+        m_kept++;
+    }
+
+    // New ids (sorted, so that a given configuration always gets the same handles) fill the holes
+    std::vector<const Entry_t*> added;
+    added.reserve(m_dictionnary->size() - m_kept);
+    for (const Entry_t& item : *m_dictionnary) {
+        if (!assigned[item.second.m_index]) added.push_back(&item);
+    }
+    std::sort(added.begin(), added.end(), [](const Entry_t* left, const Entry_t* right) -> bool {
+        return left->first < right->first;
+    });
+    size_t handle(0);
+    for (const Entry_t* item : added) {
+        while (handle < m_entries.size() && m_entries[handle] != nullptr) handle++;
+        if (handle == m_entries.size()) m_entries.push_back(nullptr);
+        m_entries[handle] = item;
+        m_handles[item->second.m_index] = static_cast<uint32_t>(handle);
+    }
+    while (!m_entries.empty() && m_entries.back() == nullptr) m_entries.pop_back();
+}
+
+/**************************************************************************/
+void
+SignalHandles::toJson(JsonWriter_t* writer)const {
+    writer->StartObject();
+    writer->Key("handles");
+    writer->StartArray();
+    for (const PivotElementMap_t::value_type* item : m_entries) {
+        if (item == nullptr) {
+            writer->Null();
+            continue;
+        }
+        const PivotElement& element(item->second);
+        writer->StartObject();
+        writer->Key("pivot_id");
+        writer->String(item->first.c_str(), static_cast<rapidjson::SizeType>(item->first.size()));
+        writer->Key("mappings");
+        writer->StartArray();
+        const auto writeMapping = [writer](const std::string& opcType, const std::string& address) -> void {
+            writer->StartObject();
+            writer->Key("type");
+            writer->String(opcType.c_str(), static_cast<rapidjson::SizeType>(opcType.size()));
+            writer->Key("address");
+            writer->String(address.c_str(), static_cast<rapidjson::SizeType>(address.size()));
+            writer->EndObject();
+        };
+        if (element.m_mappings.empty()) {
+            writeMapping(element.m_opcType, element.m_address);
+        }
+        for (const OpcuaMapping& mapping : element.m_mappings) {
+            writeMapping(mapping.m_opcType, mapping.m_address);
+        }
+        writer->EndArray();
+        writer->EndObject();
+    }
+    writer->EndArray();
+    writer->EndObject();
+}
+
+/**************************************************************************/
+bool
+SignalHandles::save(const std::string& path)const {
+    rapidjson::StringBuffer buffer;
+    JsonWriter_t writer(buffer);
+    toJson(&writer);
+
+    // Written aside, then renamed: a reader never sees a partial table
+    const std::string tmpPath(path + ".tmp");
+    FILE* file(fopen(tmpPath.c_str(), "w"));
+    if (file == nullptr) {
+        LOG_WARNING("Handles: cannot create '%s' (%s)", tmpPath.c_str(), strerror(errno));
+        return false;
+    }
+    const bool written(fwrite(buffer.GetString(), 1, buffer.GetSize(), file) == buffer.GetSize());
+    if (fclose(file) != 0 || !written || rename(tmpPath.c_str(), path.c_str()) != 0) {
+        LOG_WARNING("Handles: cannot write '%s' (%s)", path.c_str(), strerror(errno));
+        unlink(tmpPath.c_str());
+        return false;
+    }
+    LOG_INFO("Handles: saved %u handles (%u kept) in '%s'", static_cast<unsigned>(m_entries.size()),
+            static_cast<unsigned>(m_kept), path.c_str());
+    return true;
+}
+
+/**************************************************************************/
+bool
+SignalHandles::load(const std::string& path, std::vector<std::string>* ids) {
+    FILE* file(fopen(path.c_str(), "r"));
+    if (file == nullptr) {
+        if (errno != ENOENT) LOG_WARNING("Handles: cannot open '%s' (%s)", path.c_str(), strerror(errno));
+        return false;
+    }
+    std::string content;
+    char buffer[64 * 1024];
+    size_t read(0);
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        content.append(buffer, read);
+    }
+    fclose(file);
+    rapidjson::Document doc;
+    doc.Parse(content.c_str());
+
+    const bool valid(!doc.HasParseError() && doc.IsObject() && doc.HasMember("handles") && doc["handles"].IsArray());
+    if (!valid) {
+        LOG_WARNING("Handles: invalid table '%s', handles are reassigned", path.c_str());
+        return false;
+    }
+    ids->clear();
+    ids->reserve(doc["handles"].Size());
+    for (const rapidjson::Value& item : doc["handles"].GetArray()) {
+        if (item.IsObject() && item.HasMember("pivot_id") && item["pivot_id"].IsString()) {
+            ids->emplace_back(item["pivot_id"].GetString(), item["pivot_id"].GetStringLength());
+        } else {
+            ids->emplace_back();
+        }
+    }
+    return true;
+}
+
+/**************************************************************************/
+std::string
+SignalHandles::defaultPath(const std::string& filterName) {
+    return DictionarySnapshot::dataPath(filterName, "_handles.json");
+}
@@ -0,0 +1,106 @@
+/*
+ * Fledge "pivottoopcua" filter plugin.
+ *
+ * Copyright (c) 2020 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include "pivot2opcua_histogram.h"
+
+// System headers
+#include <string.h>
+
+/**************************************************************************/
+LatencyHistogram::
+LatencyHistogram(void) {
+    reset();
+}
+
+void
+LatencyHistogram::reset(void) {
+    memset(m_buckets, 0, sizeof(m_buckets));
+    m_count = 0;
+    m_negative = 0;
+    m_min = 0;
+    m_max = 0;
+    m_sum = 0.0;
+}
+
+unsigned
+LatencyHistogram::bucketOf(uint64_t us) {
+    if (us < SubBuckets) return static_cast<unsigned>(us);
+    const unsigned msb(63u - static_cast<unsigned>(__builtin_clzll(us)));
+    if (msb >= MaxValueBits) return NbBuckets - 1;
+    const unsigned shift(msb - SubBucketBits);
+    const unsigned sub(static_cast<unsigned>(us >> shift) & (SubBuckets - 1));
+    return (shift + 1) * SubBuckets + sub;
+}
+
+uint64_t
+LatencyHistogram::bucketUpperBound(unsigned bucket) {
+    if (bucket < SubBuckets) return bucket;
+    const unsigned shift(bucket / SubBuckets - 1);
+    const uint64_t sub(bucket % SubBuckets);
+    const uint64_t lower((SubBuckets + sub) << shift);
+    return lower + (uint64_t(1) << shift) - 1;
+}
+
+void
+LatencyHistogram::add(int64_t us) {
+    if (us < 0) {
+        m_negative++;
+        return;
+    }
+    if (m_count == 0 || us < m_min) m_min = us;
+    if (m_count == 0 || us > m_max) m_max = us;
+    m_count++;
+    m_sum += static_cast<double>(us);
+    m_buckets[bucketOf(static_cast<uint64_t>(us))]++;
+}
+
+int64_t
+LatencyHistogram::mean(void)const {
+    if (m_count == 0) return 0;
+    return static_cast<int64_t>(m_sum / static_cast<double>(m_count));
+}
+
+int64_t
+LatencyHistogram::percentile(double ratio)const {
+    if (m_count == 0) return 0;
+    uint64_t rank(static_cast<uint64_t>(ratio * static_cast<double>(m_count) + 0.5));
+    if (rank < 1) rank = 1;
+    if (rank > m_count) rank = m_count;
+
+    uint64_t seen(0);
+    for (unsigned i = 0 ; i < NbBuckets ; i++) {
+        seen += m_buckets[i];
+        if (seen >= rank && i < NbBuckets - 1) {
+            const int64_t bound(static_cast<int64_t>(bucketUpperBound(i)));
+            return bound < m_max ? bound : m_max;
+        }
+    }
+    return m_max;
+}
+
+void
+LatencyHistogram::toJson(JsonWriter_t* writer)const {
+    writer->StartObject();
+    writer->Key("count");
+    writer->Uint64(m_count);
+    writer->Key("negative");
+    writer->Uint64(m_negative);
+    writer->Key("min_us");
+    writer->Int64(min());
+    writer->Key("mean_us");
+    writer->Int64(mean());
+    writer->Key("p50_us");
+    writer->Int64(percentile(0.50));
+    writer->Key("p90_us");
+    writer->Int64(percentile(0.90));
+    writer->Key("p99_us");
+    writer->Int64(percentile(0.99));
+    writer->Key("max_us");
+    writer->Int64(max());
+    writer->EndObject();
+}
@@ -0,0 +1,137 @@
+/*
+ * Fledge "pivottoopcua" filter plugin.
+ *
+ * Copyright (c) 2020 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include "pivot2opcua_hitters.h"
+
+// System headers
+#include <algorithm>
+#include <utility>
+
+/**************************************************************************/
+const uint32_t HeavyHitters::NotTracked;
+
+HeavyHitters::HeavyHitters(size_t capacity):
+    m_capacity(capacity > 0 ? capacity : 1) {
+    m_counters.reserve(m_capacity);
+    reset();
+}
+
+void
+HeavyHitters::reset(void) {
+    m_counters.clear();
+    m_positions.clear();
+    m_total = 0;
+    m_firstUs = 0;
+    m_lastUs = 0;
+}
+
+void
+HeavyHitters::add(uint32_t key, int64_t nowUs) {
+    if (m_total == 0) m_firstUs = nowUs;
+    m_lastUs = nowUs;
+    m_total++;
+
+    if (key < m_positions.size() && m_positions[key] != NotTracked) {
+        increment(m_positions[key]);
+        return;
+    }
+    if (m_counters.size() < m_capacity) {
+        // Count 0 is the smallest: the order is kept
+        const uint32_t pos(static_cast<uint32_t>(m_counters.size()));
+        m_counters.push_back(Counter{key, 0, 0});
+        setPosition(key, pos);
+        increment(pos);
+        return;
+    }
+    // Reuse the least counted key: the new one may have been seen that many times
+    const uint32_t pos(static_cast<uint32_t>(m_counters.size() - 1));
+    Counter& last(m_counters[pos]);
+    m_positions[last.key] = NotTracked;
+    last.key = key;
+    last.error = last.count;
+    setPosition(key, pos);
+    increment(pos);
+}
+
+void
+HeavyHitters::setPosition(uint32_t key, uint32_t pos) {
+    if (key >= m_positions.size()) m_positions.resize(key + size_t(1), NotTracked);
+    m_positions[key] = pos;
+}
+
+/**
+ * Increment a counter, moving it before the others having the same count
+ */
+void
+HeavyHitters::increment(uint32_t pos) {
+    const uint64_t count(m_counters[pos].count);
+    const std::vector<Counter>::iterator first(std::lower_bound(m_counters.begin(), m_counters.begin() + pos, count,
+            [](const Counter& counter, uint64_t value) -> bool {return counter.count > value;}));
+    const uint32_t target(static_cast<uint32_t>(first - m_counters.begin()));
+    if (target != pos) {
+        std::swap(m_counters[target], m_counters[pos]);
+        m_positions[m_counters[target].key] = target;
+        m_positions[m_counters[pos].key] = pos;
+    }
+    m_counters[target].count++;
+}
+
+uint64_t
+HeavyHitters::count(uint32_t key)const {
+    if (key >= m_positions.size() || m_positions[key] == NotTracked) return 0;
+    return m_counters[m_positions[key]].count;
+}
+
+std::vector<uint32_t>
+HeavyHitters::keys(void)const {
+    std::vector<uint32_t> result;
+    result.reserve(m_counters.size());
+    for (const Counter& counter : m_counters) {
+        result.push_back(counter.key);
+    }
+    return result;
+}
+
+void
+HeavyHitters::remove(uint32_t key) {
+    if (key >= m_positions.size() || m_positions[key] == NotTracked) return;
+    // The order of the others is kept
+    m_counters.erase(m_counters.begin() + m_positions[key]);
+    m_positions[key] = NotTracked;
+    for (uint32_t pos = 0 ; pos < m_counters.size() ; pos++) {
+        m_positions[m_counters[pos].key] = pos;
+    }
+}
+
+void
+HeavyHitters::toJson(JsonWriter_t* writer, size_t top,
+        const std::function<std::string(uint32_t)>& keyName)const {
+    const double windowS(static_cast<double>(m_lastUs - m_firstUs) / 1000000.0);
+    writer->StartObject();
+    writer->Key("total");
+    writer->Uint64(m_total);
+    writer->Key("window_s");
+    writer->Double(windowS);
+    writer->Key("top");
+    writer->StartArray();
+    for (size_t i = 0 ; i < top && i < m_counters.size() ; i++) {
+        const Counter& counter(m_counters[i]);
+        writer->StartObject();
+        writer->Key("id");
+        writer->String(keyName(counter.key).c_str());
+        writer->Key("count");
+        writer->Uint64(counter.count);
+        writer->Key("error");
+        writer->Uint64(counter.error);
+        writer->Key("rate");
+        writer->Double(windowS > 0.0 ? static_cast<double>(counter.count) / windowS : 0.0);
+        writer->EndObject();
+    }
+    writer->EndArray();
+    writer->EndObject();
+}
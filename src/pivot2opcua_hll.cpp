@@ -0,0 +1,54 @@
+/*
+ * Fledge "pivottoopcua" filter plugin.
+ *
+ * Copyright (c) 2020 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include "pivot2opcua_hll.h"
+
+// System headers
+#include <string.h>
+#include <math.h>
+
+// Project headers
+#include "pivot2opcua_bloom.h"
+
+/**************************************************************************/
+HyperLogLog::HyperLogLog(void) {
+    reset();
+}
+
+void
+HyperLogLog::reset(void) {
+    memset(m_registers, 0, sizeof(m_registers));
+}
+
+void
+HyperLogLog::add(const std::string& key) {
+    const uint64_t hash(BloomFilter::hash(key));
+    const unsigned index(static_cast<unsigned>(hash >> (64 - PrecisionBits)));
+    // Rank of the first set bit in the remaining bits (a sentinel bounds it)
+    const uint64_t rest((hash << PrecisionBits) | (uint64_t(1) << (PrecisionBits - 1)));
+    const uint8_t rank(static_cast<uint8_t>(__builtin_clzll(rest) + 1));
+    if (rank > m_registers[index]) m_registers[index] = rank;
+}
+
+uint64_t
+HyperLogLog::estimate(void)const {
+    double sum(0.0);
+    unsigned zeros(0);
+    for (const uint8_t reg : m_registers) {
+        sum += ldexp(1.0, -static_cast<int>(reg));
+        if (reg == 0) zeros++;
+    }
+    const double m(NbRegisters);
+    const double alpha(0.7213 / (1.0 + 1.079 / m));
+    double estimate(alpha * m * m / sum);
+    if (estimate <= 2.5 * m && zeros > 0) {
+        // Small range correction (linear counting)
+        estimate = m * log(m / zeros);
+    }
+    return static_cast<uint64_t>(estimate + 0.5);
+}
@@ -0,0 +1,72 @@
+/*
+ * Fledge "pivottoopcua" filter plugin.
+ *
+ * Copyright (c) 2020 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include "pivot2opcua_queue.h"
+
+/**************************************************************************/
+ReadingQueue::ReadingQueue(size_t capacity):
+    m_capacity(capacity > 2 ? capacity : 2),
+    m_cells(new Cell[m_capacity]),
+    m_pushPos(0),
+    m_popPos(0) {
+    for (size_t i = 0 ; i < m_capacity ; i++) {
+        m_cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+bool
+ReadingQueue::tryPush(const Item& item) {
+    size_t pos(m_pushPos.load(std::memory_order_relaxed));
+    for (;;) {
+        Cell& cell(m_cells[pos % m_capacity]);
+        const size_t sequence(cell.sequence.load(std::memory_order_acquire));
+        if (sequence == pos) {
+            // Free for this position: claim it
+            if (m_pushPos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                cell.item = item;
+                cell.sequence.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (sequence < pos) {
+            // Still holding the item of the previous round: full
+            return false;
+        } else {
+            pos = m_pushPos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+bool
+ReadingQueue::tryPop(Item* item) {
+    size_t pos(m_popPos.load(std::memory_order_relaxed));
+    for (;;) {
+        Cell& cell(m_cells[pos % m_capacity]);
+        const size_t sequence(cell.sequence.load(std::memory_order_acquire));
+        if (sequence == pos + 1) {
+            // Filled for this position: claim it
+            if (m_popPos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                *item = cell.item;
+                // Free for the next round
+                cell.sequence.store(pos + m_capacity, std::memory_order_release);
+                return true;
+            }
+        } else if (sequence < pos + 1) {
+            // Not filled yet: empty
+            return false;
+        } else {
+            pos = m_popPos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+size_t
+ReadingQueue::size(void)const {
+    const size_t popPos(m_popPos.load(std::memory_order_relaxed));
+    const size_t pushPos(m_pushPos.load(std::memory_order_relaxed));
+    return pushPos > popPos ? pushPos - popPos : 0;
+}
@@ -0,0 +1,69 @@
+/*
+ * Fledge "pivottoopcua" filter plugin.
+ *
+ * Copyright (c) 2020 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include "pivot2opcua_router.h"
+
+// System headers
+#include <algorithm>
+
+// Project headers
+#include "pivot2opcua_common.h"
+#include "rapidjson/document.h"
+
+/**************************************************************************/
+AssetRouter::AssetRouter(void) {
+    m_names.emplace("opcua_operation", Route::Opcua2Pivot);
+}
+
+AssetRouter::AssetRouter(const std::string& json) {
+    rapidjson::Document doc;
+    doc.Parse(json.c_str());
+    ASSERT(!doc.HasParseError() && doc.IsObject(), "Malformed JSON in '%s'", JSON_ASSET_ROUTING);
+    for (rapidjson::Value::ConstMemberIterator it(doc.MemberBegin()) ; it != doc.MemberEnd() ; ++it) {
+        const std::string asset(it->name.GetString(), it->name.GetStringLength());
+        Route route;
+        ASSERT(it->value.IsString() && routeOf(it->value.GetString(), &route),
+                "Invalid route for '%s' in '%s' (expecting pivot2opcua, opcua2pivot or passthrough)",
+                asset.c_str(), JSON_ASSET_ROUTING);
+        if (!asset.empty() && asset.back() == '*') {
+            m_prefixes.emplace_back(asset.substr(0, asset.size() - 1), route);
+        } else {
+            m_names[asset] = route;
+        }
+    }
+    std::stable_sort(m_prefixes.begin(), m_prefixes.end(),
+            [](const std::pair<std::string, Route>& a, const std::pair<std::string, Route>& b) {
+        return a.first.size() > b.first.size();
+    });
+}
+
+/**************************************************************************/
+AssetRouter::Route
+AssetRouter::route(const std::string& assetName)const {
+    const std::unordered_map<std::string, Route>::const_iterator it(m_names.find(assetName));
+    if (it != m_names.end()) return it->second;
+    for (const std::pair<std::string, Route>& prefix : m_prefixes) {
+        if (assetName.compare(0, prefix.first.size(), prefix.first) == 0) return prefix.second;
+    }
+    return Route::Pivot2Opcua;
+}
+
+/**************************************************************************/
+bool
+AssetRouter::routeOf(const std::string& name, Route* route) {
+    if (name == "pivot2opcua") {
+        *route = Route::Pivot2Opcua;
+    } else if (name == "opcua2pivot") {
+        *route = Route::Opcua2Pivot;
+    } else if (name == "passthrough") {
+        *route = Route::Passthrough;
+    } else {
+        return false;
+    }
+    return true;
+}
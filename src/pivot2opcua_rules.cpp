@@ -52,4 +52,10 @@ const Str2Vect_map_t gtix2pivotTypeMap {
     {"GTIS", {"SpsTyp", "DpsTyp"}}
 };  // gtix2pivotTypeMap
 
+const Str2Vect_map_t pivotType2opcTypesMap {
+    {"MvTyp", {"opcua_mvi", "opcua_mvf"}},
+    {"SpsTyp", {"opcua_sps"}},
+    {"DpsTyp", {"opcua_dps"}}
+};  // pivotType2opcTypesMap
+
 }   // namespace Rules
@@ -0,0 +1,294 @@
+/*
+ * Fledge "pivottoopcua" filter plugin.
+ *
+ * Copyright (c) 2020 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include "pivot2opcua_snapshot.h"
+
+// System headers
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Project headers
+#include "pivot2opcua_common.h"
+
+namespace {
+
+const char SnapshotMagic[8] = "P2ODICT";
+const uint32_t ByteOrderMark = 0x01020304;
+const char* const PluginDataFolder = "pivottoopcua";
+
+using Header_t = DictionarySnapshot::SnapshotHeader;
+using Entry_t = DictionarySnapshot::SnapshotEntry;
+
+/**************************************************************************/
+bool writeAll(int fd, const void* data, size_t size) {
+    const char* ptr(static_cast<const char*>(data));
+    while (size > 0) {
+        const ssize_t written(::write(fd, ptr, size));
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return false;
+        ptr += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+/**************************************************************************/
+/**
+ * Decode the mappings of an entry
+ * @return false if the encoded mappings are corrupted
+ */
+bool decodeMappings(const char* data, uint32_t length, OpcuaMappings_t* mappings) {
+    std::string fields[2];
+    size_t nbFields(0);
+    uint32_t pos(0);
+    while (pos < length) {
+        uint32_t fieldLength;
+        if (length - pos < sizeof(fieldLength)) return false;
+        memcpy(&fieldLength, data + pos, sizeof(fieldLength));
+        pos += static_cast<uint32_t>(sizeof(fieldLength));
+        if (length - pos < fieldLength) return false;
+        fields[nbFields++].assign(data + pos, fieldLength);
+        pos += fieldLength;
+        if (nbFields == 2) {
+            mappings->push_back(OpcuaMapping{std::move(fields[0]), std::move(fields[1])});
+            nbFields = 0;
+        }
+    }
+    return nbFields == 0;
+}
+
+/**************************************************************************/
+/**
+ * @return The dictionnary contained in the mapped snapshot, or nullptr if it is not valid
+ */
+DataDictionnary_Ptr decode(const uint8_t* data, size_t size, uint64_t configHash, const std::string& path) {
+    const Header_t& header(*reinterpret_cast<const Header_t*>(data));
+    if (memcmp(header.magic, SnapshotMagic, sizeof(SnapshotMagic)) != 0 ||
+            header.version != DictionarySnapshot::Version || header.byteOrder != ByteOrderMark) {
+        LOG_WARNING("Snapshot: '%s' has an unsupported format, ignored", path.c_str());
+        return nullptr;
+    }
+    if (header.configHash != configHash) {
+        LOG_INFO("Snapshot: '%s' was built from another configuration, ignored", path.c_str());
+        return nullptr;
+    }
+    const uint64_t maxEntries((size - sizeof(Header_t)) / sizeof(Entry_t));
+    if (header.nbEntries > maxEntries ||
+            header.stringsOffset != sizeof(Header_t) + header.nbEntries * sizeof(Entry_t) ||
+            header.stringsOffset + header.stringsSize != size ||
+            DictionarySnapshot::contentHash(data + sizeof(Header_t), size - sizeof(Header_t)) != header.checksum) {
+        LOG_WARNING("Snapshot: '%s' is corrupted, ignored", path.c_str());
+        return nullptr;
+    }
+
+    const Entry_t* entries(reinterpret_cast<const Entry_t*>(data + sizeof(Header_t)));
+    const char* strings(reinterpret_cast<const char*>(data + header.stringsOffset));
+    const auto inStrings = [&header](uint32_t offset, uint32_t length) {
+        return static_cast<uint64_t>(offset) + length <= header.stringsSize;
+    };
+    PivotElementMap_t map;
+    map.reserve(static_cast<size_t>(header.nbEntries));
+    for (uint64_t i = 0 ; i < header.nbEntries ; i++) {
+        const Entry_t& entry(entries[i]);
+        OpcuaMappings_t mappings;
+        if (!inStrings(entry.idOffset, entry.idLength) || !inStrings(entry.typeOffset, entry.typeLength) ||
+                !inStrings(entry.opcTypeOffset, entry.opcTypeLength) ||
+                !inStrings(entry.addressOffset, entry.addressLength) ||
+                !inStrings(entry.mappingsOffset, entry.mappingsLength) ||
+                !decodeMappings(strings + entry.mappingsOffset, entry.mappingsLength, &mappings)) {
+            LOG_WARNING("Snapshot: '%s' is corrupted, ignored", path.c_str());
+            return nullptr;
+        }
+        map.emplace(std::piecewise_construct,
+                std::forward_as_tuple(strings + entry.idOffset, entry.idLength),
+                std::forward_as_tuple(std::string(strings + entry.typeOffset, entry.typeLength),
+                        std::string(strings + entry.opcTypeOffset, entry.opcTypeLength),
+                        std::string(strings + entry.addressOffset, entry.addressLength), std::move(mappings)));
+    }
+    return DataDictionnary_Ptr(new DataDictionnary(std::move(map), static_cast<size_t>(header.duplicates)));
+}
+
+}   // namespace
+
+/**************************************************************************/
+uint64_t
+DictionarySnapshot::contentHash(const void* data, size_t size) {
+    static const uint64_t Prime1(0x9E3779B97F4A7C15ULL);
+    static const uint64_t Prime2(0xC2B2AE3D27D4EB4FULL);
+    const uint8_t* bytes(static_cast<const uint8_t*>(data));
+    // 4 independent lanes, so that large configurations are hashed at memory speed
+    uint64_t lanes[4] = {Prime1, Prime2, ~Prime1, ~Prime2};
+    size_t pos(0);
+    for ( ; pos + 32 <= size ; pos += 32) {
+        for (size_t lane = 0 ; lane < 4 ; lane++) {
+            uint64_t word;
+            memcpy(&word, bytes + pos + lane * 8, sizeof(word));
+            lanes[lane] = (lanes[lane] ^ word) * Prime1;
+            lanes[lane] ^= lanes[lane] >> 31;
+        }
+    }
+    uint64_t hash(size);
+    for (size_t lane = 0 ; lane < 4 ; lane++) {
+        hash = (hash ^ lanes[lane]) * Prime2;
+        hash ^= hash >> 29;
+    }
+    for ( ; pos < size ; pos++) {
+        hash = (hash ^ bytes[pos]) * Prime1;
+    }
+    hash ^= hash >> 32;
+    return hash;
+}
+
+/**************************************************************************/
+bool
+DictionarySnapshot::save(const std::string& path, uint64_t configHash, const DataDictionnary& dictionnary) {
+    // Entries and strings are contiguous in the file, so that they are checked with a single hash
+    std::vector<Entry_t> entries;
+    entries.reserve(dictionnary.size());
+    std::string strings;
+    std::unordered_map<std::string, uint32_t> types;
+    const auto addString = [&strings](const std::string& value) -> uint32_t {
+        const uint32_t offset(static_cast<uint32_t>(strings.size()));
+        strings.append(value);
+        return offset;
+    };
+    const auto addType = [&types, &addString](const std::string& value) -> uint32_t {
+        const std::unordered_map<std::string, uint32_t>::const_iterator it(types.find(value));
+        if (it != types.end()) return it->second;
+        const uint32_t offset(addString(value));
+        types.emplace(value, offset);
+        return offset;
+    };
+    const auto addField = [&strings](const std::string& value) -> void {
+        const uint32_t length(static_cast<uint32_t>(value.size()));
+        strings.append(reinterpret_cast<const char*>(&length), sizeof(length));
+        strings.append(value);
+    };
+    for (const PivotElementMap_t::value_type& item : dictionnary) {
+        Entry_t entry;
+        entry.idOffset = addString(item.first);
+        entry.idLength = static_cast<uint32_t>(item.first.size());
+        entry.typeOffset = addType(item.second.m_pivot_type);
+        entry.typeLength = static_cast<uint32_t>(item.second.m_pivot_type.size());
+        entry.opcTypeOffset = addType(item.second.m_opcType);
+        entry.opcTypeLength = static_cast<uint32_t>(item.second.m_opcType.size());
+        entry.addressOffset = addString(item.second.m_address);
+        entry.addressLength = static_cast<uint32_t>(item.second.m_address.size());
+        entry.mappingsOffset = static_cast<uint32_t>(strings.size());
+        for (const OpcuaMapping& mapping : item.second.m_mappings) {
+            addField(mapping.m_opcType);
+            addField(mapping.m_address);
+        }
+        entry.mappingsLength = static_cast<uint32_t>(strings.size()) - entry.mappingsOffset;
+        entries.push_back(entry);
+    }
+    if (strings.size() > UINT32_MAX) {
+        LOG_WARNING("Snapshot: dictionnary too large, not saved");
+        return false;
+    }
+
+    std::string payload(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(Entry_t));
+    payload.append(strings);
+    Header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SnapshotMagic, sizeof(SnapshotMagic));
+    header.version = Version;
+    header.byteOrder = ByteOrderMark;
+    header.configHash = configHash;
+    header.nbEntries = entries.size();
+    header.duplicates = dictionnary.duplicates();
+    header.stringsOffset = sizeof(Header_t) + entries.size() * sizeof(Entry_t);
+    header.stringsSize = strings.size();
+    header.checksum = contentHash(payload.data(), payload.size());
+
+    // Written aside, then renamed: a reader never sees a partial snapshot
+    const std::string tmpPath(path + ".tmp");
+    const int fd(::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644));
+    if (fd < 0) {
+        LOG_WARNING("Snapshot: cannot create '%s' (%s)", tmpPath.c_str(), strerror(errno));
+        return false;
+    }
+    const bool written(writeAll(fd, &header, sizeof(header)) && writeAll(fd, payload.data(), payload.size()));
+    if (::close(fd) != 0 || !written || rename(tmpPath.c_str(), path.c_str()) != 0) {
+        LOG_WARNING("Snapshot: cannot write '%s' (%s)", path.c_str(), strerror(errno));
+        unlink(tmpPath.c_str());
+        return false;
+    }
+    LOG_INFO("Snapshot: saved %u entries in '%s'", static_cast<unsigned>(entries.size()), path.c_str());
+    return true;
+}
+
+/**************************************************************************/
+DataDictionnary_Ptr
+DictionarySnapshot::load(const std::string& path, uint64_t configHash) {
+    if (path.empty()) return nullptr;
+    const int fd(::open(path.c_str(), O_RDONLY));
+    if (fd < 0) {
+        LOG_INFO("Snapshot: no '%s'", path.c_str());
+        return nullptr;
+    }
+    struct stat st;
+    void* map(MAP_FAILED);
+    if (fstat(fd, &st) == 0 && static_cast<uint64_t>(st.st_size) >= sizeof(Header_t)) {
+        map = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        LOG_WARNING("Snapshot: cannot map '%s', ignored", path.c_str());
+        return nullptr;
+    }
+    DataDictionnary_Ptr result(decode(static_cast<const uint8_t*>(map), static_cast<size_t>(st.st_size),
+            configHash, path));
+    munmap(map, static_cast<size_t>(st.st_size));
+    if (result != nullptr) {
+        LOG_INFO("Snapshot: loaded %u entries from '%s'", static_cast<unsigned>(result->size()), path.c_str());
+    }
+    return result;
+}
+
+/**************************************************************************/
+std::string
+DictionarySnapshot::defaultPath(const std::string& filterName) {
+    return dataPath(filterName, "_exchanged_data.snapshot");
+}
+
+/**************************************************************************/
+std::string
+DictionarySnapshot::dataPath(const std::string& filterName, const char* suffix) {
+    std::string dir;
+    const char* dataDir(getenv("FLEDGE_DATA"));
+    const char* root(getenv("FLEDGE_ROOT"));
+    if (dataDir != nullptr) {
+        dir = dataDir;
+    } else if (root != nullptr) {
+        dir = std::string(root) + "/data";
+    } else {
+        return "";
+    }
+    dir += std::string("/") + PluginDataFolder;
+    if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+        LOG_WARNING("Snapshot: cannot create folder '%s' (%s)", dir.c_str(), strerror(errno));
+        return "";
+    }
+    std::string name(filterName);
+    for (char& c : name) {
+        if (!isalnum(static_cast<unsigned char>(c)) && c != '-') c = '_';
+    }
+    return dir + "/" + name + suffix;
+}
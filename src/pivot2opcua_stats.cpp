@@ -0,0 +1,269 @@
+/*
+ * Fledge "pivottoopcua" filter plugin.
+ *
+ * Copyright (c) 2020 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include "pivot2opcua_stats.h"
+
+// System headers
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+/**************************************************************************/
+void
+ConversionStatistics::addSourceLatency(const std::string& comingFrom, int64_t delayUs) {
+    static const std::string others("__others__");
+
+    LatencyHistogramMap_t::iterator it(m_sourceLatency.find(comingFrom));
+    if (it == m_sourceLatency.end()) {
+        // Do not let a misbehaving source create an unbounded number of histograms
+        const std::string& key(m_sourceLatency.size() < MaxSources ? comingFrom : others);
+        it = m_sourceLatency.emplace(key, LatencyHistogram()).first;
+    }
+    it->second.add(delayUs);
+}
+
+void
+ConversionStatistics::setHandles(SignalHandles_SharedPtr handles) {
+    if (m_handles != nullptr && handles != m_handles) {
+        for (uint32_t handle : m_heavyHitters.keys()) {
+            const PivotElementMap_t::value_type* previous(m_handles->entry(handle));
+            const PivotElementMap_t::value_type* next(handles != nullptr ? handles->entry(handle) : nullptr);
+            if (previous == nullptr || next == nullptr || previous->first != next->first) {
+                m_heavyHitters.remove(handle);
+            }
+        }
+    }
+    m_handles = std::move(handles);
+}
+
+void
+ConversionStatistics::toJson(JsonWriter_t* writer)const {
+    static const std::string unassigned;
+    writer->Key("source_latency");
+    writer->StartObject();
+    for (const LatencyHistogramMap_t::value_type& source : m_sourceLatency) {
+        writer->Key(source.first.c_str());
+        source.second.toJson(writer);
+    }
+    writer->EndObject();
+    writer->Key("heavy_hitters");
+    m_heavyHitters.toJson(writer, TopHeavyHitters, [this](uint32_t handle) -> std::string {
+        const PivotElementMap_t::value_type* entry(m_handles != nullptr ? m_handles->entry(handle) : nullptr);
+        return entry != nullptr ? entry->first : unassigned;
+    });
+}
+
+/**************************************************************************/
+
+void
+FilterStatistics::addLaneLatency(bool command, int64_t delayUs) {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    (command ? m_commandLane : m_measurementLane).add(delayUs);
+}
+
+void
+FilterStatistics::addOutput(size_t nbReadings, bool timeout) {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_outputSets++;
+    m_outputReadings += nbReadings;
+    if (timeout) m_outputTimeouts++;
+}
+
+void
+FilterStatistics::addQueueWait(int64_t waitUs, size_t queued) {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_queueWait.add(waitUs);
+    m_queueDepth = queued;
+    // The set taken was queued too
+    if (queued + 1 > m_queueMaxDepth) m_queueMaxDepth = queued + 1;
+}
+
+void
+FilterStatistics::addQueueDrop(size_t nbReadings) {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_queueDroppedSets++;
+    m_queueDroppedReadings += nbReadings;
+}
+
+void
+FilterStatistics::addQueueBlocked(void) {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_queueBlocked++;
+}
+
+void
+FilterStatistics::configureCommands(size_t maxPending, int64_t timeoutUs) {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_commands.configure(maxPending, timeoutUs);
+}
+
+void
+FilterStatistics::addCommand(const std::string& pivotId, int64_t nowUs) {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_commands.addCommand(pivotId, nowUs);
+}
+
+void
+FilterStatistics::addCommandReply(const std::string& pivotId, bool ack, int64_t nowUs) {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_commands.addReply(pivotId, ack, nowUs);
+}
+
+void
+FilterStatistics::expireCommands(int64_t nowUs) {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_commands.expire(nowUs);
+}
+
+void
+FilterStatistics::addDictionaryBuild(uint64_t generation, size_t entries, int64_t durationUs) {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_dictGeneration = generation;
+    m_dictEntries = entries;
+    m_dictBuildUs = durationUs;
+}
+
+void
+FilterStatistics::addDictionaryBuildFailure(bool cancelled) {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    if (cancelled) {
+        m_dictCancelled++;
+    } else {
+        m_dictFailed++;
+    }
+}
+
+bool
+FilterStatistics::addUnknownId(const std::string& pivotId) {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_unknownRejected++;
+    m_unknownDistinct.add(pivotId);
+    std::map<std::string, UnknownId>::iterator it(m_unknownIds.find(pivotId));
+    if (it != m_unknownIds.end()) {
+        it->second.count++;
+        it->second.lastSeen = m_unknownRejected;
+        return false;
+    }
+    if (m_unknownIds.size() >= MaxUnknownIds) {
+        // Forget the least recently seen one
+        std::map<std::string, UnknownId>::iterator oldest(m_unknownIds.begin());
+        for (it = m_unknownIds.begin() ; it != m_unknownIds.end() ; ++it) {
+            if (it->second.lastSeen < oldest->second.lastSeen) oldest = it;
+        }
+        m_unknownIds.erase(oldest);
+    }
+    m_unknownIds.emplace(pivotId, UnknownId{1, m_unknownRejected});
+    return true;
+}
+
+void
+FilterStatistics::setDictionaryUsage(std::shared_ptr<const DictionaryUsage> usage) {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_dictUsage = std::move(usage);
+}
+
+std::string
+FilterStatistics::toJson(const ConversionStatistics* conversions)const {
+    rapidjson::StringBuffer buffer;
+    JsonWriter_t writer(buffer);
+
+    std::lock_guard<std::mutex> guard(m_mutex);
+    writer.StartObject();
+    if (conversions != nullptr) conversions->toJson(&writer);
+    writer.Key("lane_latency");
+    writer.StartObject();
+    writer.Key("command");
+    m_commandLane.toJson(&writer);
+    writer.Key("measurement");
+    m_measurementLane.toJson(&writer);
+    writer.EndObject();
+    writer.Key("output");
+    writer.StartObject();
+    writer.Key("sets");
+    writer.Uint64(m_outputSets);
+    writer.Key("readings");
+    writer.Uint64(m_outputReadings);
+    writer.Key("batch_timeouts");
+    writer.Uint64(m_outputTimeouts);
+    writer.EndObject();
+    writer.Key("ingest_queue");
+    writer.StartObject();
+    writer.Key("depth");
+    writer.Uint64(m_queueDepth);
+    writer.Key("max_depth");
+    writer.Uint64(m_queueMaxDepth);
+    writer.Key("dropped_sets");
+    writer.Uint64(m_queueDroppedSets);
+    writer.Key("dropped_readings");
+    writer.Uint64(m_queueDroppedReadings);
+    writer.Key("blocked_pushes");
+    writer.Uint64(m_queueBlocked);
+    writer.Key("wait");
+    m_queueWait.toJson(&writer);
+    writer.EndObject();
+    writer.Key("command_round_trip");
+    m_commands.toJson(&writer);
+    writer.Key("dictionary");
+    writer.StartObject();
+    writer.Key("generation");
+    writer.Uint64(m_dictGeneration);
+    writer.Key("entries");
+    writer.Uint64(m_dictEntries);
+    writer.Key("build_duration_us");
+    writer.Int64(m_dictBuildUs);
+    writer.Key("cancelled_builds");
+    writer.Uint64(m_dictCancelled);
+    writer.Key("failed_builds");
+    writer.Uint64(m_dictFailed);
+    writer.EndObject();
+    writer.Key("dictionary_usage");
+    if (m_dictUsage != nullptr) {
+        m_dictUsage->toJson(&writer);
+    } else {
+        writer.Null();
+    }
+    writer.Key("unknown_ids");
+    writer.StartObject();
+    writer.Key("rejected");
+    writer.Uint64(m_unknownRejected);
+    writer.Key("distinct_estimate");
+    writer.Uint64(m_unknownDistinct.estimate());
+    writer.Key("recent");
+    writer.StartObject();
+    for (const std::map<std::string, UnknownId>::value_type& unknown : m_unknownIds) {
+        writer.Key(unknown.first.c_str());
+        writer.Uint64(unknown.second.count);
+    }
+    writer.EndObject();
+    // Most frequent first (among the recently seen ones)
+    std::vector<const std::map<std::string, UnknownId>::value_type*> top;
+    for (const std::map<std::string, UnknownId>::value_type& unknown : m_unknownIds) {
+        top.push_back(&unknown);
+    }
+    const size_t nbTop(top.size() < TopUnknownIds ? top.size() : TopUnknownIds);
+    std::partial_sort(top.begin(), top.begin() + nbTop, top.end(),
+            [](const std::map<std::string, UnknownId>::value_type* left,
+               const std::map<std::string, UnknownId>::value_type* right) -> bool {
+        return left->second.count > right->second.count ||
+                (left->second.count == right->second.count && left->first < right->first);
+    });
+    writer.Key("top");
+    writer.StartArray();
+    for (size_t i = 0 ; i < nbTop ; i++) {
+        writer.StartObject();
+        writer.Key("id");
+        writer.String(top[i]->first.c_str());
+        writer.Key("count");
+        writer.Uint64(top[i]->second.count);
+        writer.EndObject();
+    }
+    writer.EndArray();
+    writer.EndObject();
+    writer.EndObject();
+    return buffer.GetString();
+}
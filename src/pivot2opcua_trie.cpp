@@ -0,0 +1,149 @@
+/*
+ * Fledge "pivottoopcua" filter plugin.
+ *
+ * Copyright (c) 2020 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include "pivot2opcua_trie.h"
+
+// System headers
+#include <utility>
+#include <vector>
+
+/**************************************************************************/
+struct PivotIdTrie::Node {
+    /** Literal transitions. First characters of labels are all different */
+    struct Edge {
+        std::string             label;
+        std::unique_ptr<Node>   child;
+    };
+    /** Best match found so far */
+    struct Best {
+        const PivotElement*     element = nullptr;
+        const std::string*      pattern = nullptr;
+        size_t                  literals = 0;
+    };
+
+    std::vector<Edge>       edges;
+    std::unique_ptr<Node>   star;       /// '*'
+    std::unique_ptr<Node>   globStar;   /// '**'
+    const PivotElement*     element = nullptr;  /// Set if a pattern ends here
+    std::string             pattern;
+    size_t                  literals = 0;
+
+    Node* literal(const std::string& label, size_t pos, size_t length);
+    void match(const std::string& key, size_t pos, Best* best)const;
+};
+
+/**
+ * @return The node reached from this one with label.substr(pos, length),
+ *      created (and existing edges split) if needed
+ */
+PivotIdTrie::Node*
+PivotIdTrie::Node::literal(const std::string& label, size_t pos, size_t length) {
+    Node* node(this);
+    while (length > 0) {
+        Edge* edge(nullptr);
+        for (Edge& candidate : node->edges) {
+            if (candidate.label[0] == label[pos]) {
+                edge = &candidate;
+                break;
+            }
+        }
+        if (edge == nullptr) {
+            node->edges.push_back(Edge{label.substr(pos, length), std::unique_ptr<Node>(new Node)});
+            return node->edges.back().child.get();
+        }
+        size_t common(1);
+        while (common < length && common < edge->label.size() && edge->label[common] == label[pos + common]) {
+            common++;
+        }
+        if (common < edge->label.size()) {
+            // Split the edge
+            std::unique_ptr<Node> middle(new Node);
+            middle->edges.push_back(Edge{edge->label.substr(common), std::move(edge->child)});
+            edge->label.resize(common);
+            edge->child = std::move(middle);
+        }
+        node = edge->child.get();
+        pos += common;
+        length -= common;
+    }
+    return node;
+}
+
+void
+PivotIdTrie::Node::match(const std::string& key, size_t pos, Best* best)const {
+    if (pos == key.size() && element != nullptr) {
+        if (best->element == nullptr || literals > best->literals ||
+                (literals == best->literals && pattern < *best->pattern)) {
+            best->element = element;
+            best->pattern = &pattern;
+            best->literals = literals;
+        }
+    }
+    if (pos < key.size()) {
+        for (const Edge& edge : edges) {
+            if (edge.label[0] == key[pos]) {
+                if (key.compare(pos, edge.label.size(), edge.label) == 0) {
+                    edge.child->match(key, pos + edge.label.size(), best);
+                }
+                break;
+            }
+        }
+    }
+    if (star != nullptr) {
+        for (size_t end(pos) ; ; end++) {
+            star->match(key, end, best);
+            if (end == key.size() || key[end] == '/') break;
+        }
+    }
+    if (globStar != nullptr) {
+        for (size_t end(pos) ; end <= key.size() ; end++) {
+            globStar->match(key, end, best);
+        }
+    }
+}
+
+/**************************************************************************/
+PivotIdTrie::PivotIdTrie(void):
+    m_root(new Node) {}
+
+PivotIdTrie::~PivotIdTrie(void) = default;
+
+void
+PivotIdTrie::insert(const std::string& pattern, const PivotElement* element) {
+    Node* node(m_root.get());
+    size_t literals(0);
+    size_t pos(0);
+    while (pos < pattern.size()) {
+        if (pattern[pos] == '*') {
+            size_t stars(0);
+            for ( ; pos < pattern.size() && pattern[pos] == '*' ; pos++) {
+                stars++;
+            }
+            std::unique_ptr<Node>& next(stars > 1 ? node->globStar : node->star);
+            if (next == nullptr) next.reset(new Node);
+            node = next.get();
+        } else {
+            size_t end(pattern.find('*', pos));
+            if (end == std::string::npos) end = pattern.size();
+            node = node->literal(pattern, pos, end - pos);
+            literals += end - pos;
+            pos = end;
+        }
+    }
+    if (node->element == nullptr) m_size++;
+    node->element = element;
+    node->pattern = pattern;
+    node->literals = literals;
+}
+
+const PivotElement*
+PivotIdTrie::match(const std::string& pivotId)const {
+    Node::Best best;
+    m_root->match(pivotId, 0, &best);
+    return best.element;
+}
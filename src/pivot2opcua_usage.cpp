@@ -0,0 +1,73 @@
+/*
+ * Fledge "pivottoopcua" filter plugin.
+ *
+ * Copyright (c) 2020 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+#include "pivot2opcua_usage.h"
+
+// System headers
+#include <algorithm>
+#include <string>
+#include <vector>
+
+/**************************************************************************/
+DictionaryUsage::DictionaryUsage(DataDictionnary_SharedPtr dictionnary, const DictionaryUsage* previous):
+    m_dictionnary(std::move(dictionnary)),
+    m_nbWords((m_dictionnary->size() + 63) / 64),
+    m_bits(new std::atomic<uint64_t>[m_nbWords > 0 ? m_nbWords : 1]) {
+    for (size_t i = 0 ; i < m_nbWords ; i++) {
+        m_bits[i].store(0, std::memory_order_relaxed);
+    }
+    if (previous == nullptr) return;
+    for (const PivotElementMap_t::value_type& item : *previous->m_dictionnary) {
+        if (!previous->isUsed(item.second.m_index)) continue;
+        const PivotElementMap_t::const_iterator it(m_dictionnary->find(item.first));
+        if (!m_dictionnary->isEmpty(it)) hit(it->second);
+    }
+}
+
+size_t
+DictionaryUsage::used(void)const {
+    size_t result(0);
+    for (size_t i = 0 ; i < m_nbWords ; i++) {
+        result += static_cast<size_t>(__builtin_popcountll(m_bits[i].load(std::memory_order_relaxed)));
+    }
+    return result;
+}
+
+void
+DictionaryUsage::toJson(JsonWriter_t* writer)const {
+    // Only keep the first unused ids (alphabetically), so that reports are stable
+    std::vector<const std::string*> unused;
+    size_t nbUnused(0);
+    const auto byName = [](const std::string* left, const std::string* right) -> bool {return *left < *right;};
+    for (const PivotElementMap_t::value_type& item : *m_dictionnary) {
+        if (isUsed(item.second.m_index)) continue;
+        nbUnused++;
+        unused.push_back(&item.first);
+        if (unused.size() >= 2 * MaxUnusedReported) {
+            std::sort(unused.begin(), unused.end(), byName);
+            unused.resize(MaxUnusedReported);
+        }
+    }
+    std::sort(unused.begin(), unused.end(), byName);
+    if (unused.size() > MaxUnusedReported) unused.resize(MaxUnusedReported);
+
+    writer->StartObject();
+    writer->Key("entries");
+    writer->Uint64(m_dictionnary->size());
+    writer->Key("used");
+    writer->Uint64(m_dictionnary->size() - nbUnused);
+    writer->Key("unused");
+    writer->Uint64(nbUnused);
+    writer->Key("unused_ids");
+    writer->StartArray();
+    for (const std::string* id : unused) {
+        writer->String(id->c_str());
+    }
+    writer->EndArray();
+    writer->EndObject();
+}
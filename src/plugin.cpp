@@ -39,6 +39,119 @@ static const char * const default_config = QUOTE({
                         "displayName" : "Exchanged data list",
                         "order" : "3",
                         "default" : EXCHANGED_DATA_DEF
+                       },
+                "latency_stamp": {
+                        "description" : "Add the source to filter delay (do_filter_latency_us) in converted data",
+                        "type" : "boolean",
+                        "displayName" : "Stamp source latency",
+                        "order" : "4",
+                        "default" : "false"
+                       },
+                "stats_period": {
+                        "description" : "Period (in seconds) of statistics reports in logs. 0 to disable",
+                        "type" : "integer",
+                        "displayName" : "Statistics period",
+                        "order" : "5",
+                        "default" : "0"
+                       },
+                "command_timeout": {
+                        "description" : "Delay (in seconds) before a command without reply is timed-out",
+                        "type" : "integer",
+                        "displayName" : "Command reply timeout",
+                        "order" : "6",
+                        "default" : "30"
+                       },
+                "command_max_pending": {
+                        "description" : "Maximum number of commands waiting for a reply. 0 to disable",
+                        "type" : "integer",
+                        "displayName" : "Max pending commands",
+                        "order" : "7",
+                        "default" : "1000"
+                       },
+                "capture_file": {
+                        "description" : "File recording all input readings (relative to Fledge data). Empty to disable",
+                        "type" : "string",
+                        "displayName" : "Capture file",
+                        "order" : "8",
+                        "default" : ""
+                       },
+                "capture_size": {
+                        "description" : "Maximum size (in MB) of the capture file. Oldest readings are overwritten",
+                        "type" : "integer",
+                        "displayName" : "Capture size",
+                        "order" : "9",
+                        "default" : "64"
+                       },
+                "dictionary_threads": {
+                        "description" : "Threads parsing large exchanged_data (0: one per CPU)",
+                        "type" : "integer",
+                        "displayName" : "Configuration threads",
+                        "order" : "10",
+                        "default" : "0"
+                       },
+                "dictionary_snapshot": {
+                        "description" : "Save the parsed exchanged_data in the plugin data folder for faster restarts",
+                        "type" : "boolean",
+                        "displayName" : "Configuration snapshot",
+                        "order" : "11",
+                        "default" : "true"
+                       },
+                "chunk_size": {
+                        "description" : "Larger reading sets are passed on by chunks, while converting. 0 to disable",
+                        "type" : "integer",
+                        "displayName" : "Chunk size",
+                        "order" : "12",
+                        "default" : "0"
+                       },
+                "batch_size": {
+                        "description" : "Small reading sets are merged up to that many readings. 0 to disable",
+                        "type" : "integer",
+                        "displayName" : "Batch size",
+                        "order" : "13",
+                        "default" : "0"
+                       },
+                "batch_delay_us": {
+                        "description" : "Maximum delay (in micro-seconds) of readings waiting for a batch to be full",
+                        "type" : "integer",
+                        "displayName" : "Batch delay",
+                        "order" : "14",
+                        "default" : "5000"
+                       },
+                "async_queue": {
+                        "description" : "Sets queued for a conversion thread (applied on restart). 0 to disable",
+                        "type" : "integer",
+                        "displayName" : "Ingest queue depth",
+                        "order" : "15",
+                        "default" : "0"
+                       },
+                "async_full_policy": {
+                        "description" : "When the ingest queue is full: wait for room, or drop the oldest set",
+                        "type" : "enumeration",
+                        "options" : ["block", "drop_oldest"],
+                        "displayName" : "Full queue policy",
+                        "order" : "16",
+                        "default" : "block"
+                       },
+                "asset_routing": {
+                        "description" : "Conversion per asset name or prefix (pivot2opcua, opcua2pivot, passthrough)",
+                        "type" : "JSON",
+                        "displayName" : "Asset routing",
+                        "order" : "17",
+                        "default" : ASSET_ROUTING_DEF
+                       },
+                "compact_output": {
+                        "description" : "Omit default fields and encode enumerations as integers in data_object",
+                        "type" : "boolean",
+                        "displayName" : "Compact output",
+                        "order" : "18",
+                        "default" : "false"
+                       },
+                "packed_output": {
+                        "description" : "Publish measurements as a binary record (do_packed), for co-located consumers",
+                        "type" : "boolean",
+                        "displayName" : "Packed output",
+                        "order" : "19",
+                        "default" : "false"
                        }
                 });
 
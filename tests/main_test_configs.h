@@ -388,6 +388,12 @@ static uint32_t checkRoResult(Datapoints* dp, const string& id, int reply) {
              ]\
         }})
 
+/** Json_ExDataOK where "pivotMVF" is published to 2 OPC UA variables */
+inline std::string getExDataMultiMapping(void) {
+    return replace_in_string(Json_ExDataOK, QUOTE("address":"mvf"),
+            QUOTE("address":"mvf_raw", "typeid":"opcua_mvi"}, {"name":"opcua", "address":"mvf"));
+}
+
 //////////////////////////////////////
 // TEST CONFIGURATIONS
 static const char * const JsonPlugConfDisabled =
@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+#include <plugin_api.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+// Tested files
+#include "pivot2opcua_common.h"
+#include "pivot2opcua_filter.h"
+#include "pivot2opcua_batcher.h"
+
+// Fledge / tools  includes
+#include "config_category.h"
+#include "main_test_configs.h"
+
+using namespace std;
+
+/** Test pivot2opcua_batcher APIs */
+
+namespace {
+
+struct Outputs {
+    std::mutex              mutex;
+    std::vector<size_t>     sizes;
+    std::vector<string>     firstAssets;
+    size_t                  timeouts = 0;
+};
+
+ReadingSet* newReadingSet(size_t nbReadings, const string& asset) {
+    ReadingSet* result(new ReadingSet);
+    for (size_t i = 0 ; i < nbReadings ; i++) {
+        appendJsonToReadingSet(*result, JsonPivotMvf, asset);
+    }
+    return result;
+}
+
+ReadingBatcher::Output_t recorder(Outputs* outputs) {
+    return [outputs](ReadingSet* readingSet, bool timeout) {
+        std::lock_guard<std::mutex> guard(outputs->mutex);
+        outputs->sizes.push_back(readingSet->getAllReadings().size());
+        outputs->firstAssets.push_back(readingSet->getAllReadings().front()->getAssetName());
+        if (timeout) outputs->timeouts++;
+        delete readingSet;
+    };
+}
+
+}   // namespace
+
+/* Sets are merged until the batch is full */
+TEST(Pivot2Opcua_Batcher, Size) {
+    TITLE("*** TEST BATCHER Size");
+    Outputs outputs;
+    {
+        ReadingBatcher batcher(recorder(&outputs));
+        // Disabled: passed on at once
+        batcher.push(newReadingSet(1, "A"));
+        ASSERT_EQ(outputs.sizes.size(), 1);
+
+        batcher.configure(5, 10000000);
+        for (int i = 0 ; i < 4 ; i++) {
+            batcher.push(newReadingSet(2, "B" + std::to_string(i)));
+            ASSERT_EQ(outputs.sizes.size(), 1 + i / 2);
+        }
+        ASSERT_EQ(outputs.sizes[1], 6);
+        ASSERT_EQ(outputs.firstAssets[1], "B0");
+
+        // Remaining readings are passed on when disabled, and on destruction
+        batcher.push(newReadingSet(1, "C"));
+        batcher.configure(0, 0);
+        ASSERT_EQ(outputs.sizes.size(), 3);
+        ASSERT_EQ(outputs.sizes[2], 3);
+        batcher.configure(100, 10000000);
+        batcher.push(newReadingSet(1, "D"));
+        ASSERT_EQ(outputs.sizes.size(), 3);
+    }
+    ASSERT_EQ(outputs.sizes.size(), 4);
+    ASSERT_EQ(outputs.firstAssets[3], "D");
+    ASSERT_EQ(outputs.timeouts, 0);
+}
+
+/* Pending readings are passed on after the maximum delay, even without new sets */
+TEST(Pivot2Opcua_Batcher, Delay) {
+    TITLE("*** TEST BATCHER Delay");
+    Outputs outputs;
+    ReadingBatcher batcher(recorder(&outputs));
+    batcher.configure(100, 20000);
+    batcher.push(newReadingSet(1, "A"));
+    batcher.push(newReadingSet(1, "B"));
+    for (int i = 0 ; i < 200 ; i++) {
+        {
+            std::lock_guard<std::mutex> guard(outputs.mutex);
+            if (!outputs.sizes.empty()) break;
+        }
+        usleep(10000);
+    }
+    std::lock_guard<std::mutex> guard(outputs.mutex);
+    ASSERT_EQ(outputs.sizes.size(), 1);
+    ASSERT_EQ(outputs.sizes[0], 2);
+    ASSERT_EQ(outputs.timeouts, 1);
+}
+
+/* Priority sets are passed on at once, before the pending readings */
+TEST(Pivot2Opcua_Batcher, Bypass) {
+    TITLE("*** TEST BATCHER Bypass");
+    Outputs outputs;
+    {
+        ReadingBatcher batcher(recorder(&outputs));
+        batcher.configure(100, 10000000);
+        batcher.push(newReadingSet(2, "A"));
+        batcher.bypass(newReadingSet(1, "B"));
+        ASSERT_EQ(outputs.sizes.size(), 1);
+        ASSERT_EQ(outputs.firstAssets[0], "B");
+    }
+    ASSERT_EQ(outputs.sizes.size(), 2);
+    ASSERT_EQ(outputs.sizes[1], 2);
+    ASSERT_EQ(outputs.firstAssets[1], "A");
+}
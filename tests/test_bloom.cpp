@@ -0,0 +1,42 @@
+#include <gtest/gtest.h>
+#include <plugin_api.h>
+#include <string.h>
+#include <string>
+
+// Tested files
+#include "pivot2opcua_common.h"
+#include "pivot2opcua_filter.h"
+#include "pivot2opcua_bloom.h"
+
+// Fledge / tools  includes
+#include "config_category.h"
+#include "main_test_configs.h"
+
+using namespace std;
+
+/** Test pivot2opcua_bloom APIs */
+
+/* No false negatives, few false positives */
+TEST(Pivot2Opcua_Bloom, BloomFilter) {
+    TITLE("*** TEST BLOOM BloomFilter");
+    const BloomFilter empty;
+    ASSERT_FALSE(empty.mayContain("pivot1"));
+    ASSERT_FALSE(empty.mayContain(""));
+
+    const int nbKeys(10000);
+    BloomFilter filter(nbKeys);
+    ASSERT_GT(filter.bytes(), 0);
+    for (int i = 0 ; i < nbKeys ; i++) {
+        filter.add("S" + std::to_string(i / 100) + "/B" + std::to_string(i % 100) + "/Pos");
+    }
+    for (int i = 0 ; i < nbKeys ; i++) {
+        ASSERT_TRUE(filter.mayContain("S" + std::to_string(i / 100) + "/B" + std::to_string(i % 100) + "/Pos"));
+    }
+    int falsePositives(0);
+    for (int i = 0 ; i < nbKeys ; i++) {
+        if (filter.mayContain("S" + std::to_string(i / 100) + "/B" + std::to_string(i % 100) + "/Alarm")) {
+            falsePositives++;
+        }
+    }
+    ASSERT_LT(falsePositives, nbKeys / 30);
+}
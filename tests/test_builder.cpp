@@ -0,0 +1,64 @@
+#include <gtest/gtest.h>
+#include <plugin_api.h>
+#include <string.h>
+#include <unistd.h>
+#include <atomic>
+#include <string>
+
+// Tested files
+#include "pivot2opcua_common.h"
+#include "pivot2opcua_filter.h"
+#include "pivot2opcua_builder.h"
+
+// Fledge / tools  includes
+#include "config_category.h"
+#include "main_test_configs.h"
+
+using namespace std;
+
+/** Test pivot2opcua_builder APIs */
+
+/* A new job cancels the running one, and replaces the pending one */
+TEST(Pivot2Opcua_Builder, Cancel) {
+    TITLE("*** TEST BUILDER Cancel");
+    std::atomic<bool> started(false);
+    std::atomic<bool> firstCancelled(false);
+    std::atomic<bool> release(false);
+    std::atomic<int> nbRuns(0);
+    DictionaryBuilder builder;
+    builder.waitIdle();
+
+    builder.submit([&](const std::atomic<bool>& cancelled) {
+        started = true;
+        while (!cancelled) usleep(1000);
+        firstCancelled = true;
+        while (!release) usleep(1000);
+    });
+    while (!started) usleep(1000);
+    // The second job is replaced by the third one before it starts
+    builder.submit([&](const std::atomic<bool>&) {nbRuns += 100;});
+    builder.submit([&](const std::atomic<bool>& cancelled) {
+        ASSERT_FALSE(cancelled);
+        nbRuns++;
+    });
+    release = true;
+    builder.waitIdle();
+    ASSERT_TRUE(firstCancelled);
+    ASSERT_EQ(nbRuns, 1);
+
+    // Errors do not stop the thread
+    builder.submit([](const std::atomic<bool>&) {throw std::exception();});
+    builder.submit([&](const std::atomic<bool>&) {nbRuns++;});
+    builder.waitIdle();
+    ASSERT_EQ(nbRuns, 2);
+}
+
+/* The dictionnary build stops when cancelled */
+TEST(Pivot2Opcua_Builder, DictionnaryCancel) {
+    TITLE("*** TEST BUILDER DictionnaryCancel");
+    std::atomic<bool> cancel(true);
+    ASSERT_THROW(DataDictionnary dict(Json_ExDataOK, 1, &cancel), DataDictionnary::BuildCancelled);
+    cancel = false;
+    DataDictionnary dict(Json_ExDataOK, 1, &cancel);
+    ASSERT_FALSE(dict.isEmpty(dict.find("pivot1")));
+}
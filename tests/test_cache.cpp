@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+#include <plugin_api.h>
+#include <string.h>
+#include <unistd.h>
+#include <atomic>
+#include <exception>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Tested files
+#include "pivot2opcua_common.h"
+#include "pivot2opcua_filter.h"
+#include "pivot2opcua_data.h"
+#include "pivot2opcua_cache.h"
+
+// Fledge / tools  includes
+#include "config_category.h"
+#include "main_test_configs.h"
+
+using namespace std;
+
+/** Test pivot2opcua_cache APIs */
+
+/* Dictionnaries are shared while in use */
+TEST(Pivot2Opcua_Cache, Sharing) {
+    TITLE("*** TEST CACHE Sharing");
+    const size_t initialSize(DictionaryCache::size());
+    int nbBuilds(0);
+    const DictionaryCache::Builder_t builder([&nbBuilds]() {
+        nbBuilds++;
+        return DataDictionnary_Ptr(new DataDictionnary(Json_ExDataOK));
+    });
+
+    DataDictionnary_SharedPtr dic1(DictionaryCache::get(1, 100, builder));
+    DataDictionnary_SharedPtr dic2(DictionaryCache::get(1, 100, builder));
+    ASSERT_EQ(nbBuilds, 1);
+    ASSERT_EQ(dic1, dic2);
+    ASSERT_EQ(DictionaryCache::size(), initialSize + 1);
+    DataDictionnary_SharedPtr dic3(DictionaryCache::get(1, 101, builder));
+    ASSERT_EQ(nbBuilds, 2);
+    ASSERT_NE(dic1, dic3);
+    ASSERT_EQ(DictionaryCache::size(), initialSize + 2);
+
+    // Freed when no more used
+    dic1.reset();
+    dic3.reset();
+    ASSERT_EQ(DictionaryCache::size(), initialSize + 1);
+    dic2.reset();
+    ASSERT_EQ(DictionaryCache::size(), initialSize);
+    dic1 = DictionaryCache::get(1, 100, builder);
+    ASSERT_EQ(nbBuilds, 3);
+
+    // Build errors are reported, and the next call builds again
+    ASSERT_THROW(DictionaryCache::get(2, 100, []() -> DataDictionnary_Ptr {
+        throw std::exception();
+    }), std::exception);
+    DataDictionnary_SharedPtr dic4(DictionaryCache::get(2, 100, builder));
+    ASSERT_NE(dic4, nullptr);
+    ASSERT_EQ(nbBuilds, 4);
+}
+
+/* Concurrent requests build a dictionnary only once */
+TEST(Pivot2Opcua_Cache, Concurrency) {
+    TITLE("*** TEST CACHE Concurrency");
+    std::atomic<int> nbBuilds(0);
+    const DictionaryCache::Builder_t builder([&nbBuilds]() {
+        nbBuilds++;
+        usleep(50000);
+        return DataDictionnary_Ptr(new DataDictionnary(Json_ExDataOK));
+    });
+
+    std::vector<DataDictionnary_SharedPtr> results(8);
+    std::vector<std::thread> threads;
+    for (size_t i = 0 ; i < results.size() ; i++) {
+        threads.emplace_back([i, &results, &builder]() {
+            results[i] = DictionaryCache::get(3, 100, builder);
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    ASSERT_EQ(nbBuilds, 1);
+    for (const DataDictionnary_SharedPtr& result : results) {
+        ASSERT_NE(result, nullptr);
+        ASSERT_EQ(result, results[0]);
+    }
+}
@@ -0,0 +1,186 @@
+#include <gtest/gtest.h>
+#include <plugin_api.h>
+#include <string.h>
+#include <unistd.h>
+#include <exception>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Tested files
+#include "pivot2opcua_common.h"
+#include "pivot2opcua_filter.h"
+#include "pivot2opcua_capture.h"
+
+// Fledge / tools  includes
+#include "config_category.h"
+#include "main_test_configs.h"
+
+using namespace std;
+
+/** Test pivot2opcua_capture APIs */
+
+namespace {
+string tempCaptureFile(const string& name) {
+    return string("/tmp/p2o_") + name + "_" + std::to_string(getpid()) + ".cap";
+}
+
+struct Batch {
+    uint64_t seq;
+    int64_t captureTimeUs;
+    vector<Reading*> readings;
+};
+
+vector<Batch> readCapture(const string& path) {
+    vector<Batch> result;
+    const bool valid(ReadingCapture::readFile(path,
+            [&result](const ReadingCapture::CaptureIndexEntry& entry, const uint8_t* data) {
+        Batch batch;
+        batch.seq = entry.seq;
+        batch.captureTimeUs = entry.captureTimeUs;
+        batch.readings = ReadingCapture::decodeBatch(data, entry.length, entry.nbReadings);
+        result.push_back(batch);
+    }));
+    EXPECT_TRUE(valid);
+    return result;
+}
+
+void freeCapture(vector<Batch>* batches) {
+    for (Batch& batch : *batches) {
+        for (Reading* reading : batch.readings) {
+            delete reading;
+        }
+    }
+    batches->clear();
+}
+}   // namespace
+
+/* Encoding/decoding of all supported datapoint types */
+TEST(Pivot2Opcua_Capture, RoundTrip) {
+    TITLE("*** TEST CAPTURE RoundTrip");
+    const string path(tempCaptureFile("roundtrip"));
+    unlink(path.c_str());
+
+    ReadingSet rSet;
+    appendJsonToReadingSet(rSet, JsonPivotMvf, "Asset1");
+    {
+        Datapoints* items(new Datapoints);
+        DatapointValue intValue(static_cast<long>(-42));  // //NOLINT
+        items->push_back(new Datapoint("l1", intValue));
+        DatapointValue strValue(string("str"));
+        items->push_back(new Datapoint("l2", strValue));
+        DatapointValue listValue(items, false);
+        Datapoint* list(new Datapoint("list", listValue));
+        vector<Datapoint*> values;
+        values.push_back(list);
+        DatapointValue arrayValue(vector<double>({1.5, -2.25}));
+        values.push_back(new Datapoint("array", arrayValue));
+        DatapointValue floatValue(3.125);
+        values.push_back(new Datapoint("float", floatValue));
+        vector<Reading*> readings;
+        readings.push_back(new Reading("Asset2", values));
+        struct timeval tv = {1234, 567};
+        readings.back()->setUserTimestamp(tv);
+        tv.tv_usec = 890;
+        readings.back()->setTimestamp(tv);
+        rSet.append(readings);
+    }
+
+    ReadingCapture capture;
+    ASSERT_TRUE(capture.open(path, 1 << 20));
+    ASSERT_TRUE(capture.capture(&rSet, 1000));
+    ASSERT_EQ(capture.batches(), 1);
+    capture.close();
+
+    vector<Batch> batches(readCapture(path));
+    ASSERT_EQ(batches.size(), 1);
+    ASSERT_EQ(batches[0].seq, 0);
+    ASSERT_EQ(batches[0].captureTimeUs, 1000);
+    ASSERT_EQ(batches[0].readings.size(), rSet.getAllReadings().size());
+    for (size_t i = 0 ; i < batches[0].readings.size() ; i++) {
+        Reading* orig(rSet.getAllReadings()[i]);
+        Reading* decoded(batches[0].readings[i]);
+        ASSERT_EQ(decoded->getAssetName(), orig->getAssetName());
+        ASSERT_EQ(decoded->getDatapointsJSON(), orig->getDatapointsJSON());
+        struct timeval tv1, tv2;
+        orig->getTimestamp(&tv1);
+        decoded->getTimestamp(&tv2);
+        ASSERT_EQ(tv1.tv_sec, tv2.tv_sec);
+        ASSERT_EQ(tv1.tv_usec, tv2.tv_usec);
+        orig->getUserTimestamp(&tv1);
+        decoded->getUserTimestamp(&tv2);
+        ASSERT_EQ(tv1.tv_sec, tv2.tv_sec);
+        ASSERT_EQ(tv1.tv_usec, tv2.tv_usec);
+    }
+    freeCapture(&batches);
+
+    // Corrupted batches are rejected
+    const uint8_t garbage[] = {5, 'a', 'b'};
+    ASSERT_THROW(ReadingCapture::decodeBatch(garbage, sizeof(garbage), 1), std::exception);
+    ASSERT_FALSE(ReadingCapture::readFile("/dev/null", [](const ReadingCapture::CaptureIndexEntry&,
+            const uint8_t*) {}));
+    unlink(path.c_str());
+}
+
+/* The capture file is a bounded ring */
+TEST(Pivot2Opcua_Capture, Ring) {
+    TITLE("*** TEST CAPTURE Ring");
+    const string path(tempCaptureFile("ring"));
+    unlink(path.c_str());
+
+    ReadingCapture capture;
+    ASSERT_FALSE(capture.open(path, 1024));
+    ASSERT_FALSE(capture.isOpen());
+    ASSERT_TRUE(capture.open(path, 64 * 1024));
+    for (int i = 0 ; i < 500 ; i++) {
+        ReadingSet rSet;
+        appendJsonToReadingSet(rSet, JsonPivotMvf, "Asset" + std::to_string(i));
+        ASSERT_TRUE(capture.capture(&rSet, i));
+    }
+    capture.close();
+
+    vector<Batch> batches(readCapture(path));
+    ASSERT_GT(batches.size(), 10);
+    ASSERT_LT(batches.size(), 500);
+    for (size_t i = 0 ; i < batches.size() ; i++) {
+        const uint64_t seq(500 - batches.size() + i);
+        ASSERT_EQ(batches[i].seq, seq);
+        ASSERT_EQ(batches[i].readings.size(), 1);
+        ASSERT_EQ(batches[i].readings[0]->getAssetName(), "Asset" + std::to_string(seq));
+    }
+    freeCapture(&batches);
+
+    // An existing capture is appended
+    ASSERT_TRUE(capture.open(path, 64 * 1024));
+    {
+        ReadingSet rSet;
+        appendJsonToReadingSet(rSet, JsonPivotMvf, "Last");
+        ASSERT_TRUE(capture.capture(&rSet, 0));
+    }
+    capture.close();
+    batches = readCapture(path);
+    ASSERT_EQ(batches.back().seq, 500);
+    ASSERT_EQ(batches.back().readings[0]->getAssetName(), "Last");
+    freeCapture(&batches);
+
+    // A capture of another size is reset
+    ASSERT_TRUE(capture.open(path, 128 * 1024));
+    capture.close();
+    ASSERT_TRUE(readCapture(path).empty());
+    unlink(path.c_str());
+
+    // Any other file is left untouched
+    {
+        std::ofstream other(path);
+        other << "not a capture";
+    }
+    ASSERT_FALSE(capture.open(path, 64 * 1024));
+    ASSERT_FALSE(capture.isOpen());
+    std::ifstream other(path);
+    std::stringstream content;
+    content << other.rdbuf();
+    ASSERT_EQ(content.str(), "not a capture");
+    unlink(path.c_str());
+}
+
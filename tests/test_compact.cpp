@@ -0,0 +1,52 @@
+#include <gtest/gtest.h>
+#include <plugin_api.h>
+#include <string.h>
+#include <string>
+
+// Tested files
+#include "pivot2opcua_common.h"
+#include "pivot2opcua_filter.h"
+#include "pivot2opcua_compact.h"
+
+// Fledge / tools  includes
+#include "config_category.h"
+#include "main_test_configs.h"
+
+using namespace std;
+
+/** Test pivot2opcua_compact APIs */
+
+/* Codes are stable: consumers of layout 1 rely on them */
+TEST(Pivot2Opcua_Compact, Codes) {
+    TITLE("*** TEST COMPACT Codes");
+    ASSERT_EQ(CompactLayout::Version, 1);
+    ASSERT_EQ(CompactLayout::encode(CompactLayout::Field::ComingFrom, "iec104"), 0);
+    ASSERT_EQ(CompactLayout::encode(CompactLayout::Field::ComingFrom, "opcua"), 2);
+    ASSERT_EQ(CompactLayout::encode(CompactLayout::Field::OpcType, "opcua_sps"), 0);
+    ASSERT_EQ(CompactLayout::encode(CompactLayout::Field::OpcType, "opcua_bsc"), 8);
+    ASSERT_EQ(CompactLayout::encode(CompactLayout::Field::Validity, "good"), 0);
+    ASSERT_EQ(CompactLayout::encode(CompactLayout::Field::Validity, "questionable"), 3);
+    ASSERT_EQ(CompactLayout::encode(CompactLayout::Field::Source, "substituted"), 1);
+    ASSERT_EQ(CompactLayout::encode(CompactLayout::Field::TmOrg, "genuine"), 0);
+
+    // Values without a code
+    ASSERT_EQ(CompactLayout::encode(CompactLayout::Field::ComingFrom, "modbus"), -1);
+    ASSERT_EQ(CompactLayout::encode(CompactLayout::Field::Validity, ""), -1);
+}
+
+/* Decoding reverses encoding, unknown codes are rejected */
+TEST(Pivot2Opcua_Compact, Decode) {
+    TITLE("*** TEST COMPACT Decode");
+    const CompactLayout::Field fields[] = {CompactLayout::Field::ComingFrom, CompactLayout::Field::OpcType,
+            CompactLayout::Field::Validity, CompactLayout::Field::Source, CompactLayout::Field::TmOrg};
+    for (const CompactLayout::Field field : fields) {
+        int64_t code(0);
+        for (; CompactLayout::decode(field, code) != nullptr ; code++) {
+            ASSERT_EQ(CompactLayout::encode(field, CompactLayout::decode(field, code)), code);
+        }
+        ASSERT_GT(code, 1);
+        ASSERT_EQ(CompactLayout::decode(field, -1), nullptr);
+    }
+    ASSERT_STREQ(CompactLayout::decode(CompactLayout::Field::OpcType, 3), "opcua_mvf");
+    ASSERT_EQ(CompactLayout::decode(CompactLayout::Field::OpcType, 9), nullptr);
+}
@@ -2,6 +2,7 @@
 #include <plugin_api.h>
 #include <string.h>
 #include <exception>
+#include <memory>
 #include <string>
 #include <rapidjson/document.h>
 
@@ -20,45 +21,41 @@ using namespace rapidjson;
 
 /** Test pivot2opcua_data APIs */
 
-/* ExchangedDataC */
-TEST(Pivot2Opcua_Data, ExchangedDataC) {
-    TITLE("*** TEST DATA ExchangedDataC");
-    rapidjson::Document doc;
-
-    static const string JsonTests = QUOTE({
-        "testNotObj" : "a string",
-        "testIec" : {"name":"iec104","address":"18325-6441925", "typeid":"C_DC_TA_1"},
-        "testNoName" : {"address":"1234", "typeid":"nothing realistic"},
-        "testBadName" : {"name":true,"address":"1234", "typeid":"nothing realistic"},
-        "testNoAddr" : {"name":"opcua","typeid":"opcua_dps"},
-        "testBadAddr1" : {"name":"opcua","address":14, "typeid":"opcua_dps"},
-        "testNoType" : {"name":"opcua","address":"1234"},
-        "testBadType1" : {"name":"opcua","address":"1234", "typeid":1.4},
-        "testPreCheckOk" : {"name":"opcua","address":"1234", "typeid":"nothing realistic"}});
-
-    doc.Parse(JsonTests.c_str());
-    ASSERT_TRUE(!doc.HasParseError());
-    Value& testV(doc["testIec"]);
-
-    ASSERT_THROW(ExchangedDataC x1(doc["testIec"]), ExchangedDataC::NotAnS2opcInstance);
-    ASSERT_THROW(ExchangedDataC x2(doc["testNotObj"]), std::exception);
-    ASSERT_THROW(ExchangedDataC x2(doc["testNoName"]), std::exception);
-    ASSERT_THROW(ExchangedDataC x3(doc["testBadName"]), std::exception);
-    ASSERT_THROW(ExchangedDataC x2(doc["testNoAddr"]), std::exception);
-    ASSERT_THROW(ExchangedDataC x3(doc["testBadAddr1"]), std::exception);
-    ASSERT_THROW(ExchangedDataC x3(doc["testNoType"]), std::exception);
-    ASSERT_THROW(ExchangedDataC x3(doc["testBadType1"]), std::exception);
-    ASSERT_NO_THROW(ExchangedDataC exDa(doc["testPreCheckOk"]));
-
-    // ASSERT_EQ(1, 2);
+/* Checks of the "protocols" of a datapoint */
+TEST(Pivot2Opcua_Data, DataDictionnaryProtocols) {
+    TITLE("*** TEST DATA DataDictionnaryProtocols");
+    const auto dictionnary = [](const string& protocol) -> DataDictionnary* {
+        return new DataDictionnary(string(QUOTE({"exchanged_data" : {"name" : "data1", "version" : "1.0",
+                "datapoints" : [{"label" : "l", "pivot_id" : "id1", "pivot_type" : "GTIS", "protocols" : [)) +
+                protocol + "]}]}}");
+    };
+
+    // Other protocols are ignored
+    std::unique_ptr<DataDictionnary> iec(dictionnary(
+            QUOTE({"name":"iec104","address":"18325-6441925", "typeid":"C_DC_TA_1"})));
+    ASSERT_EQ(iec->size(), 0);
+    ASSERT_THROW(delete dictionnary(QUOTE("a string")), std::exception);
+    ASSERT_THROW(delete dictionnary(QUOTE({"address":"1234", "typeid":"nothing realistic"})), std::exception);
+    ASSERT_THROW(delete dictionnary(QUOTE({"name":true,"address":"1234", "typeid":"nothing realistic"})),
+            std::exception);
+    ASSERT_THROW(delete dictionnary(QUOTE({"name":"opcua","typeid":"opcua_dps"})), std::exception);
+    ASSERT_THROW(delete dictionnary(QUOTE({"name":"opcua","address":14, "typeid":"opcua_dps"})), std::exception);
+    ASSERT_THROW(delete dictionnary(QUOTE({"name":"opcua","address":"1234"})), std::exception);
+    ASSERT_THROW(delete dictionnary(QUOTE({"name":"opcua","address":"1234", "typeid":1.4})), std::exception);
+    std::unique_ptr<DataDictionnary> ok(dictionnary(
+            QUOTE({"name":"opcua","address":"1234", "typeid":"nothing realistic"})));
+    ASSERT_EQ(ok->size(), 1);
+    ASSERT_EQ(ok->lookup("id1")->m_address, "1234");
+    ASSERT_EQ(ok->lookup("id1")->m_opcType, "nothing realistic");
 }
 
 /* PivotElement */
 TEST(Pivot2Opcua_Data, PivotElement) {
     TITLE("*** TEST DATA PivotElement");
-    const PivotElement elt1("type", "opcType");
+    const PivotElement elt1("type", "opcType", "address");
     ASSERT_EQ(elt1.m_pivot_type, string("type"));
     ASSERT_EQ(elt1.m_opcType, string("opcType"));
+    ASSERT_EQ(elt1.m_address, string("address"));
 }   // test PivotElement
 
 /* DataDictionnary */
@@ -75,6 +72,7 @@ TEST(Pivot2Opcua_Data, DataDictionnary) {
     const PivotElement& pivot1(it->second);
     ASSERT_EQ(pivot1.m_pivot_type, "type1");
     ASSERT_EQ(pivot1.m_opcType, "opcua_dps");
+    ASSERT_EQ(pivot1.m_address, "addr1");
 
     // Test invalid configs
     string Json_Broken = QUOTE({"k": "v" : "s"});
@@ -107,7 +105,128 @@ TEST(Pivot2Opcua_Data, DataDictionnary) {
     string Json_ExData = QUOTE({"exchanged_data" : ["name" , "data1"]});
     ASSERT_THROW(DataDictionnary dicNOk(Json_ExData), std::exception);
 
-
+    string Json_BadDataPoint = QUOTE({"exchanged_data" : {"version" : "1.0", "datapoints" : ["dp"]}});
+    ASSERT_THROW(DataDictionnary dicNOk(Json_BadDataPoint), std::exception);
+
+    string Json_NoTypeId = replace_in_string(Json_ExDataOK, QUOTE("typeid":"opcua_sps"), QUOTE("typeid":12));
+    ASSERT_THROW(DataDictionnary dicNOk(Json_NoTypeId), std::exception);
+
+    // Members in any order, unknown sections ignored, non-opcua protocols not checked
+    string Json_AnyOrder = QUOTE({"other" : [{"a" : 1}], "exchanged_data" : {
+        "datapoints" : [{"protocols" : [{"typeid" : "opcua_mvf", "name" : "opcua", "address" : "a1"},
+                {"name" : "hnz", "address" : {"x" : [1]}}],
+            "extra" : {"k" : ["v"]}, "pivot_type" : "typeMvf", "label" : "l1", "pivot_id" : "pivotAny"}],
+        "version" : "1.0"}});
+    const DataDictionnary dicAny(Json_AnyOrder);
+    it = dicAny.find("pivotAny");
+    ASSERT_FALSE(dicAny.isEmpty(it));
+    ASSERT_EQ(it->second.m_pivot_type, "typeMvf");
+    ASSERT_EQ(it->second.m_opcType, "opcua_mvf");
+
+    // Several "opcua" protocols: a single element, with all the mappings
+    const DataDictionnary dicMulti(getExDataMultiMapping());
+    ASSERT_EQ(dicMulti.size(), dic1.size());
+    ASSERT_EQ(dicMulti.duplicates(), dic1.duplicates());
+    it = dicMulti.find("pivotMVF");
+    ASSERT_FALSE(dicMulti.isEmpty(it));
+    ASSERT_EQ(it->second.m_opcType, "opcua_mvi");
+    ASSERT_EQ(it->second.m_address, "mvf_raw");
+    ASSERT_EQ(it->second.m_mappings.size(), 2);
+    ASSERT_EQ(it->second.m_mappings[0].m_opcType, "opcua_mvi");
+    ASSERT_EQ(it->second.m_mappings[0].m_address, "mvf_raw");
+    ASSERT_EQ(it->second.m_mappings[1].m_opcType, "opcua_mvf");
+    ASSERT_EQ(it->second.m_mappings[1].m_address, "mvf");
+    ASSERT_TRUE(dicMulti.find("pivotMVI")->second.m_mappings.empty());
 }   // test DataDictionnary
 
+/* DataDictionnary built by several threads */
+TEST(Pivot2Opcua_Data, DataDictionnaryParallel) {
+    TITLE("*** TEST DATA DataDictionnaryParallel");
+    // Large enough to be split (one in 1000 pivot ids is duplicated)
+    string json(QUOTE({"exchanged_data" : {"name" : "data1", "version" : "1.0", "datapoints" : [));
+    for (int i = 0 ; i < 20000 ; i++) {
+        const string id("pivot" + std::to_string(i % 1000 == 999 ? i - 1 : i));
+        if (i > 0) json += ",";
+        json += "{\"label\" : \"l\\\"" + std::to_string(i) + "\", \"pivot_id\" : \"" + id +
+                "\", \"pivot_type\" : \"type" + std::to_string(i) + "\", \"protocols\" : [" +
+                "{\"name\" : \"iec104\", \"address\" : \"1\", \"typeid\" : \"C_DC_TA_1\"}, " +
+                "{\"name\" : \"opcua\", \"address\" : \"a\", \"typeid\" : \"opcua_sps\"}" +
+                (i == 500 ? ", {\"name\" : \"opcua\", \"address\" : \"b\", \"typeid\" : \"opcua_dps\"}" : "") +
+                "]}";
+    }
+    json += "]}}";
+    ASSERT_GT(json.size(), 2 << 20);
+
+    const DataDictionnary dic1(json, 1);
+    const DataDictionnary dic4(json, 4);
+    ASSERT_EQ(dic1.size(), 19980);
+    ASSERT_EQ(dic1.duplicates(), 20);
+    ASSERT_EQ(dic4.size(), dic1.size());
+    ASSERT_EQ(dic4.duplicates(), dic1.duplicates());
+    // First occurrence is kept
+    PivotElementMap_t::const_iterator it(dic4.find("pivot998"));
+    ASSERT_FALSE(dic4.isEmpty(it));
+    ASSERT_EQ(it->second.m_pivot_type, "type998");
+    it = dic4.find("pivot19998");
+    ASSERT_FALSE(dic4.isEmpty(it));
+    ASSERT_EQ(it->second.m_pivot_type, "type19998");
+    it = dic4.find("pivot500");
+    ASSERT_EQ(it->second.m_mappings.size(), 2);
+    ASSERT_EQ(it->second.m_mappings[1].m_address, "b");
+
+    // Errors in datapoints or in other sections are still detected
+    const auto replaceFirst = [&json](const string& old, const string& New) {
+        string result(json);
+        return result.replace(result.find(old), old.size(), New);
+    };
+    ASSERT_THROW(DataDictionnary dicNOk(replaceFirst(QUOTE("pivot_id" : "pivot12345"), QUOTE("pivot_id" : 12345)), 4),
+            std::exception);
+    ASSERT_THROW(DataDictionnary dicNOk(replaceFirst(QUOTE("version" : "1.0"), QUOTE("version" : "2.0")), 4),
+            std::exception);
+    ASSERT_THROW(DataDictionnary dicNOk(json.substr(0, json.size() - 3), 4), std::exception);
+}
+
 
+
+/* DataDictionnary with pivot id patterns */
+TEST(Pivot2Opcua_Data, DataDictionnaryPatterns) {
+    TITLE("*** TEST DATA DataDictionnaryPatterns");
+    string json(QUOTE({"exchanged_data" : {"name" : "data1", "version" : "1.0", "datapoints" : [));
+    const char* const ids[][2] = {{"S1/B1/CB1/Pos", "opcua_sps"}, {"S1/B*/CB*/Pos", "opcua_dps"},
+            {"S1/**", "opcua_mvf"}};
+    bool first(true);
+    for (const auto& id : ids) {
+        if (!first) json += ",";
+        first = false;
+        json += string("{\"label\" : \"l\", \"pivot_id\" : \"") + id[0] +
+                "\", \"pivot_type\" : \"GTIS\", \"protocols\" : [" +
+                "{\"name\" : \"opcua\", \"address\" : \"a\", \"typeid\" : \"" + id[1] + "\"}]}";
+    }
+    json += "]}}";
+
+    const DataDictionnary dic(json);
+    ASSERT_EQ(dic.size(), 3);
+    ASSERT_EQ(dic.patterns(), 2);
+    // Exact entries first
+    ASSERT_EQ(dic.lookup("S1/B1/CB1/Pos")->m_opcType, "opcua_sps");
+    ASSERT_EQ(dic.lookup("S1/B2/CB7/Pos")->m_opcType, "opcua_dps");
+    ASSERT_EQ(dic.lookup("S1/B2/CB7/Other")->m_opcType, "opcua_mvf");
+    ASSERT_EQ(dic.lookup("S2/B2/CB7/Pos"), nullptr);
+    ASSERT_TRUE(dic.mayContain("S1/B1/CB1/Pos"));
+    ASSERT_TRUE(dic.mayContain("S1/B2/CB7/Pos"));
+    ASSERT_FALSE(dic.mayContain("S2/B2/CB7/Pos"));
+    // Patterns are not exact entries
+    ASSERT_TRUE(dic.isEmpty(dic.find("S1/B2/CB7/Pos")));
+    ASSERT_TRUE(dic.find("S1/B*/CB*/Pos")->second.m_isPattern);
+    ASSERT_FALSE(dic.find("S1/B1/CB1/Pos")->second.m_isPattern);
+    // ... and are not signals
+    ASSERT_EQ(dic.lookup("S1/B*/CB*/Pos"), nullptr);
+    ASSERT_EQ(dic.lookup("S1/**"), nullptr);
+    ASSERT_EQ(dic.lookup("S1/B*/CB7/Pos"), nullptr);
+
+    // Patterns are rebuilt from an already built map (snapshot)
+    PivotElementMap_t map(dic.begin(), dic.end());
+    const DataDictionnary copy(std::move(map), 0);
+    ASSERT_EQ(copy.patterns(), 2);
+    ASSERT_EQ(copy.lookup("S1/B2/CB7/Pos")->m_opcType, "opcua_dps");
+}
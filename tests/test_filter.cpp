@@ -1,17 +1,29 @@
 #include <gtest/gtest.h>
 #include <plugin_api.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <exception>
+#include <fstream>
+#include <sstream>
 #include <vector>
 #include <algorithm>
+#include <chrono>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <rapidjson/document.h>
 
 // Tested files
 #include "pivot2opcua_common.h"
 #include "pivot2opcua_filter.h"
+#include "pivot2opcua_compact.h"
+#include "pivot2opcua_packed.h"
 #include "pivot2opcua_data.h"
 #include "pivot2opcua_rules.h"
+#include "pivot2opcua_snapshot.h"
+#include "pivot2opcua_cache.h"
+#include "pivot2opcua_handles.h"
 
 // Fledge / tools  includes
 #include "config_category.h"
@@ -45,6 +57,33 @@ void f_output_stream(OUTPUT_HANDLE * out, READINGSET *set) {
     called_output_handle = out;
     called_output_reading = set;
 }
+std::vector<READINGSET*> chunk_outputs;
+void f_chunk_output_stream(OUTPUT_HANDLE *, READINGSET *set) {
+    chunk_outputs.push_back(set);
+}
+
+/** Outputs of filters passing on sets from several threads */
+std::mutex lane_mutex;
+std::vector<READINGSET*> lane_outputs;
+void f_lane_output_stream(OUTPUT_HANDLE *, READINGSET *set) {
+    std::lock_guard<std::mutex> guard(lane_mutex);
+    lane_outputs.push_back(set);
+}
+
+/** @return The "PIVOT" datapoint of a json test object */
+Datapoint* pivotDatapoint(const char* json) {
+    Document doc;
+    doc.Parse(json);
+    return DocToDataPoint("PIVOT", doc["PIVOT"]);
+}
+
+/** @return The "do_id" of a converted reading */
+string convertedId(Reading* reading) {
+    DatapointValue* dataObject(get_datapoint_by_key(&reading->getReadingData(), "data_object"));
+    if (dataObject == nullptr) return "";
+    DatapointValue* id(get_datapoint_by_key(dataObject->getDpVec(), "do_id"));
+    return id == nullptr ? "" : id->toStringValue();
+}
 }
 
 // Test with Disabled filter
@@ -1346,6 +1385,849 @@ TEST(Pivot2Opcua_Filter, Pivot2OpcuaFilterReply) {
     }
 }
 
+// Test source latency measurement
+TEST(Pivot2Opcua_Filter, Pivot2OpcuaFilterLatency) {
+    TITLE("*** TEST FILTER Pivot2OpcuaFilterLatency");
+
+    ConfigCategory config(::getEnabledConfig(Json_ExDataOK));
+    config.addItem(string("latency_stamp"), string("latency_stamp"), string("boolean"), "true", "true");
+    Pivot2OpcuaFilter filter("A great filter", config, stubOutH, &f_output_stream);
+
+    {
+        INGEST(rSet, JsonPivotMvf, "Latency");
+        DATA_PASSES;
+        DatapointValue* lat_dv = getFieldResult(rSet, "do_filter_latency_us");
+        ASSERT_NE(lat_dv, nullptr);
+        ASSERT_EQ(lat_dv->getType(), DatapointValue::T_INTEGER);
+        // Source timestamp is 12345678s since Epoch
+        ASSERT_GT(lat_dv->toInt(), 0);
+    }
+    {
+        INGEST(rSet, JsonPivotMvi, "Latency2");
+        DATA_PASSES;
+    }
+
+    Document doc;
+    doc.Parse(filter.getStatistics().c_str());
+    ASSERT_FALSE(doc.HasParseError());
+    ASSERT_TRUE(doc["source_latency"].HasMember("iec104"));
+    ASSERT_EQ(doc["source_latency"]["iec104"]["count"].GetInt(), 1);
+    ASSERT_TRUE(doc["source_latency"].HasMember("opcua"));
+    ASSERT_EQ(doc["source_latency"]["opcua"]["count"].GetInt(), 1);
+
+    // Disabled by default
+    Pivot2OpcuaFilter filter2(FILTER_PARAMS);
+    {
+        Pivot2OpcuaFilter& filter(filter2);
+        INGEST(rSet, JsonPivotMvf, "NoLatency");
+        DATA_PASSES;
+        ASSERT_EQ(getFieldResult(rSet, "do_filter_latency_us"), nullptr);
+    }
+}
+
+// Test recording of input readings
+TEST(Pivot2Opcua_Filter, Pivot2OpcuaFilterCapture) {
+    TITLE("*** TEST FILTER Pivot2OpcuaFilterCapture");
+    const string path(string("/tmp/p2o_filter_") + std::to_string(getpid()) + ".cap");
+    unlink(path.c_str());
+
+    ConfigCategory config(::getEnabledConfig(Json_ExDataOK));
+    config.addItem(string("capture_file"), string("capture_file"), string("string"), "", path);
+    config.addItem(string("capture_size"), string("capture_size"), string("integer"), "1", "1");
+    {
+        Pivot2OpcuaFilter filter("A great filter", config, stubOutH, &f_output_stream);
+        ReadingSet rSet;
+        appendJsonToReadingSet(rSet, JsonPivotMvf, "Captured");
+        filter.ingest(&rSet);
+        ASSERT_NE(getDoResult(rSet), nullptr);
+    }
+
+    int nbBatches(0);
+    ASSERT_TRUE(ReadingCapture::readFile(path,
+            [&nbBatches](const ReadingCapture::CaptureIndexEntry& entry, const uint8_t* data) {
+        nbBatches++;
+        vector<Reading*> readings(ReadingCapture::decodeBatch(data, entry.length, entry.nbReadings));
+        ASSERT_EQ(readings.size(), 1);
+        ASSERT_EQ(readings[0]->getAssetName(), "Captured");
+        ASSERT_NE(readings[0]->getDatapoint("PIVOT"), nullptr);
+        delete readings[0];
+    }));
+    ASSERT_EQ(nbBatches, 1);
+    unlink(path.c_str());
+}
+
+// Test command round-trip measurement
+TEST(Pivot2Opcua_Filter, Pivot2OpcuaFilterCommandRoundTrip) {
+    TITLE("*** TEST FILTER Pivot2OpcuaFilterCommandRoundTrip");
+
+    Pivot2OpcuaFilter filter(FILTER_PARAMS);
+    for (const char* json : {JsonPivotReplyInc, JsonPivotReplyDpc}) {
+        Readings readings(JsonToReadingMulti(json, "opcua_operation"));
+        ReadingSet rSet(&readings);
+        f_reset_outputs();
+        filter.ingest(&rSet);
+        ASSERT_EQ(called_output_reading, &rSet);
+        ASSERT_NE(getPivotResult(rSet), nullptr);
+    }
+    {
+        // ACK for "pivotINC"
+        INGEST(rSet, replace_in_string(JsonPivotReply2, "__REPLY__", "false"), "Reply");
+        ASSERT_NE(getRoResult(rSet), nullptr);
+    }
+    {
+        // No more pending command for "pivotINC"
+        INGEST(rSet, replace_in_string(JsonPivotReply2, "__REPLY__", "true"), "Reply2");
+        ASSERT_NE(getRoResult(rSet), nullptr);
+    }
+
+    Document doc;
+    doc.Parse(filter.getStatistics().c_str());
+    ASSERT_FALSE(doc.HasParseError());
+    ASSERT_TRUE(doc.HasMember("command_round_trip"));
+    const Value& cmd(doc["command_round_trip"]);
+    ASSERT_EQ(cmd["commands"].GetInt(), 2);
+    ASSERT_EQ(cmd["pending"].GetInt(), 1);
+    ASSERT_EQ(cmd["acks"].GetInt(), 1);
+    ASSERT_EQ(cmd["nacks"].GetInt(), 1);
+    ASSERT_EQ(cmd["unmatched_replies"].GetInt(), 1);
+    ASSERT_EQ(cmd["timeouts"].GetInt(), 0);
+    ASSERT_EQ(cmd["ack_latency"]["count"].GetInt(), 1);
+    ASSERT_EQ(cmd["nack_latency"]["count"].GetInt(), 0);
+}
+
+// Test warm startup from the exchanged_data snapshot
+TEST(Pivot2Opcua_Filter, Pivot2OpcuaFilterSnapshot) {
+    TITLE("*** TEST FILTER Pivot2OpcuaFilterSnapshot");
+    const string dataDir(string("/tmp/p2o_data_") + std::to_string(getpid()));
+    const char* previous(getenv("FLEDGE_DATA"));
+    const string previousDataDir(previous == nullptr ? "" : previous);
+    mkdir(dataDir.c_str(), 0755);
+    setenv("FLEDGE_DATA", dataDir.c_str(), 1);
+
+    const string path(DictionarySnapshot::defaultPath("Snapshot filter"));
+    ASSERT_EQ(path.find(dataDir), 0);
+    unlink(path.c_str());
+    // Configuration not used by other instances (no shared dictionnary)
+    ConfigCategory config(::getEnabledConfig(replace_in_string(Json_ExDataOK, "label1", "labelSnapshot")));
+    for (int i = 0 ; i < 2 ; i++) {
+        // First filter saves the snapshot, second one loads it
+        Pivot2OpcuaFilter filter("Snapshot filter", config, stubOutH, &f_output_stream);
+        ASSERT_EQ(access(path.c_str(), R_OK), 0);
+        ReadingSet rSet;
+        appendJsonToReadingSet(rSet, JsonPivotMvf, "Snapshot");
+        filter.ingest(&rSet);
+        ASSERT_NE(getDoResult(rSet), nullptr);
+    }
+
+    unlink(path.c_str());
+    rmdir((dataDir + "/pivottoopcua").c_str());
+    rmdir(dataDir.c_str());
+    if (previous == nullptr) {
+        unsetenv("FLEDGE_DATA");
+    } else {
+        setenv("FLEDGE_DATA", previousDataDir.c_str(), 1);
+    }
+}
+
+// Test sharing of the dictionnary between instances
+TEST(Pivot2Opcua_Filter, Pivot2OpcuaFilterSharedDictionnary) {
+    TITLE("*** TEST FILTER Pivot2OpcuaFilterSharedDictionnary");
+    const size_t initialSize(DictionaryCache::size());
+    ConfigCategory config(::getEnabledConfig(replace_in_string(Json_ExDataOK, "label1", "labelShared")));
+    {
+        Pivot2OpcuaFilter filter1("Shared filter 1", config, stubOutH, &f_output_stream);
+        Pivot2OpcuaFilter filter2("Shared filter 2", config, stubOutH, &f_output_stream);
+        ASSERT_EQ(DictionaryCache::size(), initialSize + 1);
+        for (Pivot2OpcuaFilter* filter : {&filter1, &filter2}) {
+            ReadingSet rSet;
+            appendJsonToReadingSet(rSet, JsonPivotMvf, "Shared");
+            filter->ingest(&rSet);
+            ASSERT_NE(getDoResult(rSet), nullptr);
+        }
+    }
+    ASSERT_EQ(DictionaryCache::size(), initialSize);
+}
+
+// Test rebuild of the dictionnary in background on reconfiguration
+TEST(Pivot2Opcua_Filter, Pivot2OpcuaFilterBackgroundReconfigure) {
+    TITLE("*** TEST FILTER Pivot2OpcuaFilterBackgroundReconfigure");
+    ConfigCategory config(::getEnabledConfig(replace_in_string(Json_ExDataOK, "label1", "labelBackground")));
+    Pivot2OpcuaFilter filter("Background filter", config, stubOutH, &f_output_stream);
+    const string confHeader(QUOTE({"enable" : {"description" : "", "type" : "boolean", "value" : "true"},
+            "exchanged_data" : {"description" : "", "type" : "JSON", "value" :));
+    {
+        ReadingSet rSet;
+        appendJsonToReadingSet(rSet, JsonPivotMvi, "Background");
+        filter.ingest(&rSet);
+        ASSERT_NE(getDoResult(rSet), nullptr);
+    }
+
+    // "pivotMVF" is renamed
+    filter.reconfigure(confHeader + replace_in_string(Json_ExDataOK, "pivotMVF", "pivotMVF2") + "}}");
+    filter.waitConfigured();
+    {
+        ReadingSet rSet;
+        appendJsonToReadingSet(rSet, JsonPivotMvf, "Background");
+        filter.ingest(&rSet);
+        ASSERT_EQ(getDoResult(rSet), nullptr);
+    }
+
+    // Other settings only: the dictionnary is not rebuilt
+    filter.reconfigure(confHeader + replace_in_string(Json_ExDataOK, "pivotMVF", "pivotMVF2") +
+            QUOTE(}, "stats_period" : {"description" : "", "type" : "integer", "value" : "60"}}));
+    filter.waitConfigured();
+
+    // Invalid configuration: the previous dictionnary is kept
+    filter.reconfigure(confHeader + "{}}}");
+    filter.waitConfigured();
+    {
+        ReadingSet rSet;
+        appendJsonToReadingSet(rSet, replace_in_string(JsonPivotMvf, "pivotMVF", "pivotMVF2"), "Background");
+        filter.ingest(&rSet);
+        ASSERT_NE(getDoResult(rSet), nullptr);
+    }
+
+    Document doc;
+    doc.Parse(filter.getStatistics().c_str());
+    ASSERT_FALSE(doc.HasParseError());
+    const Value& dictionary(doc["dictionary"]);
+    ASSERT_EQ(dictionary["generation"].GetInt(), 2);
+    ASSERT_GT(dictionary["entries"].GetInt(), 0);
+    ASSERT_EQ(dictionary["failed_builds"].GetInt(), 1);
+    // "pivotMVI" used before the rebuild, "pivotMVF2" after
+    ASSERT_EQ(doc["dictionary_usage"]["used"].GetInt(), 2);
+}
+
+// Test early rejection of unknown pivot ids
+TEST(Pivot2Opcua_Filter, Pivot2OpcuaFilterUnknownId) {
+    TITLE("*** TEST FILTER Pivot2OpcuaFilterUnknownId");
+    Pivot2OpcuaFilter filter(FILTER_PARAMS);
+    for (int i = 0 ; i < 2 ; i++) {
+        ReadingSet rSet;
+        appendJsonToReadingSet(rSet, replace_in_string(JsonPivotMvf, "pivotMVF", "pivotUnknown"), "Unknown");
+        filter.ingest(&rSet);
+        ASSERT_EQ(getDoResult(rSet), nullptr);
+    }
+    {
+        ReadingSet rSet;
+        appendJsonToReadingSet(rSet, JsonPivotMvf, "Known");
+        filter.ingest(&rSet);
+        ASSERT_NE(getDoResult(rSet), nullptr);
+    }
+
+    Document doc;
+    doc.Parse(filter.getStatistics().c_str());
+    ASSERT_FALSE(doc.HasParseError());
+    const Value& unknown(doc["unknown_ids"]);
+    ASSERT_EQ(unknown["rejected"].GetInt(), 2);
+    ASSERT_EQ(unknown["recent"].MemberCount(), 1);
+    ASSERT_EQ(unknown["recent"]["pivotUnknown"].GetInt(), 2);
+    ASSERT_EQ(unknown["distinct_estimate"].GetInt(), 1);
+    ASSERT_STREQ(unknown["top"][0]["id"].GetString(), "pivotUnknown");
+
+    // Only the converted pivot id is used
+    const Value& usage(doc["dictionary_usage"]);
+    ASSERT_TRUE(usage.IsObject());
+    ASSERT_EQ(usage["used"].GetInt(), 1);
+    ASSERT_EQ(usage["unused"].GetInt(), usage["entries"].GetInt() - 1);
+    for (const Value& id : usage["unused_ids"].GetArray()) {
+        ASSERT_STRNE(id.GetString(), "pivotMVF");
+    }
+    const Value& hitters(doc["heavy_hitters"]);
+    ASSERT_EQ(hitters["total"].GetInt(), 1);
+    ASSERT_STREQ(hitters["top"][0]["id"].GetString(), "pivotMVF");
+}
+
+// Test that only the value sub-section matching the OPC UA type is decoded
+TEST(Pivot2Opcua_Filter, Pivot2OpcuaFilterLazyDecoding) {
+    TITLE("*** TEST FILTER Pivot2OpcuaFilterLazyDecoding");
+    Pivot2OpcuaFilter filter(FILTER_PARAMS);
+    // "pivotSPS" is an "opcua_sps": "MvTyp" (last) is ignored
+    const string json(QUOTE({"PIVOT" : {"GTIS" : {
+            "Cause" : {"stVal" : 4},
+            "ComingFrom" : "opcua",
+            "SpsTyp" : {JSON_DEF_Q_QUALITY, JSON_DEF_T_QUALITY(12345678), "stVal" : true},
+            "Identifier" : "pivotSPS",
+            "MvTyp" : {JSON_DEF_Q_QUALITY, JSON_DEF_T_QUALITY(12345678), "mag" : {"f" : 3.14}}}}}));
+    ReadingSet rSet;
+    appendJsonToReadingSet(rSet, json, "Lazy");
+    filter.ingest(&rSet);
+    ASSERT_NE(getDoResult(rSet), nullptr);
+    DatapointValue* value(getFieldResult(rSet, "do_value"));
+    ASSERT_NE(value, nullptr);
+    ASSERT_EQ(value->getType(), DatapointValue::T_INTEGER);
+    ASSERT_EQ(value->toInt(), 1);
+}
+
+// Test forwarding of large sets by chunks
+TEST(Pivot2Opcua_Filter, Pivot2OpcuaFilterChunks) {
+    TITLE("*** TEST FILTER Pivot2OpcuaFilterChunks");
+    ConfigCategory config(::getEnabledConfig(Json_ExDataOK));
+    config.addItem(string("chunk_size"), string("chunk_size"), string("integer"), "4", "4");
+    Pivot2OpcuaFilter filter("Chunk filter", config, stubOutH, &f_chunk_output_stream);
+
+    ReadingSet rSet;
+    for (int i = 0 ; i < 10 ; i++) {
+        appendJsonToReadingSet(rSet, JsonPivotMvf, "Chunk" + std::to_string(i));
+    }
+    chunk_outputs.clear();
+    filter.ingest(&rSet);
+    // Chunks are passed on in order, the last one in the input set
+    ASSERT_EQ(chunk_outputs.size(), 3);
+    ASSERT_EQ(chunk_outputs.back(), &rSet);
+    int index(0);
+    for (READINGSET* chunk : chunk_outputs) {
+        ASSERT_EQ(chunk->getAllReadings().size(), index < 8 ? 4 : 2);
+        for (Reading* reading : *chunk->getAllReadingsPtr()) {
+            ASSERT_EQ(reading->getAssetName(), "Chunk" + std::to_string(index));
+            ASSERT_NE(get_datapoint_by_key(&reading->getReadingData(), "data_object"), nullptr);
+            index++;
+        }
+    }
+    ASSERT_EQ(index, 10);
+    delete chunk_outputs[0];
+    delete chunk_outputs[1];
+
+    // Small sets are passed on at once
+    ReadingSet rSet2;
+    appendJsonToReadingSet(rSet2, JsonPivotMvf, "NoChunk");
+    chunk_outputs.clear();
+    filter.ingest(&rSet2);
+    ASSERT_EQ(chunk_outputs.size(), 1);
+    ASSERT_EQ(chunk_outputs[0], &rSet2);
+    ASSERT_NE(getDoResult(rSet2), nullptr);
+}
+
+// Test aggregation of small sets
+TEST(Pivot2Opcua_Filter, Pivot2OpcuaFilterBatches) {
+    TITLE("*** TEST FILTER Pivot2OpcuaFilterBatches");
+    ConfigCategory config(::getEnabledConfig(Json_ExDataOK));
+    config.addItem(string("batch_size"), string("batch_size"), string("integer"), "3", "3");
+    config.addItem(string("batch_delay_us"), string("batch_delay_us"), string("integer"), "60000000", "60000000");
+    chunk_outputs.clear();
+    {
+        Pivot2OpcuaFilter filter("Batch filter", config, stubOutH, &f_chunk_output_stream);
+        for (int i = 0 ; i < 4 ; i++) {
+            ReadingSet* rSet(new ReadingSet);
+            appendJsonToReadingSet(*rSet, JsonPivotMvf, "Batch" + std::to_string(i));
+            filter.ingest(rSet);
+            ASSERT_EQ(chunk_outputs.size(), i < 2 ? 0 : 1);
+        }
+        ASSERT_EQ(chunk_outputs[0]->getAllReadings().size(), 3);
+        int index(0);
+        for (Reading* reading : *chunk_outputs[0]->getAllReadingsPtr()) {
+            ASSERT_EQ(reading->getAssetName(), "Batch" + std::to_string(index++));
+            ASSERT_NE(get_datapoint_by_key(&reading->getReadingData(), "data_object"), nullptr);
+        }
+
+        Document doc;
+        doc.Parse(filter.getStatistics().c_str());
+        ASSERT_FALSE(doc.HasParseError());
+        ASSERT_EQ(doc["output"]["sets"].GetInt(), 1);
+        ASSERT_EQ(doc["output"]["readings"].GetInt(), 3);
+    }
+    // The last reading is passed on at shutdown
+    ASSERT_EQ(chunk_outputs.size(), 2);
+    ASSERT_EQ(chunk_outputs[1]->getAllReadings().size(), 1);
+    for (READINGSET* output : chunk_outputs) {
+        delete output;
+    }
+}
+
+// Test conversion on a dedicated thread
+TEST(Pivot2Opcua_Filter, Pivot2OpcuaFilterAsync) {
+    TITLE("*** TEST FILTER Pivot2OpcuaFilterAsync");
+    ConfigCategory config(::getEnabledConfig(Json_ExDataOK));
+    config.addItem(string("async_queue"), string("async_queue"), string("integer"), "16", "16");
+    chunk_outputs.clear();
+    {
+        Pivot2OpcuaFilter filter("Async filter", config, stubOutH, &f_chunk_output_stream);
+        for (int i = 0 ; i < 5 ; i++) {
+            ReadingSet* rSet(new ReadingSet);
+            appendJsonToReadingSet(*rSet, JsonPivotMvf, "Async" + std::to_string(i));
+            filter.ingest(rSet);
+        }
+    }
+    // Queued sets are converted before the filter stops
+    ASSERT_EQ(chunk_outputs.size(), 5);
+    for (size_t i = 0 ; i < chunk_outputs.size() ; i++) {
+        Reading* reading(chunk_outputs[i]->getAllReadingsPtr()->front());
+        ASSERT_EQ(reading->getAssetName(), "Async" + std::to_string(i));
+        ASSERT_NE(get_datapoint_by_key(&reading->getReadingData(), "data_object"), nullptr);
+        delete chunk_outputs[i];
+    }
+}
+
+// Test priority lane for commands and command replies
+TEST(Pivot2Opcua_Filter, Pivot2OpcuaFilterPriorityLane) {
+    TITLE("*** TEST FILTER Pivot2OpcuaFilterPriorityLane");
+    ConfigCategory config(::getEnabledConfig(Json_ExDataOK));
+    config.addItem(string("batch_size"), string("batch_size"), string("integer"), "100", "100");
+    config.addItem(string("batch_delay_us"), string("batch_delay_us"), string("integer"), "60000000", "60000000");
+    chunk_outputs.clear();
+    {
+        Pivot2OpcuaFilter filter("Lane filter", config, stubOutH, &f_chunk_output_stream);
+        ReadingSet* rSet(new ReadingSet);
+        appendJsonToReadingSet(*rSet, JsonPivotMvf, "Measure0");
+        Readings replies(JsonToReadingMulti(JsonPivotReplyDpc, "opcua_operation"));
+        rSet->append(replies);
+        appendJsonToReadingSet(*rSet, JsonPivotMvf, "Measure1");
+        filter.ingest(rSet);
+        // The reply is passed on at once, in its own set, while measurements are batched
+        ASSERT_EQ(chunk_outputs.size(), 1);
+        ASSERT_NE(chunk_outputs[0], rSet);
+        ASSERT_EQ(chunk_outputs[0]->getAllReadings().size(), 1);
+        Reading* reply(chunk_outputs[0]->getAllReadingsPtr()->front());
+        ASSERT_EQ(reply->getAssetName(), "PivotCommand");
+        ASSERT_NE(get_datapoint_by_key(&reply->getReadingData(), "PIVOTTC"), nullptr);
+
+        // Sets made of commands only are passed on as is
+        Readings replies2(JsonToReadingMulti(JsonPivotReplyDpc, "opcua_operation"));
+        ReadingSet* rSet2(new ReadingSet(&replies2));
+        filter.ingest(rSet2);
+        ASSERT_EQ(chunk_outputs.size(), 2);
+        ASSERT_EQ(chunk_outputs[1], rSet2);
+
+        Document doc;
+        doc.Parse(filter.getStatistics().c_str());
+        ASSERT_FALSE(doc.HasParseError());
+        ASSERT_EQ(doc["lane_latency"]["command"]["count"].GetInt(), 2);
+        ASSERT_EQ(doc["lane_latency"]["measurement"]["count"].GetInt(), 1);
+    }
+    // Measurements follow, in their original order
+    ASSERT_EQ(chunk_outputs.size(), 3);
+    ASSERT_EQ(chunk_outputs[2]->getAllReadings().size(), 2);
+    ASSERT_EQ(chunk_outputs[2]->getAllReadingsPtr()->at(0)->getAssetName(), "Measure0");
+    ASSERT_EQ(chunk_outputs[2]->getAllReadingsPtr()->at(1)->getAssetName(), "Measure1");
+    for (READINGSET* output : chunk_outputs) {
+        delete output;
+    }
+}
+
+// Test the priority lane in asynchronous mode: routed commands, input captured as received
+TEST(Pivot2Opcua_Filter, Pivot2OpcuaFilterAsyncLaneCapture) {
+    TITLE("*** TEST FILTER Pivot2OpcuaFilterAsyncLaneCapture");
+    const string path(string("/tmp/p2o_lane_") + std::to_string(getpid()) + ".cap");
+    unlink(path.c_str());
+    ConfigCategory config(::getEnabledConfig(Json_ExDataOK));
+    const string routing(QUOTE({"command_in" : "opcua2pivot"}));
+    config.addItem(string("asset_routing"), string("asset_routing"), string("JSON"), routing, routing);
+    config.addItem(string("async_queue"), string("async_queue"), string("integer"), "16", "16");
+    config.addItem(string("capture_file"), string("capture_file"), string("string"), "", path);
+    config.addItem(string("capture_size"), string("capture_size"), string("integer"), "1", "1");
+    chunk_outputs.clear();
+    {
+        Pivot2OpcuaFilter filter("Async lane filter", config, stubOutH, &f_chunk_output_stream);
+        ReadingSet* rSet(new ReadingSet);
+        appendJsonToReadingSet(*rSet, JsonPivotMvf, "Measure0");
+        Readings replies(JsonToReadingMulti(JsonPivotReplyDpc, "command_in"));
+        rSet->append(replies);
+        appendJsonToReadingSet(*rSet, JsonPivotMvf, "Measure1");
+        filter.ingest(rSet);
+        // The command is converted by the caller thread
+        Document doc;
+        doc.Parse(filter.getStatistics().c_str());
+        ASSERT_FALSE(doc.HasParseError());
+        ASSERT_EQ(doc["lane_latency"]["command"]["count"].GetInt(), 1);
+    }
+    ASSERT_EQ(chunk_outputs.size(), 2);
+    ASSERT_EQ(chunk_outputs[0]->getAllReadingsPtr()->front()->getAssetName(), "PivotCommand");
+    ASSERT_EQ(chunk_outputs[1]->getAllReadings().size(), 2);
+    for (READINGSET* output : chunk_outputs) {
+        delete output;
+    }
+
+    // A single batch, in the original order
+    vector<string> captured;
+    ASSERT_TRUE(ReadingCapture::readFile(path,
+            [&captured](const ReadingCapture::CaptureIndexEntry& entry, const uint8_t* data) {
+        for (Reading* reading : ReadingCapture::decodeBatch(data, entry.length, entry.nbReadings)) {
+            captured.push_back(reading->getAssetName());
+            delete reading;
+        }
+        captured.push_back("|");
+    }));
+    ASSERT_EQ(captured, vector<string>({"Measure0", "command_in", "Measure1", "|"}));
+    unlink(path.c_str());
+}
+
+// Test the priority lane in asynchronous mode: commands do not wait while a large set is converted
+TEST(Pivot2Opcua_Filter, Pivot2OpcuaFilterAsyncLaneBusy) {
+    TITLE("*** TEST FILTER Pivot2OpcuaFilterAsyncLaneBusy");
+    const size_t nbMeasurements(5000);
+    ConfigCategory config(::getEnabledConfig(Json_ExDataOK));
+    const string routing(QUOTE({"command_in" : "opcua2pivot"}));
+    config.addItem(string("asset_routing"), string("asset_routing"), string("JSON"), routing, routing);
+    config.addItem(string("async_queue"), string("async_queue"), string("integer"), "4", "4");
+    lane_outputs.clear();
+    {
+        Pivot2OpcuaFilter filter("Busy lane filter", config, stubOutH, &f_lane_output_stream);
+        ReadingSet* measurements(new ReadingSet);
+        for (size_t i = 0 ; i < nbMeasurements ; i++) {
+            appendJsonToReadingSet(*measurements, JsonPivotMvf, "Measure");
+        }
+        filter.ingest(measurements);
+        // Let the conversion thread start on the large set
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+        ReadingSet* commands(new ReadingSet);
+        Readings replies(JsonToReadingMulti(JsonPivotReplyDpc, "command_in"));
+        commands->append(replies);
+        filter.ingest(commands);
+        // The command was converted and passed on by this thread, the large set is still being converted
+        std::lock_guard<std::mutex> guard(lane_mutex);
+        ASSERT_EQ(lane_outputs.size(), 1);
+        ASSERT_EQ(lane_outputs[0]->getAllReadingsPtr()->front()->getAssetName(), "PivotCommand");
+    }
+    ASSERT_EQ(lane_outputs.size(), 2);
+    ASSERT_EQ(lane_outputs[1]->getAllReadings().size(), nbMeasurements);
+    for (READINGSET* output : lane_outputs) {
+        delete output;
+    }
+}
+
+// Test fan-out of readings holding several PIVOT objects
+TEST(Pivot2Opcua_Filter, Pivot2OpcuaFilterFanOut) {
+    TITLE("*** TEST FILTER Pivot2OpcuaFilterFanOut");
+    for (const char* chunkSize : {"0", "2"}) {
+        ConfigCategory config(::getEnabledConfig(Json_ExDataOK));
+        config.addItem(string("chunk_size"), string("chunk_size"), string("integer"), chunkSize, chunkSize);
+        Pivot2OpcuaFilter filter("FanOut filter", config, stubOutH, &f_chunk_output_stream);
+
+        // 2 "PIVOT" datapoints, the first one with 2 GTxx objects
+        Datapoint* pivot1(pivotDatapoint(JsonPivotMvf));
+        Datapoint* pivot2(pivotDatapoint(JsonPivotDps));
+        pivot1->getData().getDpVec()->push_back(pivot2->getData().getDpVec()->front());
+        pivot2->getData().getDpVec()->clear();
+        delete pivot2;
+        Reading* multi(new Reading("Multi", {pivot1, pivotDatapoint(JsonPivotSps)}));
+        struct timeval tm = {1700000000, 1234};
+        multi->setUserTimestamp(tm);
+
+        ReadingSet* rSet(new ReadingSet);
+        appendJsonToReadingSet(*rSet, JsonPivotMvi, "Single0");
+        Readings multiReadings{multi};
+        rSet->append(multiReadings);
+        appendJsonToReadingSet(*rSet, JsonPivotMvi, "Single1");
+        chunk_outputs.clear();
+        filter.ingest(rSet);
+
+        // Each PIVOT object is output in its own reading, following the original one
+        Readings outputs;
+        for (READINGSET* output : chunk_outputs) {
+            outputs.insert(outputs.end(), output->getAllReadings().begin(), output->getAllReadings().end());
+        }
+        ASSERT_EQ(outputs.size(), 5);
+        ASSERT_EQ(outputs[1], multi);
+        const vector<string> ids{"pivotMVI", "pivotMVF", "pivotDPS", "pivotSPS", "pivotMVI"};
+        for (size_t i = 0 ; i < outputs.size() ; i++) {
+            ASSERT_EQ(convertedId(outputs[i]), ids[i]);
+            ASSERT_EQ(outputs[i]->getReadingData().size(), 1);
+        }
+        for (size_t i = 2 ; i < 4 ; i++) {
+            ASSERT_EQ(outputs[i]->getAssetName(), "Multi");
+            struct timeval outTm;
+            outputs[i]->getUserTimestamp(&outTm);
+            ASSERT_EQ(outTm.tv_sec, tm.tv_sec);
+            ASSERT_EQ(outTm.tv_usec, tm.tv_usec);
+        }
+        for (READINGSET* output : chunk_outputs) {
+            delete output;
+        }
+    }
+}
+
+// Test pivot ids published to several OPC UA variables
+TEST(Pivot2Opcua_Filter, Pivot2OpcuaFilterMultiMapping) {
+    TITLE("*** TEST FILTER Pivot2OpcuaFilterMultiMapping");
+    ConfigCategory config(::getEnabledConfig(getExDataMultiMapping()));
+    Pivot2OpcuaFilter filter("Mapping filter", config, stubOutH, &f_chunk_output_stream);
+
+    ReadingSet rSet;
+    appendJsonToReadingSet(rSet, JsonPivotMvf, "Multi");
+    appendJsonToReadingSet(rSet, JsonPivotMvi, "Single");
+    chunk_outputs.clear();
+    filter.ingest(&rSet);
+    ASSERT_EQ(chunk_outputs.size(), 1);
+
+    // One reading per mapping, with its address. Single mappings are unchanged
+    const Readings& outputs(rSet.getAllReadings());
+    ASSERT_EQ(outputs.size(), 3);
+    const char* const expected[][3] = {{"pivotMVF", "opcua_mvi", "mvf_raw"}, {"pivotMVF", "opcua_mvf", "mvf"},
+            {"pivotMVI", "opcua_mvi", nullptr}};
+    for (size_t i = 0 ; i < outputs.size() ; i++) {
+        ASSERT_EQ(convertedId(outputs[i]), expected[i][0]);
+        DatapointValue* dataObject(get_datapoint_by_key(&outputs[i]->getReadingData(), "data_object"));
+        ASSERT_EQ(get_datapoint_by_key(dataObject->getDpVec(), "do_type")->toStringValue(), expected[i][1]);
+        DatapointValue* address(get_datapoint_by_key(dataObject->getDpVec(), "do_address"));
+        if (expected[i][2] == nullptr) {
+            ASSERT_EQ(address, nullptr);
+        } else {
+            ASSERT_NE(address, nullptr);
+            ASSERT_EQ(address->toStringValue(), expected[i][2]);
+        }
+        ASSERT_NE(get_datapoint_by_key(dataObject->getDpVec(), "do_value"), nullptr);
+    }
+
+    // Decoded once: a single conversion is accounted
+    Document doc;
+    doc.Parse(filter.getStatistics().c_str());
+    ASSERT_FALSE(doc.HasParseError());
+    ASSERT_EQ(doc["heavy_hitters"]["total"].GetInt(), 2);
+}
+
+// Test routing of readings by asset name
+TEST(Pivot2Opcua_Filter, Pivot2OpcuaFilterRouting) {
+    TITLE("*** TEST FILTER Pivot2OpcuaFilterRouting");
+    ConfigCategory config(::getEnabledConfig(Json_ExDataOK));
+    const string routing(QUOTE({"opcua_operation" : "opcua2pivot", "stats*" : "passthrough"}));
+    config.addItem(string("asset_routing"), string("asset_routing"), string("JSON"), routing, routing);
+    Pivot2OpcuaFilter filter("Routing filter", config, stubOutH, &f_chunk_output_stream);
+
+    ReadingSet rSet;
+    appendJsonToReadingSet(rSet, JsonPivotMvf, "statsPivot");
+    appendJsonToReadingSet(rSet, JsonPivotMvf, "pivot");
+    chunk_outputs.clear();
+    filter.ingest(&rSet);
+    ASSERT_EQ(chunk_outputs.size(), 1);
+    const Readings& outputs(rSet.getAllReadings());
+    ASSERT_EQ(outputs.size(), 2);
+    // Passed on unchanged
+    ASSERT_EQ(outputs[0]->getAssetName(), "statsPivot");
+    ASSERT_NE(get_datapoint_by_key(&outputs[0]->getReadingData(), "PIVOT"), nullptr);
+    ASSERT_EQ(convertedId(outputs[1]), "pivotMVF");
+
+    // Invalid tables are ignored
+    filter.reconfigure(QUOTE({"enable" : {"description" : "", "type" : "boolean", "value" : "true"},
+            "asset_routing" : {"description" : "", "type" : "JSON", "value" : "{\"stats*\" : \"drop\"}"}}));
+    ReadingSet rSet2;
+    appendJsonToReadingSet(rSet2, JsonPivotMvf, "statsPivot");
+    filter.ingest(&rSet2);
+    ASSERT_NE(get_datapoint_by_key(&rSet2.getAllReadings()[0]->getReadingData(), "PIVOT"), nullptr);
+}
+
+// Test packed records of a pivot id with more mappings than a record can rank
+TEST(Pivot2Opcua_Filter, Pivot2OpcuaFilterPackedMappings) {
+    TITLE("*** TEST FILTER Pivot2OpcuaFilterPackedMappings");
+    string protocols;
+    for (size_t i = 0 ; i < PackedRecord::MaxMappings + 10 ; i++) {
+        protocols += "\"address\":\"mvf" + std::to_string(i) + "\", \"typeid\":\"opcua_mvf\"}, {\"name\":\"opcua\", ";
+    }
+    ConfigCategory config(::getEnabledConfig(replace_in_string(Json_ExDataOK, QUOTE("address":"mvf"),
+            protocols + QUOTE("address":"mvf"))));
+    config.addItem(string("packed_output"), string("packed_output"), string("boolean"), string("true"),
+            string("true"));
+    Pivot2OpcuaFilter packed("Packed filter", config, stubOutH, &f_chunk_output_stream);
+
+    ReadingSet rSet;
+    appendJsonToReadingSet(rSet, JsonPivotMvf, "pivot");
+    packed.ingest(&rSet);
+    // Only the first mappings are published, each with its own rank
+    ASSERT_EQ(rSet.getAllReadings().size(), PackedRecord::MaxMappings);
+    for (size_t i = 0 ; i < PackedRecord::MaxMappings ; i++) {
+        PackedRecord record;
+        ASSERT_TRUE(record.decode(get_datapoint_by_key(&rSet.getAllReadings()[i]->getReadingData(),
+                "do_packed")->toStringValue()));
+        ASSERT_EQ(record.mapping, i);
+    }
+}
+
+// Test the compact layout of "data_object", against the default one
+TEST(Pivot2Opcua_Filter, Pivot2OpcuaFilterCompactOutput) {
+    TITLE("*** TEST FILTER Pivot2OpcuaFilterCompactOutput");
+    ConfigCategory config(::getEnabledConfig(Json_ExDataOK));
+    Pivot2OpcuaFilter verbose("Verbose filter", config, stubOutH, &f_chunk_output_stream);
+    config.addItem(string("compact_output"), string("compact_output"), string("boolean"), string("true"),
+            string("true"));
+    Pivot2OpcuaFilter compact("Compact filter", config, stubOutH, &f_chunk_output_stream);
+
+    ReadingSet rVerbose;
+    appendJsonToReadingSet(rVerbose, JsonPivotMvf, "pivot");
+    appendJsonToReadingSet(rVerbose, JsonPivotMvi, "pivot");
+    ReadingSet rCompact;
+    appendJsonToReadingSet(rCompact, JsonPivotMvf, "pivot");
+    appendJsonToReadingSet(rCompact, JsonPivotMvi, "pivot");
+    verbose.ingest(&rVerbose);
+    compact.ingest(&rCompact);
+    ASSERT_EQ(rCompact.getAllReadings().size(), 2);
+
+    const struct {
+        const char* name;
+        bool        coded;
+        CompactLayout::Field field;
+    } fields[] = {
+        {"do_comingfrom", true, CompactLayout::Field::ComingFrom},
+        {"do_type", true, CompactLayout::Field::OpcType},
+        {"do_value_quality", true, CompactLayout::Field::Validity},
+        {"do_source", true, CompactLayout::Field::Source},
+        {"do_ts_org", true, CompactLayout::Field::TmOrg},
+        {"do_ts_validity", true, CompactLayout::Field::Validity},
+        {"do_cot", false, CompactLayout::Field::ComingFrom},
+        {"do_confirmation", false, CompactLayout::Field::ComingFrom},
+        {"do_quality", false, CompactLayout::Field::ComingFrom},
+        {"do_ts_quality", false, CompactLayout::Field::ComingFrom},
+        {"do_ts", false, CompactLayout::Field::ComingFrom},
+        {"do_id", false, CompactLayout::Field::ComingFrom}};
+    for (size_t i = 0 ; i < 2 ; i++) {
+        Datapoints* full(get_datapoint_by_key(&rVerbose.getAllReadings()[i]->getReadingData(),
+                "data_object")->getDpVec());
+        Datapoints* small(get_datapoint_by_key(&rCompact.getAllReadings()[i]->getReadingData(),
+                "data_object")->getDpVec());
+        ASSERT_EQ(get_datapoint_by_key(small, "do_layout")->toInt(), CompactLayout::Version);
+        ASSERT_EQ(get_datapoint_by_key(small, "do_value")->toString(),
+                get_datapoint_by_key(full, "do_value")->toString());
+        ASSERT_LT(small->size(), full->size());
+
+        // Decoding the compact object, with omitted fields set to their default, gives the default one
+        for (const auto& field : fields) {
+            const DatapointValue* expected(get_datapoint_by_key(full, field.name));
+            const DatapointValue* value(get_datapoint_by_key(small, field.name));
+            if (!field.coded) {
+                ASSERT_EQ(value == nullptr ? string("0") : value->toString(), expected->toString()) << field.name;
+            } else if (value == nullptr) {
+                ASSERT_EQ(expected->toStringValue(), CompactLayout::decode(field.field, 0)) << field.name;
+            } else {
+                ASSERT_EQ(value->getType(), DatapointValue::T_INTEGER) << field.name;
+                ASSERT_EQ(expected->toStringValue(), CompactLayout::decode(field.field, value->toInt()))
+                        << field.name;
+            }
+        }
+    }
+    // "pivotMVF": "iec104", "opcua_mvf", confirmed, "genuine", "questionable"
+    Datapoints* mvf(get_datapoint_by_key(&rCompact.getAllReadings()[0]->getReadingData(), "data_object")->getDpVec());
+    ASSERT_EQ(get_datapoint_by_key(mvf, "do_comingfrom")->toInt(), 0);
+    ASSERT_EQ(get_datapoint_by_key(mvf, "do_type")->toInt(), 3);
+    ASSERT_EQ(get_datapoint_by_key(mvf, "do_confirmation")->toInt(), 1);
+    ASSERT_EQ(get_datapoint_by_key(mvf, "do_ts_org"), nullptr);
+    ASSERT_EQ(get_datapoint_by_key(mvf, "do_ts_validity")->toInt(), 3);
+    ASSERT_EQ(get_datapoint_by_key(mvf, "do_value_quality"), nullptr);
+}
+
+// Test the packed records, against the default output
+TEST(Pivot2Opcua_Filter, Pivot2OpcuaFilterPackedOutput) {
+    TITLE("*** TEST FILTER Pivot2OpcuaFilterPackedOutput");
+    ConfigCategory config(::getEnabledConfig(getExDataMultiMapping()));
+    config.addItem(string("latency_stamp"), string("latency_stamp"), string("boolean"), string("true"),
+            string("true"));
+    Pivot2OpcuaFilter verbose("Verbose filter", config, stubOutH, &f_chunk_output_stream);
+    config.addItem(string("packed_output"), string("packed_output"), string("boolean"), string("true"),
+            string("true"));
+    Pivot2OpcuaFilter packed("Packed filter", config, stubOutH, &f_chunk_output_stream);
+
+    ReadingSet rVerbose;
+    appendJsonToReadingSet(rVerbose, JsonPivotMvf, "pivot");
+    appendJsonToReadingSet(rVerbose, JsonPivotMvi, "pivot");
+    ReadingSet rPacked;
+    appendJsonToReadingSet(rPacked, JsonPivotMvf, "pivot");
+    appendJsonToReadingSet(rPacked, JsonPivotMvi, "pivot");
+    verbose.ingest(&rVerbose);
+    packed.ingest(&rPacked);
+    ASSERT_EQ(rPacked.getAllReadings().size(), 3);
+
+    const uint8_t expectedMapping[] = {0, 1, 0};
+    for (size_t i = 0 ; i < 3 ; i++) {
+        Reading* reading(rPacked.getAllReadings()[i]);
+        ASSERT_EQ(reading->getReadingData().size(), 1);
+        ASSERT_EQ(get_datapoint_by_key(&reading->getReadingData(), "data_object"), nullptr);
+        DatapointValue* value(get_datapoint_by_key(&reading->getReadingData(), "do_packed"));
+        ASSERT_NE(value, nullptr);
+        ASSERT_EQ(value->getType(), DatapointValue::T_STRING);
+        PackedRecord record;
+        ASSERT_TRUE(record.decode(value->toStringValue()));
+        ASSERT_EQ(record.mapping, expectedMapping[i]);
+
+        Datapoints* full(get_datapoint_by_key(&rVerbose.getAllReadings()[i]->getReadingData(),
+                "data_object")->getDpVec());
+        ASSERT_EQ(record.id, get_datapoint_by_key(full, "do_id")->toStringValue());
+        ASSERT_STREQ(CompactLayout::decode(CompactLayout::Field::OpcType, record.opcType),
+                get_datapoint_by_key(full, "do_type")->toStringValue().c_str());
+        ASSERT_STREQ(CompactLayout::decode(CompactLayout::Field::ComingFrom, record.comingFrom),
+                get_datapoint_by_key(full, "do_comingfrom")->toStringValue().c_str());
+        ASSERT_STREQ(CompactLayout::decode(CompactLayout::Field::Validity, record.valueQuality),
+                get_datapoint_by_key(full, "do_value_quality")->toStringValue().c_str());
+        ASSERT_STREQ(CompactLayout::decode(CompactLayout::Field::TmOrg, record.tmOrg),
+                get_datapoint_by_key(full, "do_ts_org")->toStringValue().c_str());
+        ASSERT_STREQ(CompactLayout::decode(CompactLayout::Field::Validity, record.tmValidity),
+                get_datapoint_by_key(full, "do_ts_validity")->toStringValue().c_str());
+        ASSERT_EQ(record.cot, get_datapoint_by_key(full, "do_cot")->toInt());
+        ASSERT_EQ(record.confirmation, get_datapoint_by_key(full, "do_confirmation")->toInt() != 0);
+        ASSERT_EQ(record.quality, get_datapoint_by_key(full, "do_quality")->toInt());
+        ASSERT_EQ(record.tsQuality, get_datapoint_by_key(full, "do_ts_quality")->toInt());
+        ASSERT_EQ(record.ts, get_datapoint_by_key(full, "do_ts")->toInt());
+        const DatapointValue* doValue(get_datapoint_by_key(full, "do_value"));
+        if (doValue->getType() == DatapointValue::T_FLOAT) {
+            ASSERT_EQ(record.kind, PackedRecord::ValueKind::Float);
+            ASSERT_EQ(record.floatValue, doValue->toDouble());
+        } else {
+            ASSERT_EQ(record.kind, PackedRecord::ValueKind::Integer);
+            ASSERT_EQ(record.intValue, doValue->toInt());
+        }
+    }
+}
+
+// Test handles carried in outputs, and their table
+TEST(Pivot2Opcua_Filter, Pivot2OpcuaFilterHandles) {
+    TITLE("*** TEST FILTER Pivot2OpcuaFilterHandles");
+    const string dataDir(string("/tmp/p2o_handles_") + std::to_string(getpid()));
+    const char* previous(getenv("FLEDGE_DATA"));
+    const string previousDataDir(previous == nullptr ? "" : previous);
+    mkdir(dataDir.c_str(), 0755);
+    setenv("FLEDGE_DATA", dataDir.c_str(), 1);
+    const string path(SignalHandles::defaultPath("Handles filter"));
+    const auto readTable = [&path](Document* doc) -> void {
+        std::ifstream file(path);
+        std::stringstream content;
+        content << file.rdbuf();
+        doc->Parse(content.str().c_str());
+    };
+    const auto convertedHandle = [](const char* json, const string& id, Pivot2OpcuaFilter* filter) -> int64_t {
+        ReadingSet rSet;
+        appendJsonToReadingSet(rSet, replace_in_string(json, "pivotMVF", id), "Handles");
+        filter->ingest(&rSet);
+        DatapointValue* dataObject(getDoResult(rSet));
+        if (dataObject == nullptr) return -1;
+        return get_datapoint_by_key(dataObject->getDpVec(), "do_handle")->toInt();
+    };
+
+    ConfigCategory config(::getEnabledConfig(replace_in_string(Json_ExDataOK, "label1", "labelHandles")));
+    Pivot2OpcuaFilter filter("Handles filter", config, stubOutH, &f_output_stream);
+    Document doc;
+    readTable(&doc);
+    ASSERT_FALSE(doc.HasParseError());
+    const int64_t handle(convertedHandle(JsonPivotMvf, "pivotMVF", &filter));
+    ASSERT_GE(handle, 0);
+    ASSERT_STREQ(doc["handles"][static_cast<SizeType>(handle)]["pivot_id"].GetString(), "pivotMVF");
+    const int64_t mviHandle(convertedHandle(JsonPivotMvi, "pivotMVI", &filter));
+
+    // "pivotMVI" is renamed: other ids keep their handle, the new id gets the one of "pivotMVI"
+    const string confHeader(QUOTE({"enable" : {"description" : "", "type" : "boolean", "value" : "true"},
+            "exchanged_data" : {"description" : "", "type" : "JSON", "value" :));
+    filter.reconfigure(confHeader + replace_in_string(replace_in_string(Json_ExDataOK, "label1", "labelHandles"),
+            "pivotMVI", "pivotNEW") + "}}");
+    filter.waitConfigured();
+    ASSERT_EQ(convertedHandle(JsonPivotMvf, "pivotMVF", &filter), handle);
+    readTable(&doc);
+    ASSERT_FALSE(doc.HasParseError());
+    ASSERT_STREQ(doc["handles"][static_cast<SizeType>(mviHandle)]["pivot_id"].GetString(), "pivotNEW");
+
+    // Restart with the initial configuration: handles are those of the saved table
+    {
+        Pivot2OpcuaFilter restarted("Handles filter", config, stubOutH, &f_output_stream);
+        ASSERT_EQ(convertedHandle(JsonPivotMvf, "pivotMVF", &restarted), handle);
+        ASSERT_EQ(convertedHandle(JsonPivotMvi, "pivotMVI", &restarted), mviHandle);
+    }
+
+    unlink(path.c_str());
+    unlink(DictionarySnapshot::defaultPath("Handles filter").c_str());
+    rmdir((dataDir + "/pivottoopcua").c_str());
+    rmdir(dataDir.c_str());
+    if (previous == nullptr) {
+        unsetenv("FLEDGE_DATA");
+    } else {
+        setenv("FLEDGE_DATA", previousDataDir.c_str(), 1);
+    }
+}
+
 #undef INGEST
 #define INGEST(rSet, json, _type)  \
     ReadingSet rSet;                                    \
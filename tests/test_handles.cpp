@@ -0,0 +1,171 @@
+#include <gtest/gtest.h>
+#include <plugin_api.h>
+#include <string.h>
+#include <unistd.h>
+#include <fstream>
+#include <initializer_list>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <rapidjson/document.h>
+
+// Tested files
+#include "pivot2opcua_common.h"
+#include "pivot2opcua_filter.h"
+#include "pivot2opcua_handles.h"
+
+// Fledge / tools  includes
+#include "config_category.h"
+#include "main_test_configs.h"
+
+using namespace std;
+using namespace rapidjson;
+
+/** Test pivot2opcua_handles APIs */
+
+namespace {
+/** @return A dictionnary of 'ids', each published to the address "addr_<id>" */
+DataDictionnary_SharedPtr makeDictionnary(std::initializer_list<const char*> ids) {
+    PivotElementMap_t map;
+    for (const char* id : ids) {
+        map.emplace(std::piecewise_construct, std::forward_as_tuple(id),
+                std::forward_as_tuple("GTIS", "opcua_sps", string("addr_") + id));
+    }
+    return DataDictionnary_SharedPtr(new DataDictionnary(std::move(map), 0));
+}
+
+uint32_t handleOf(const SignalHandles& handles, const DataDictionnary& dictionnary, const string& id) {
+    return handles.handle(dictionnary.find(id)->second);
+}
+}   // namespace
+
+/* Initial handles are dense, in pivot id order */
+TEST(Pivot2Opcua_Handles, Assign) {
+    TITLE("*** TEST HANDLES Assign");
+    const DataDictionnary_SharedPtr dic(makeDictionnary({"b", "c", "a"}));
+    const SignalHandles handles(dic, nullptr);
+    ASSERT_EQ(handles.size(), 3);
+    ASSERT_EQ(handles.kept(), 0);
+    const char* const ids[] = {"a", "b", "c"};
+    for (uint32_t handle = 0 ; handle < 3 ; handle++) {
+        ASSERT_EQ(handleOf(handles, *dic, ids[handle]), handle);
+        ASSERT_NE(handles.entry(handle), nullptr);
+        ASSERT_EQ(handles.entry(handle)->first, ids[handle]);
+    }
+    ASSERT_EQ(handles.entry(3), nullptr);
+
+    // Same ids, another build: same handles
+    const DataDictionnary_SharedPtr other(makeDictionnary({"c", "a", "b"}));
+    const SignalHandles otherHandles(other, nullptr);
+    for (const char* id : ids) {
+        ASSERT_EQ(handleOf(otherHandles, *other, id), handleOf(handles, *dic, id));
+    }
+}
+
+/* Unchanged ids keep their handle, removed ones are reused */
+TEST(Pivot2Opcua_Handles, Stable) {
+    TITLE("*** TEST HANDLES Stable");
+    const DataDictionnary_SharedPtr dic1(makeDictionnary({"a", "b", "c"}));
+    const SignalHandles handles1(dic1, nullptr);
+
+    // "a" and "b" removed, "d" and "a0" added
+    const DataDictionnary_SharedPtr dic2(makeDictionnary({"c", "d", "a0"}));
+    const SignalHandles handles2(dic2, &handles1);
+    ASSERT_EQ(handles2.kept(), 1);
+    ASSERT_EQ(handles2.size(), 3);
+    ASSERT_EQ(handleOf(handles2, *dic2, "c"), 2);
+    ASSERT_EQ(handleOf(handles2, *dic2, "a0"), 0);
+    ASSERT_EQ(handleOf(handles2, *dic2, "d"), 1);
+
+    // Shrinking: kept handles do not move, new ones go after them
+    const DataDictionnary_SharedPtr dic3(makeDictionnary({"d"}));
+    const SignalHandles handles3(dic3, &handles2);
+    ASSERT_EQ(handles3.size(), 2);
+    ASSERT_EQ(handles3.entry(0), nullptr);
+    ASSERT_EQ(handleOf(handles3, *dic3, "d"), 1);
+    const DataDictionnary_SharedPtr dic4(makeDictionnary({"d", "e", "f"}));
+    const SignalHandles handles4(dic4, &handles3);
+    ASSERT_EQ(handles4.size(), 3);
+    ASSERT_EQ(handleOf(handles4, *dic4, "e"), 0);
+    ASSERT_EQ(handleOf(handles4, *dic4, "d"), 1);
+    ASSERT_EQ(handleOf(handles4, *dic4, "f"), 2);
+
+    // Empty dictionnary
+    const SignalHandles handles5(makeDictionnary({}), &handles4);
+    ASSERT_EQ(handles5.size(), 0);
+}
+
+/* Exported table: one object per handle, with all the mappings */
+TEST(Pivot2Opcua_Handles, Export) {
+    TITLE("*** TEST HANDLES Export");
+    const DataDictionnary_SharedPtr dic(new DataDictionnary(getExDataMultiMapping()));
+    const SignalHandles handles(dic, nullptr);
+    const string path("/tmp/pivot2opcua_test_handles.json");
+    ASSERT_TRUE(handles.save(path));
+    ASSERT_FALSE(handles.save("/non_existing_folder/handles.json"));
+
+    std::ifstream file(path);
+    std::stringstream content;
+    content << file.rdbuf();
+    unlink(path.c_str());
+    Document doc;
+    doc.Parse(content.str().c_str());
+    ASSERT_FALSE(doc.HasParseError());
+    const Value& table(doc["handles"]);
+    ASSERT_EQ(table.Size(), dic->size());
+
+    const Value& mvf(table[handleOf(handles, *dic, "pivotMVF")]);
+    ASSERT_STREQ(mvf["pivot_id"].GetString(), "pivotMVF");
+    ASSERT_EQ(mvf["mappings"].Size(), 2);
+    ASSERT_STREQ(mvf["mappings"][0]["address"].GetString(), "mvf_raw");
+    ASSERT_STREQ(mvf["mappings"][0]["type"].GetString(), "opcua_mvi");
+    ASSERT_STREQ(mvf["mappings"][1]["address"].GetString(), "mvf");
+    const Value& pivot1(table[handleOf(handles, *dic, "pivot1")]);
+    ASSERT_EQ(pivot1["mappings"].Size(), 1);
+    ASSERT_STREQ(pivot1["mappings"][0]["address"].GetString(), "addr1");
+    ASSERT_STREQ(pivot1["mappings"][0]["type"].GetString(), "opcua_dps");
+
+    // Unassigned handles
+    const SignalHandles sparse(makeDictionnary({"pivot2"}), &handles);
+    rapidjson::StringBuffer buffer;
+    JsonWriter_t writer(buffer);
+    sparse.toJson(&writer);
+    doc.Parse(buffer.GetString());
+    ASSERT_FALSE(doc.HasParseError());
+    ASSERT_EQ(doc["handles"].Size(), handleOf(handles, *dic, "pivot2") + 1);
+    ASSERT_TRUE(doc["handles"][0].IsNull());
+}
+
+/* Handles of a saved table are kept (restart) */
+TEST(Pivot2Opcua_Handles, Restart) {
+    TITLE("*** TEST HANDLES Restart");
+    const string path("/tmp/pivot2opcua_test_handles_restart.json");
+    const DataDictionnary_SharedPtr dic1(makeDictionnary({"a", "b", "c"}));
+    const SignalHandles handles1(dic1, nullptr);
+    ASSERT_TRUE(handles1.save(path));
+
+    vector<string> ids;
+    ASSERT_TRUE(SignalHandles::load(path, &ids));
+    ASSERT_EQ(ids, vector<string>({"a", "b", "c"}));
+    // "a" and "b" removed, "d" added
+    const DataDictionnary_SharedPtr dic2(makeDictionnary({"c", "d"}));
+    const SignalHandles handles2(dic2, ids);
+    ASSERT_EQ(handles2.kept(), 1);
+    ASSERT_EQ(handleOf(handles2, *dic2, "c"), 2);
+    ASSERT_EQ(handleOf(handles2, *dic2, "d"), 0);
+
+    // Unassigned handles are kept as holes
+    ASSERT_TRUE(handles2.save(path));
+    ASSERT_TRUE(SignalHandles::load(path, &ids));
+    ASSERT_EQ(ids, vector<string>({"d", "", "c"}));
+
+    // Missing or invalid tables
+    {
+        std::ofstream file(path);
+        file << "{\"handles\": 3}";
+    }
+    ASSERT_FALSE(SignalHandles::load(path, &ids));
+    unlink(path.c_str());
+    ASSERT_FALSE(SignalHandles::load(path, &ids));
+}
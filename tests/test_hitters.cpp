@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+#include <plugin_api.h>
+#include <string.h>
+#include <string>
+#include <rapidjson/document.h>
+
+// Tested files
+#include "pivot2opcua_common.h"
+#include "pivot2opcua_filter.h"
+#include "pivot2opcua_hitters.h"
+
+// Fledge / tools  includes
+#include "config_category.h"
+#include "main_test_configs.h"
+
+using namespace std;
+using namespace rapidjson;
+
+/** Test pivot2opcua_hitters APIs */
+
+/* Most frequent keys are found among many rare ones */
+TEST(Pivot2Opcua_Hitters, HeavyHitters) {
+    TITLE("*** TEST HITTERS HeavyHitters");
+    HeavyHitters hitters(20);
+    ASSERT_EQ(hitters.total(), 0);
+    ASSERT_EQ(hitters.count(0), 0);
+
+    // Key N < 5 ("hotN") is seen (10 - N) times more often than each rare key (from RareKey)
+    const uint32_t RareKey(100);
+    int64_t nowUs(1000000);
+    for (int i = 0 ; i < 1000 ; i++) {
+        for (int hot = 0 ; hot < 5 ; hot++) {
+            for (int repeat = 0 ; repeat < 10 - hot ; repeat++) {
+                hitters.add(static_cast<uint32_t>(hot), nowUs);
+            }
+        }
+        for (int rare = 0 ; rare < 20 ; rare++) {
+            hitters.add(RareKey + static_cast<uint32_t>(i * 20 + rare), nowUs);
+        }
+        nowUs += 1000;
+    }
+    ASSERT_EQ(hitters.total(), 1000 * (40 + 20));
+    for (int hot = 0 ; hot < 5 ; hot++) {
+        const uint64_t count(hitters.count(static_cast<uint32_t>(hot)));
+        ASSERT_GE(count, 1000 * (10 - hot));
+        ASSERT_LE(count, 1000 * (10 - hot) + hitters.total() / 20);
+    }
+
+    rapidjson::StringBuffer buffer;
+    JsonWriter_t writer(buffer);
+    hitters.toJson(&writer, 3, [RareKey](uint32_t key) -> std::string {
+        return key < RareKey ? "hot" + std::to_string(key) : "rare" + std::to_string(key - RareKey);
+    });
+    Document doc;
+    doc.Parse(buffer.GetString());
+    ASSERT_FALSE(doc.HasParseError());
+    ASSERT_EQ(doc["total"].GetInt(), 60000);
+    ASSERT_NEAR(doc["window_s"].GetDouble(), 0.999, 0.0001);
+    const Value& top(doc["top"]);
+    ASSERT_EQ(top.Size(), 3);
+    for (unsigned i = 0 ; i < 3 ; i++) {
+        ASSERT_STREQ(top[i]["id"].GetString(), ("hot" + std::to_string(i)).c_str());
+        ASSERT_LE(top[i]["count"].GetUint64() - top[i]["error"].GetUint64(), 1000 * (10 - i));
+        ASSERT_GT(top[i]["rate"].GetDouble(), 1000.0 * (10 - i));
+    }
+
+    // Removed keys are no more tracked, the others keep their order
+    ASSERT_EQ(hitters.keys().size(), 20);
+    ASSERT_EQ(hitters.keys()[0], 0);
+    hitters.remove(0);
+    ASSERT_EQ(hitters.count(0), 0);
+    ASSERT_EQ(hitters.keys().size(), 19);
+    ASSERT_EQ(hitters.keys()[0], 1);
+    ASSERT_GE(hitters.count(1), 9000);
+    hitters.add(1, nowUs);
+    ASSERT_EQ(hitters.keys()[0], 1);
+
+    hitters.reset();
+    ASSERT_EQ(hitters.total(), 0);
+    ASSERT_EQ(hitters.count(0), 0);
+}
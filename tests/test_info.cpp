@@ -31,3 +31,29 @@ TEST(Pivot2Opcua_Plugin, PluginInfo) {
     ASSERT_STREQ(info->type, PLUGIN_TYPE_FILTER);
 }
 
+
+TEST(Pivot2Opcua_Plugin, PluginDefaultConfig) {
+    TITLE("*** TEST Info PluginDefaultConfig");
+
+    PLUGIN_INFORMATION *info = plugin_info();
+    Document doc;
+    doc.Parse(info->config);
+    ASSERT_FALSE(doc.HasParseError());
+    ASSERT_TRUE(doc.HasMember("exchanged_data"));
+    ASSERT_TRUE(doc.HasMember("latency_stamp"));
+    ASSERT_TRUE(doc.HasMember("stats_period"));
+    ASSERT_TRUE(doc.HasMember("command_timeout"));
+    ASSERT_TRUE(doc.HasMember("command_max_pending"));
+    ASSERT_TRUE(doc.HasMember("capture_file"));
+    ASSERT_TRUE(doc.HasMember("capture_size"));
+    ASSERT_TRUE(doc.HasMember("dictionary_threads"));
+    ASSERT_TRUE(doc.HasMember("dictionary_snapshot"));
+    ASSERT_TRUE(doc.HasMember("chunk_size"));
+    ASSERT_TRUE(doc.HasMember("batch_size"));
+    ASSERT_TRUE(doc.HasMember("batch_delay_us"));
+    ASSERT_TRUE(doc.HasMember("async_queue"));
+    ASSERT_TRUE(doc.HasMember("async_full_policy"));
+    ASSERT_TRUE(doc.HasMember("asset_routing"));
+    ASSERT_TRUE(doc.HasMember("compact_output"));
+    ASSERT_TRUE(doc.HasMember("packed_output"));
+}
@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+#include <plugin_api.h>
+#include <string.h>
+#include <string>
+
+// Tested files
+#include "pivot2opcua_common.h"
+#include "pivot2opcua_filter.h"
+#include "pivot2opcua_packed.h"
+
+// Fledge / tools  includes
+#include "config_category.h"
+#include "main_test_configs.h"
+
+using namespace std;
+
+/** Test pivot2opcua_packed APIs */
+
+namespace {
+PackedRecord sampleRecord(void) {
+    PackedRecord record;
+    record.opcType = 3;
+    record.comingFrom = 0;
+    record.valueQuality = 0;
+    record.source = 1;
+    record.tmOrg = PackedRecord::NoCode;
+    record.tmValidity = 3;
+    record.handle = 0x12345678;
+    record.confirmation = true;
+    record.mapping = 2;
+    record.cot = 20;
+    record.quality = 0x81;
+    record.tsQuality = 0x4000000A;
+    record.tsMicros = 999999;
+    record.ts = -1700000000;
+    record.id = "S1/B2/CB3/Pos";
+    return record;
+}
+}   // namespace
+
+/* Records of each value kind are decoded as encoded */
+TEST(Pivot2Opcua_Packed, RoundTrip) {
+    TITLE("*** TEST PACKED RoundTrip");
+    PackedRecord record(sampleRecord());
+    for (const PackedRecord::ValueKind kind : {PackedRecord::ValueKind::Integer, PackedRecord::ValueKind::Float,
+            PackedRecord::ValueKind::String}) {
+        record.kind = kind;
+        record.intValue = (kind == PackedRecord::ValueKind::Integer ? -42 : 0);
+        record.floatValue = (kind == PackedRecord::ValueKind::Float ? 3.14 : 0);
+        record.stringValue = (kind == PackedRecord::ValueKind::String ? "on" : "");
+        // Pivot id lengths hitting each base64 padding
+        for (const char* id : {"", "a", "ab", "abc"}) {
+            record.id = id;
+            PackedRecord decoded;
+            ASSERT_TRUE(decoded.decode(record.encode())) << id;
+            ASSERT_EQ(decoded.opcType, record.opcType);
+            ASSERT_EQ(decoded.comingFrom, record.comingFrom);
+            ASSERT_EQ(decoded.valueQuality, record.valueQuality);
+            ASSERT_EQ(decoded.source, record.source);
+            ASSERT_EQ(decoded.tmOrg, record.tmOrg);
+            ASSERT_EQ(decoded.tmValidity, record.tmValidity);
+            ASSERT_EQ(decoded.kind, record.kind);
+            ASSERT_EQ(decoded.handle, record.handle);
+            ASSERT_EQ(decoded.confirmation, record.confirmation);
+            ASSERT_EQ(decoded.mapping, record.mapping);
+            ASSERT_EQ(decoded.cot, record.cot);
+            ASSERT_EQ(decoded.quality, record.quality);
+            ASSERT_EQ(decoded.tsQuality, record.tsQuality);
+            ASSERT_EQ(decoded.tsMicros, record.tsMicros);
+            ASSERT_EQ(decoded.ts, record.ts);
+            ASSERT_EQ(decoded.intValue, record.intValue);
+            ASSERT_EQ(decoded.floatValue, record.floatValue);
+            ASSERT_EQ(decoded.stringValue, record.stringValue);
+            ASSERT_EQ(decoded.id, record.id);
+        }
+    }
+}
+
+/* The layout is fixed: fields are found at their documented offsets */
+TEST(Pivot2Opcua_Packed, Layout) {
+    TITLE("*** TEST PACKED Layout");
+    PackedRecord record(sampleRecord());
+    record.id = "ab";
+    // 48 + 2 bytes: 68 base64 characters
+    const string packed(record.encode());
+    ASSERT_EQ(packed.size(), 68);
+    ASSERT_EQ(packed.substr(0, 12), "AQMAAAH/AwB4");   // 01 03 00 00 01 FF 03 00 78 ...
+    ASSERT_EQ(packed.substr(packed.size() - 4), "YWI=");   // "ab"
+}
+
+/* Invalid records are rejected */
+TEST(Pivot2Opcua_Packed, Invalid) {
+    TITLE("*** TEST PACKED Invalid");
+    PackedRecord record(sampleRecord());
+    record.kind = PackedRecord::ValueKind::String;
+    record.stringValue = "value";
+    const string packed(record.encode());
+    PackedRecord decoded;
+    ASSERT_TRUE(decoded.decode(packed));
+
+    ASSERT_FALSE(decoded.decode(""));
+    ASSERT_FALSE(decoded.decode(packed.substr(0, packed.size() - 1)));      // Not base64
+    ASSERT_FALSE(decoded.decode(packed.substr(0, 64)));                     // Truncated header
+    ASSERT_FALSE(decoded.decode(packed.substr(0, 72)));                     // Truncated id
+    ASSERT_FALSE(decoded.decode(packed.substr(0, 84)));                     // Truncated value
+    string badChar(packed);
+    badChar[10] = '*';
+    ASSERT_FALSE(decoded.decode(badChar));
+    string badVersion(packed);
+    badVersion[1] = 'g';    // Version 2
+    ASSERT_FALSE(decoded.decode(badVersion));
+    ASSERT_EQ(decoded.id, record.id);
+}
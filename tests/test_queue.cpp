@@ -0,0 +1,159 @@
+#include <gtest/gtest.h>
+#include <plugin_api.h>
+#include <string.h>
+#include <unistd.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <rapidjson/document.h>
+
+// Tested files
+#include "pivot2opcua_common.h"
+#include "pivot2opcua_filter.h"
+#include "pivot2opcua_queue.h"
+#include "pivot2opcua_async.h"
+
+// Fledge / tools  includes
+#include "config_category.h"
+#include "main_test_configs.h"
+
+using namespace std;
+using namespace rapidjson;
+
+/** Test pivot2opcua_queue and pivot2opcua_async APIs */
+
+namespace {
+/** Fake sets: only their address is used */
+ReadingSet* fakeSet(size_t index) {
+    return reinterpret_cast<ReadingSet*>(index + 1);
+}
+}   // namespace
+
+/* FIFO order and bounds */
+TEST(Pivot2Opcua_Queue, ReadingQueue) {
+    TITLE("*** TEST QUEUE ReadingQueue");
+    ASSERT_EQ(ReadingQueue(1).capacity(), 2);
+    ReadingQueue queue(3);
+    ASSERT_EQ(queue.capacity(), 3);
+    ReadingQueue::Item item{nullptr, 0};
+    ASSERT_FALSE(queue.tryPop(&item));
+    for (int round = 0 ; round < 3 ; round++) {
+        for (size_t i = 0 ; i < 3 ; i++) {
+            ASSERT_TRUE(queue.tryPush(ReadingQueue::Item{fakeSet(i), static_cast<int64_t>(i)}));
+        }
+        ASSERT_FALSE(queue.tryPush(ReadingQueue::Item{fakeSet(3), 3}));
+        ASSERT_EQ(queue.size(), 3);
+        for (size_t i = 0 ; i < 3 ; i++) {
+            ASSERT_TRUE(queue.tryPop(&item));
+            ASSERT_EQ(item.readingSet, fakeSet(i));
+            ASSERT_EQ(item.enqueuedUs, static_cast<int64_t>(i));
+        }
+        ASSERT_FALSE(queue.tryPop(&item));
+        ASSERT_EQ(queue.size(), 0);
+    }
+}
+
+/* Concurrent producers and consumers: every item is popped exactly once */
+TEST(Pivot2Opcua_Queue, ReadingQueueConcurrency) {
+    TITLE("*** TEST QUEUE ReadingQueueConcurrency");
+    ReadingQueue queue(16);
+    const size_t nbItems(20000);
+    std::vector<std::atomic<int>> seen(2 * nbItems);
+    for (std::atomic<int>& count : seen) {
+        count = 0;
+    }
+    std::atomic<size_t> popped(0);
+    std::vector<std::thread> threads;
+    for (size_t producer = 0 ; producer < 2 ; producer++) {
+        threads.emplace_back([&queue, producer, nbItems]() {
+            for (size_t i = 0 ; i < nbItems ; i++) {
+                while (!queue.tryPush(ReadingQueue::Item{fakeSet(producer * nbItems + i), 0})) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (size_t consumer = 0 ; consumer < 2 ; consumer++) {
+        threads.emplace_back([&queue, &seen, &popped, nbItems]() {
+            ReadingQueue::Item item{nullptr, 0};
+            while (popped < 2 * nbItems) {
+                if (queue.tryPop(&item)) {
+                    seen[reinterpret_cast<size_t>(item.readingSet) - 1]++;
+                    popped++;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    for (const std::atomic<int>& count : seen) {
+        ASSERT_EQ(count, 1);
+    }
+}
+
+/* Sets are processed in order by the thread, the oldest ones are dropped if requested */
+TEST(Pivot2Opcua_Queue, AsyncIngest) {
+    TITLE("*** TEST QUEUE AsyncIngest");
+    FilterStatistics statistics;
+    std::mutex mutex;
+    std::vector<size_t> processed;
+    std::atomic<bool> blocked(true);
+    {
+        AsyncIngest async(2, AsyncIngest::FullPolicy::DropOldest, [&](ReadingSet* readingSet) {
+            while (blocked) usleep(1000);
+            std::lock_guard<std::mutex> guard(mutex);
+            processed.push_back(readingSet->getAllReadings().size());
+            delete readingSet;
+        }, &statistics);
+        ASSERT_EQ(async.depth(), 2);
+        // The first set is taken by the thread (blocked), 2 sets fill the queue, the next ones drop the oldest
+        for (size_t i = 1 ; i <= 6 ; i++) {
+            ReadingSet* readingSet(new ReadingSet);
+            for (size_t j = 0 ; j < i ; j++) {
+                appendJsonToReadingSet(*readingSet, JsonPivotMvf, "Async");
+            }
+            async.push(readingSet);
+            if (i == 1) usleep(50000);
+        }
+        blocked = false;
+    }
+    ASSERT_EQ(processed, std::vector<size_t>({1, 5, 6}));
+
+    Document doc;
+    doc.Parse(statistics.toJson().c_str());
+    ASSERT_FALSE(doc.HasParseError());
+    const Value& queue(doc["ingest_queue"]);
+    ASSERT_EQ(queue["dropped_sets"].GetInt(), 3);
+    ASSERT_EQ(queue["dropped_readings"].GetInt(), 2 + 3 + 4);
+    ASSERT_EQ(queue["blocked_pushes"].GetInt(), 0);
+    ASSERT_EQ(queue["wait"]["count"].GetInt(), 3);
+    ASSERT_EQ(queue["max_depth"].GetInt(), 2);
+}
+
+/* Backpressure: the producer waits when the queue is full */
+TEST(Pivot2Opcua_Queue, AsyncIngestBlock) {
+    TITLE("*** TEST QUEUE AsyncIngestBlock");
+    FilterStatistics statistics;
+    std::atomic<size_t> processed(0);
+    {
+        AsyncIngest async(2, AsyncIngest::FullPolicy::Block, [&processed](ReadingSet* readingSet) {
+            usleep(2000);
+            processed++;
+            delete readingSet;
+        }, &statistics);
+        for (size_t i = 0 ; i < 20 ; i++) {
+            async.push(new ReadingSet);
+        }
+    }
+    ASSERT_EQ(processed, 20);
+    Document doc;
+    doc.Parse(statistics.toJson().c_str());
+    ASSERT_FALSE(doc.HasParseError());
+    ASSERT_EQ(doc["ingest_queue"]["dropped_sets"].GetInt(), 0);
+    ASSERT_GT(doc["ingest_queue"]["blocked_pushes"].GetInt(), 0);
+    ASSERT_EQ(doc["ingest_queue"]["wait"]["count"].GetInt(), 20);
+}
@@ -0,0 +1,46 @@
+#include <gtest/gtest.h>
+#include <plugin_api.h>
+#include <string.h>
+#include <exception>
+#include <string>
+
+// Tested files
+#include "pivot2opcua_common.h"
+#include "pivot2opcua_filter.h"
+#include "pivot2opcua_router.h"
+
+// Fledge / tools  includes
+#include "config_category.h"
+#include "main_test_configs.h"
+
+using namespace std;
+
+/** Test pivot2opcua_router APIs */
+
+/* Exact names, then longest prefixes, then PIVOT conversion */
+TEST(Pivot2Opcua_Router, Routes) {
+    TITLE("*** TEST ROUTER Routes");
+    const AssetRouter builtIn;
+    ASSERT_EQ(builtIn.route("opcua_operation"), AssetRouter::Route::Opcua2Pivot);
+    ASSERT_EQ(builtIn.route("any"), AssetRouter::Route::Pivot2Opcua);
+
+    const AssetRouter router(QUOTE({"stats*" : "passthrough", "stats_pivot*" : "pivot2opcua",
+            "stats_pivot_raw" : "passthrough", "cmd" : "opcua2pivot", "*" : "passthrough"}));
+    ASSERT_EQ(router.size(), 5);
+    ASSERT_EQ(router.route("cmd"), AssetRouter::Route::Opcua2Pivot);
+    ASSERT_EQ(router.route("stats"), AssetRouter::Route::Passthrough);
+    ASSERT_EQ(router.route("stats_north"), AssetRouter::Route::Passthrough);
+    ASSERT_EQ(router.route("stats_pivot_1"), AssetRouter::Route::Pivot2Opcua);
+    ASSERT_EQ(router.route("stats_pivot_raw"), AssetRouter::Route::Passthrough);
+    ASSERT_EQ(router.route("opcua_operation"), AssetRouter::Route::Passthrough);
+
+    // No catch-all: PIVOT conversion
+    const AssetRouter partial(QUOTE({"stats*" : "passthrough"}));
+    ASSERT_EQ(partial.route("other"), AssetRouter::Route::Pivot2Opcua);
+    ASSERT_EQ(partial.route("opcua_operation"), AssetRouter::Route::Pivot2Opcua);
+
+    ASSERT_THROW(AssetRouter(QUOTE({"a" : "convert"})), std::exception);
+    ASSERT_THROW(AssetRouter(QUOTE({"a" : 1})), std::exception);
+    ASSERT_THROW(AssetRouter(QUOTE(["a"])), std::exception);
+    ASSERT_THROW(AssetRouter("{"), std::exception);
+}
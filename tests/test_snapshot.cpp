@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+#include <plugin_api.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <exception>
+#include <string>
+
+// Tested files
+#include "pivot2opcua_common.h"
+#include "pivot2opcua_filter.h"
+#include "pivot2opcua_data.h"
+#include "pivot2opcua_snapshot.h"
+
+// Fledge / tools  includes
+#include "config_category.h"
+#include "main_test_configs.h"
+
+using namespace std;
+
+/** Test pivot2opcua_snapshot APIs */
+
+namespace {
+string tempSnapshotFile(const string& name) {
+    return string("/tmp/p2o_") + name + "_" + std::to_string(getpid()) + ".snapshot";
+}
+
+string readFile(const string& path) {
+    string result;
+    FILE* file(fopen(path.c_str(), "rb"));
+    if (file == nullptr) return result;
+    char buffer[4096];
+    size_t len;
+    while ((len = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        result.append(buffer, len);
+    }
+    fclose(file);
+    return result;
+}
+
+void writeFile(const string& path, const string& content) {
+    FILE* file(fopen(path.c_str(), "wb"));
+    ASSERT_NE(file, nullptr);
+    fwrite(content.data(), 1, content.size(), file);
+    fclose(file);
+}
+}   // namespace
+
+/* Snapshot saved and loaded */
+TEST(Pivot2Opcua_Snapshot, RoundTrip) {
+    TITLE("*** TEST SNAPSHOT RoundTrip");
+    const string path(tempSnapshotFile("roundtrip"));
+    for (const string& json : {string(Json_ExDataOK), getExDataMultiMapping()}) {
+        const uint64_t hash(DictionarySnapshot::contentHash(json.data(), json.size()));
+        ASSERT_EQ(hash, DictionarySnapshot::contentHash(json.data(), json.size()));
+        ASSERT_NE(hash, DictionarySnapshot::contentHash(json.data(), json.size() - 1));
+
+        const DataDictionnary dic(json);
+        ASSERT_TRUE(DictionarySnapshot::save(path, hash, dic));
+        DataDictionnary_Ptr loaded(DictionarySnapshot::load(path, hash));
+        ASSERT_NE(loaded, nullptr);
+        ASSERT_EQ(loaded->size(), dic.size());
+        ASSERT_EQ(loaded->duplicates(), dic.duplicates());
+        for (const PivotElementMap_t::value_type& item : dic) {
+            const PivotElementMap_t::const_iterator it(loaded->find(item.first));
+            ASSERT_FALSE(loaded->isEmpty(it));
+            ASSERT_EQ(it->second.m_pivot_type, item.second.m_pivot_type);
+            ASSERT_EQ(it->second.m_opcType, item.second.m_opcType);
+            ASSERT_EQ(it->second.m_address, item.second.m_address);
+            ASSERT_EQ(it->second.m_mappings.size(), item.second.m_mappings.size());
+            for (size_t i = 0 ; i < item.second.m_mappings.size() ; i++) {
+                ASSERT_EQ(it->second.m_mappings[i].m_opcType, item.second.m_mappings[i].m_opcType);
+                ASSERT_EQ(it->second.m_mappings[i].m_address, item.second.m_mappings[i].m_address);
+            }
+        }
+    }
+    unlink(path.c_str());
+}
+
+/* Missing, stale and corrupted snapshots are ignored */
+TEST(Pivot2Opcua_Snapshot, Invalid) {
+    TITLE("*** TEST SNAPSHOT Invalid");
+    const string path(tempSnapshotFile("invalid"));
+    const string json(Json_ExDataOK);
+    const uint64_t hash(DictionarySnapshot::contentHash(json.data(), json.size()));
+    unlink(path.c_str());
+    ASSERT_EQ(DictionarySnapshot::load(path, hash), nullptr);
+    ASSERT_EQ(DictionarySnapshot::load("", hash), nullptr);
+
+    ASSERT_TRUE(DictionarySnapshot::save(path, hash, DataDictionnary(json)));
+    ASSERT_EQ(DictionarySnapshot::load(path, hash + 1), nullptr);
+    const string content(readFile(path));
+    ASSERT_GT(content.size(), sizeof(DictionarySnapshot::SnapshotHeader));
+
+    // Modified content
+    string corrupted(content);
+    corrupted[corrupted.size() - 2] ^= 0x20;
+    writeFile(path, corrupted);
+    ASSERT_EQ(DictionarySnapshot::load(path, hash), nullptr);
+    // Truncated
+    writeFile(path, content.substr(0, content.size() - 1));
+    ASSERT_EQ(DictionarySnapshot::load(path, hash), nullptr);
+    writeFile(path, content.substr(0, 10));
+    ASSERT_EQ(DictionarySnapshot::load(path, hash), nullptr);
+    // Other version
+    corrupted = content;
+    corrupted[offsetof(DictionarySnapshot::SnapshotHeader, version)]++;
+    writeFile(path, corrupted);
+    ASSERT_EQ(DictionarySnapshot::load(path, hash), nullptr);
+
+    writeFile(path, content);
+    ASSERT_NE(DictionarySnapshot::load(path, hash), nullptr);
+    unlink(path.c_str());
+}
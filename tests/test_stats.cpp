@@ -0,0 +1,286 @@
+#include <gtest/gtest.h>
+#include <plugin_api.h>
+#include <string.h>
+#include <exception>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <rapidjson/document.h>
+
+// Tested files
+#include "pivot2opcua_common.h"
+#include "pivot2opcua_filter.h"
+#include "pivot2opcua_handles.h"
+#include "pivot2opcua_stats.h"
+#include "pivot2opcua_commands.h"
+
+// Fledge / tools  includes
+#include "config_category.h"
+#include "main_test_configs.h"
+
+using namespace std;
+using namespace rapidjson;
+
+/** Test pivot2opcua_stats APIs */
+
+/* LatencyHistogram */
+TEST(Pivot2Opcua_Stats, LatencyHistogram) {
+    TITLE("*** TEST STATS LatencyHistogram");
+    LatencyHistogram hist;
+
+    ASSERT_EQ(hist.count(), 0);
+    ASSERT_EQ(hist.percentile(0.5), 0);
+    ASSERT_EQ(hist.mean(), 0);
+
+    for (int64_t i = 1 ; i <= 1000 ; i++) {
+        hist.add(i);
+    }
+    hist.add(-5);
+    ASSERT_EQ(hist.count(), 1000);
+    ASSERT_EQ(hist.negatives(), 1);
+    ASSERT_EQ(hist.min(), 1);
+    ASSERT_EQ(hist.max(), 1000);
+    ASSERT_EQ(hist.mean(), 500);
+
+    // Percentiles are known with a relative error below 12.5%
+    const int64_t p50(hist.percentile(0.5));
+    ASSERT_GE(p50, 500);
+    ASSERT_LE(p50, 500 * 1.125);
+    const int64_t p99(hist.percentile(0.99));
+    ASSERT_GE(p99, 990);
+    ASSERT_LE(p99, 1000);
+    ASSERT_EQ(hist.percentile(1.0), 1000);
+
+    // Small values are exact
+    LatencyHistogram small;
+    small.add(0);
+    small.add(3);
+    small.add(7);
+    ASSERT_EQ(small.percentile(0.0), 0);
+    ASSERT_EQ(small.percentile(0.5), 3);
+    ASSERT_EQ(small.percentile(1.0), 7);
+
+    // Huge values are clamped in last bucket
+    LatencyHistogram huge;
+    huge.add(int64_t(1) << 50);
+    ASSERT_EQ(huge.percentile(0.5), int64_t(1) << 50);
+
+    hist.reset();
+    ASSERT_EQ(hist.count(), 0);
+    ASSERT_EQ(hist.negatives(), 0);
+}
+
+/* ConversionStatistics */
+TEST(Pivot2Opcua_Stats, ConversionStatistics) {
+    TITLE("*** TEST STATS ConversionStatistics");
+    FilterStatistics stats;
+    ConversionStatistics conversions;
+
+    conversions.addSourceLatency("iec104", 1000);
+    conversions.addSourceLatency("iec104", 2000);
+    conversions.addSourceLatency("iec61850", 10);
+
+    Document doc;
+    doc.Parse(stats.toJson(&conversions).c_str());
+    ASSERT_FALSE(doc.HasParseError());
+    ASSERT_TRUE(doc.HasMember("source_latency"));
+    const Value& sources(doc["source_latency"]);
+    ASSERT_TRUE(sources.IsObject());
+    ASSERT_TRUE(sources.HasMember("iec104"));
+    ASSERT_EQ(sources["iec104"]["count"].GetInt(), 2);
+    ASSERT_EQ(sources["iec104"]["max_us"].GetInt(), 2000);
+    ASSERT_TRUE(sources.HasMember("iec61850"));
+    ASSERT_EQ(sources["iec61850"]["min_us"].GetInt(), 10);
+
+    // Number of sources is bounded
+    for (int i = 0 ; i < 100 ; i++) {
+        conversions.addSourceLatency(string("src") + std::to_string(i), i);
+    }
+    doc.Parse(stats.toJson(&conversions).c_str());
+    ASSERT_FALSE(doc.HasParseError());
+    ASSERT_TRUE(doc["source_latency"].HasMember("__others__"));
+    ASSERT_LE(doc["source_latency"].MemberCount(), 65);
+
+    // Most frequently converted pivot ids, named from their handles
+    PivotElementMap_t map;
+    for (int i = 0 ; i < 100 ; i++) {
+        const string id("pivot" + std::to_string(i));
+        map.emplace(std::piecewise_construct, std::forward_as_tuple(id),
+                std::forward_as_tuple("GTIS", "opcua_sps", "addr_" + id));
+    }
+    const DataDictionnary_SharedPtr dictionnary(new DataDictionnary(std::move(map), 0));
+    const SignalHandles_SharedPtr handles(new SignalHandles(dictionnary, nullptr));
+    conversions.setHandles(handles);
+    const auto handleOf = [&dictionnary, &handles](const string& id) -> uint32_t {
+        return handles->handle(dictionnary->find(id)->second);
+    };
+    for (int i = 0 ; i < 100 ; i++) {
+        conversions.addConversion(handleOf("pivot" + std::to_string(i % 4 == 0 ? 0 : i)), 1000000 + i * 10000);
+    }
+    doc.Parse(stats.toJson(&conversions).c_str());
+    ASSERT_FALSE(doc.HasParseError());
+    const Value& hitters(doc["heavy_hitters"]);
+    ASSERT_EQ(hitters["total"].GetInt(), 100);
+    ASSERT_EQ(hitters["top"].Size(), 50);
+    ASSERT_STREQ(hitters["top"][0]["id"].GetString(), "pivot0");
+    ASSERT_EQ(hitters["top"][0]["count"].GetInt(), 25);
+    ASSERT_EQ(hitters["top"][0]["error"].GetInt(), 0);
+    ASSERT_EQ(hitters["top"][1]["count"].GetInt(), 1);
+
+    // A new table giving the handle of "pivot0" to another id: its count is dropped
+    PivotElementMap_t otherMap;
+    for (int i = 1 ; i < 101 ; i++) {
+        const string id("pivot" + std::to_string(i));
+        otherMap.emplace(std::piecewise_construct, std::forward_as_tuple(id),
+                std::forward_as_tuple("GTIS", "opcua_sps", "addr_" + id));
+    }
+    const DataDictionnary_SharedPtr other(new DataDictionnary(std::move(otherMap), 0));
+    const SignalHandles_SharedPtr otherHandles(new SignalHandles(other, handles.get()));
+    ASSERT_EQ(otherHandles->entry(handleOf("pivot0"))->first, "pivot100");
+    ASSERT_EQ(otherHandles->entry(handleOf("pivot1"))->first, "pivot1");
+    conversions.setHandles(otherHandles);
+    doc.Parse(stats.toJson(&conversions).c_str());
+    ASSERT_FALSE(doc.HasParseError());
+    ASSERT_EQ(doc["heavy_hitters"]["top"].Size(), 50);
+    ASSERT_EQ(doc["heavy_hitters"]["top"][0]["count"].GetInt(), 1);
+    for (const Value& hitter : doc["heavy_hitters"]["top"].GetArray()) {
+        ASSERT_STRNE(hitter["id"].GetString(), "pivot0");
+        ASSERT_STRNE(hitter["id"].GetString(), "pivot100");
+    }
+}
+
+/* FilterStatistics */
+TEST(Pivot2Opcua_Stats, FilterStatistics) {
+    TITLE("*** TEST STATS FilterStatistics");
+    FilterStatistics stats;
+
+    // Conversions are only reported with the statistics of the conversion lane
+    Document doc;
+    doc.Parse(stats.toJson().c_str());
+    ASSERT_FALSE(doc.HasParseError());
+    ASSERT_FALSE(doc.HasMember("source_latency"));
+    ASSERT_FALSE(doc.HasMember("heavy_hitters"));
+
+    // Dictionnary builds
+    stats.addDictionaryBuild(2, 150, 1234);
+    stats.addDictionaryBuildFailure(true);
+    stats.addDictionaryBuildFailure(false);
+    stats.addDictionaryBuildFailure(true);
+    doc.Parse(stats.toJson().c_str());
+    ASSERT_FALSE(doc.HasParseError());
+    const Value& dictionary(doc["dictionary"]);
+    ASSERT_EQ(dictionary["generation"].GetInt(), 2);
+    ASSERT_EQ(dictionary["entries"].GetInt(), 150);
+    ASSERT_EQ(dictionary["build_duration_us"].GetInt(), 1234);
+    ASSERT_EQ(dictionary["cancelled_builds"].GetInt(), 2);
+    ASSERT_EQ(dictionary["failed_builds"].GetInt(), 1);
+
+    // Unknown ids: the most recent ones are kept
+    ASSERT_TRUE(stats.addUnknownId("unknown0"));
+    ASSERT_FALSE(stats.addUnknownId("unknown0"));
+    for (int i = 1 ; i < 100 ; i++) {
+        ASSERT_TRUE(stats.addUnknownId("unknown" + std::to_string(i)));
+    }
+    ASSERT_FALSE(stats.addUnknownId("unknown99"));
+    ASSERT_TRUE(stats.addUnknownId("unknown0"));
+    doc.Parse(stats.toJson().c_str());
+    ASSERT_FALSE(doc.HasParseError());
+    const Value& unknown(doc["unknown_ids"]);
+    ASSERT_EQ(unknown["rejected"].GetInt(), 103);
+    ASSERT_EQ(unknown["recent"].MemberCount(), 64);
+    ASSERT_EQ(unknown["recent"]["unknown99"].GetInt(), 2);
+    ASSERT_EQ(unknown["recent"]["unknown0"].GetInt(), 1);
+    ASSERT_FALSE(unknown["recent"].HasMember("unknown36"));
+    ASSERT_NEAR(unknown["distinct_estimate"].GetInt(), 100, 3);
+    ASSERT_EQ(unknown["top"].Size(), 10);
+    ASSERT_STREQ(unknown["top"][0]["id"].GetString(), "unknown99");
+    ASSERT_EQ(unknown["top"][0]["count"].GetInt(), 2);
+    ASSERT_EQ(unknown["top"][1]["count"].GetInt(), 1);
+    ASSERT_TRUE(doc["dictionary_usage"].IsNull());
+
+    // Sets passed on
+    stats.addOutput(10, false);
+    stats.addOutput(3, true);
+    doc.Parse(stats.toJson().c_str());
+    ASSERT_FALSE(doc.HasParseError());
+    const Value& output(doc["output"]);
+    ASSERT_EQ(output["sets"].GetInt(), 2);
+    ASSERT_EQ(output["readings"].GetInt(), 13);
+    ASSERT_EQ(output["batch_timeouts"].GetInt(), 1);
+
+    // Latency per lane
+    stats.addLaneLatency(true, 5);
+    stats.addLaneLatency(false, 700);
+    stats.addLaneLatency(false, 900);
+    doc.Parse(stats.toJson().c_str());
+    ASSERT_FALSE(doc.HasParseError());
+    const Value& lanes(doc["lane_latency"]);
+    ASSERT_EQ(lanes["command"]["count"].GetInt(), 1);
+    ASSERT_EQ(lanes["command"]["max_us"].GetInt(), 5);
+    ASSERT_EQ(lanes["measurement"]["count"].GetInt(), 2);
+    ASSERT_EQ(lanes["measurement"]["min_us"].GetInt(), 700);
+}
+
+/* CommandTracker */
+TEST(Pivot2Opcua_Stats, CommandTracker) {
+    TITLE("*** TEST STATS CommandTracker");
+    CommandTracker tracker;
+    const int64_t t0(1000000000);
+    const int64_t timeout(10000000);
+
+    // Disabled by default
+    tracker.addCommand("cmd1", t0);
+    ASSERT_EQ(tracker.pending(), 0);
+
+    tracker.configure(3, timeout);
+    tracker.addCommand("cmd1", t0);
+    tracker.addCommand("cmd2", t0 + 1000);
+    tracker.addCommand("cmd3", t0 + 2000);
+    // Pool is full
+    tracker.addCommand("cmd4", t0 + 3000);
+    ASSERT_EQ(tracker.pending(), 3);
+
+    tracker.addReply("cmd1", true, t0 + 5000);
+    tracker.addReply("cmd2", false, t0 + 6000);
+    tracker.addReply("cmd4", true, t0 + 7000);
+    ASSERT_EQ(tracker.pending(), 1);
+    ASSERT_EQ(tracker.acks(), 2);
+    ASSERT_EQ(tracker.nacks(), 1);
+
+    // "cmd3" is not expired yet
+    tracker.expire(t0 + timeout - 1000000);
+    ASSERT_EQ(tracker.timeouts(), 0);
+    // Expiry is detected within a wheel tick
+    tracker.expire(t0 + timeout + 2 * timeout / 63);
+    ASSERT_EQ(tracker.timeouts(), 1);
+    ASSERT_EQ(tracker.pending(), 0);
+
+    // Command sent again before reply restarts its timer
+    const int64_t t1(t0 + 3 * timeout);
+    tracker.addCommand("cmd5", t1);
+    tracker.addCommand("cmd5", t1 + timeout / 2);
+    tracker.expire(t1 + timeout + timeout / 4);
+    ASSERT_EQ(tracker.timeouts(), 1);
+    ASSERT_EQ(tracker.pending(), 1);
+
+    // After a long inactivity, recent commands are kept
+    const int64_t t2(t1 + 100 * timeout);
+    tracker.addCommand("cmd6", t2);
+    tracker.expire(t2 + 1000);
+    ASSERT_EQ(tracker.timeouts(), 2);
+    ASSERT_EQ(tracker.pending(), 1);
+
+    rapidjson::StringBuffer buffer;
+    JsonWriter_t writer(buffer);
+    tracker.toJson(&writer);
+    Document doc;
+    doc.Parse(buffer.GetString());
+    ASSERT_FALSE(doc.HasParseError());
+    ASSERT_EQ(doc["commands"].GetInt(), 8);
+    ASSERT_EQ(doc["untracked"].GetInt(), 1);
+    ASSERT_EQ(doc["unmatched_replies"].GetInt(), 1);
+    ASSERT_EQ(doc["ack_latency"]["count"].GetInt(), 1);
+    ASSERT_EQ(doc["ack_latency"]["max_us"].GetInt(), 5000);
+    ASSERT_EQ(doc["nack_latency"]["count"].GetInt(), 1);
+    ASSERT_EQ(doc["timeouts"].GetInt(), 2);
+}
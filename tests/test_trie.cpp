@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+#include <plugin_api.h>
+#include <string.h>
+#include <string>
+
+// Tested files
+#include "pivot2opcua_common.h"
+#include "pivot2opcua_filter.h"
+#include "pivot2opcua_data.h"
+#include "pivot2opcua_trie.h"
+
+// Fledge / tools  includes
+#include "config_category.h"
+#include "main_test_configs.h"
+
+using namespace std;
+
+/** Test pivot2opcua_trie APIs */
+
+/* Wildcards and longest match */
+TEST(Pivot2Opcua_Trie, Match) {
+    TITLE("*** TEST TRIE Match");
+    const PivotElement pos("GTIS", "opcua_dps");
+    const PivotElement cbPos("GTIS", "opcua_sps");
+    const PivotElement station("GTIM", "opcua_mvf");
+    const PivotElement any("GTIM", "opcua_mvi");
+    PivotIdTrie trie;
+    ASSERT_EQ(trie.match("S1/B1/CB1/Pos"), nullptr);
+
+    trie.insert("S1/B*/*/Pos", &pos);
+    trie.insert("S1/B*/CB*/Pos", &cbPos);
+    trie.insert("S1/**", &station);
+    trie.insert("**", &any);
+    ASSERT_EQ(trie.size(), 4);
+    ASSERT_TRUE(PivotIdTrie::isPattern("S1/**"));
+    ASSERT_FALSE(PivotIdTrie::isPattern("S1/B1"));
+
+    // Most specific pattern wins
+    ASSERT_EQ(trie.match("S1/B1/CB1/Pos"), &cbPos);
+    ASSERT_EQ(trie.match("S1/B12/CB/Pos"), &cbPos);
+    ASSERT_EQ(trie.match("S1/B1/DS1/Pos"), &pos);
+    // '*' does not match '/', '**' does
+    ASSERT_EQ(trie.match("S1/B1/CB1/X/Pos"), &station);
+    ASSERT_EQ(trie.match("S1/B1/CB1/Pos2"), &station);
+    ASSERT_EQ(trie.match("S1/"), &station);
+    ASSERT_EQ(trie.match("S2/B1/CB1/Pos"), &any);
+    ASSERT_EQ(trie.match(""), &any);
+
+    // Literal prefixes shared by several patterns (edges are split)
+    PivotIdTrie prefixes;
+    prefixes.insert("S1/Bay*", &pos);
+    prefixes.insert("S1/B*", &cbPos);
+    prefixes.insert("S1/Bus", &station);
+    prefixes.insert("S1/Bus", &any);
+    ASSERT_EQ(prefixes.size(), 3);
+    ASSERT_EQ(prefixes.match("S1/Bay3"), &pos);
+    ASSERT_EQ(prefixes.match("S1/Bus"), &any);
+    ASSERT_EQ(prefixes.match("S1/Bu"), &cbPos);
+    ASSERT_EQ(prefixes.match("S1/B/"), nullptr);
+    ASSERT_EQ(prefixes.match("S1/"), nullptr);
+
+    // Ties are resolved by the smallest pattern
+    PivotIdTrie ties;
+    ties.insert("A*B", &pos);
+    ties.insert("*AB", &cbPos);
+    ASSERT_EQ(ties.match("AB"), &cbPos);
+}
@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+#include <plugin_api.h>
+#include <string.h>
+#include <string>
+#include <rapidjson/document.h>
+
+// Tested files
+#include "pivot2opcua_common.h"
+#include "pivot2opcua_filter.h"
+#include "pivot2opcua_hll.h"
+#include "pivot2opcua_usage.h"
+
+// Fledge / tools  includes
+#include "config_category.h"
+#include "main_test_configs.h"
+
+using namespace std;
+using namespace rapidjson;
+
+/** Test pivot2opcua_usage and pivot2opcua_hll APIs */
+
+/* Hits on dictionnary entries */
+TEST(Pivot2Opcua_Usage, DictionaryUsage) {
+    TITLE("*** TEST USAGE DictionaryUsage");
+    const DataDictionnary_SharedPtr dictionnary(new DataDictionnary(Json_ExDataOK));
+    ASSERT_GT(dictionnary->size(), 2);
+    DictionaryUsage usage(dictionnary);
+    ASSERT_EQ(usage.used(), 0);
+
+    const PivotElement* element(dictionnary->lookup("pivotSPS"));
+    ASSERT_NE(element, nullptr);
+    usage.hit(*element);
+    usage.hit(*element);
+    ASSERT_EQ(usage.used(), 1);
+
+    rapidjson::StringBuffer buffer;
+    JsonWriter_t writer(buffer);
+    usage.toJson(&writer);
+    Document doc;
+    doc.Parse(buffer.GetString());
+    ASSERT_FALSE(doc.HasParseError());
+    ASSERT_EQ(doc["entries"].GetUint(), dictionnary->size());
+    ASSERT_EQ(doc["used"].GetInt(), 1);
+    ASSERT_EQ(doc["unused"].GetUint(), dictionnary->size() - 1);
+    ASSERT_EQ(doc["unused_ids"].Size(), dictionnary->size() - 1);
+    ASSERT_STREQ(doc["unused_ids"][0].GetString(), "pivot1");
+    for (const Value& id : doc["unused_ids"].GetArray()) {
+        ASSERT_STRNE(id.GetString(), "pivotSPS");
+    }
+
+    // New dictionnary: hits of the ids still present are kept
+    usage.hit(*dictionnary->lookup("pivotMVF"));
+    const DataDictionnary_SharedPtr renamed(new DataDictionnary(replace_in_string(Json_ExDataOK, "pivotMVF",
+            "pivotNEW")));
+    const DictionaryUsage carried(renamed, &usage);
+    ASSERT_EQ(carried.dictionnary(), renamed);
+    ASSERT_EQ(carried.used(), 1);
+
+    // Large dictionnary: entries span several words, only the first unused ones are listed
+    string json("{\"exchanged_data\" : {\"name\" : \"SAMPLE\", \"version\" : \"1.0\", \"datapoints\" : [");
+    for (int i = 0 ; i < 200 ; i++) {
+        if (i > 0) json += ",";
+        json += "{\"label\":\"l" + std::to_string(i) + "\",\"pivot_id\":\"id" + std::to_string(1000 + i) +
+                "\",\"pivot_type\":\"SpsTyp\",\"protocols\":[{\"name\":\"opcua\",\"address\":\"a" +
+                std::to_string(i) + "\",\"typeid\":\"opcua_sps\"}]}";
+    }
+    json += "]}}";
+    const DataDictionnary_SharedPtr dict200(new DataDictionnary(json));
+    ASSERT_EQ(dict200->size(), 200);
+    DictionaryUsage usage200(dict200);
+    for (int i = 0 ; i < 200 ; i += 2) {
+        usage200.hit(*dict200->lookup("id" + std::to_string(1000 + i)));
+    }
+    ASSERT_EQ(usage200.used(), 100);
+    rapidjson::StringBuffer buffer200;
+    JsonWriter_t writer200(buffer200);
+    usage200.toJson(&writer200);
+    doc.Parse(buffer200.GetString());
+    ASSERT_FALSE(doc.HasParseError());
+    ASSERT_EQ(doc["unused"].GetInt(), 100);
+    ASSERT_EQ(doc["unused_ids"].Size(), 20);
+    ASSERT_STREQ(doc["unused_ids"][0].GetString(), "id1001");
+    ASSERT_STREQ(doc["unused_ids"][19].GetString(), "id1039");
+}
+
+/* Distinct count estimates */
+TEST(Pivot2Opcua_Usage, HyperLogLog) {
+    TITLE("*** TEST USAGE HyperLogLog");
+    HyperLogLog hll;
+    ASSERT_EQ(hll.estimate(), 0);
+    for (int repeat = 0 ; repeat < 3 ; repeat++) {
+        for (int i = 0 ; i < 10 ; i++) {
+            hll.add("unknown" + std::to_string(i));
+        }
+    }
+    ASSERT_EQ(hll.estimate(), 10);
+
+    for (int i = 0 ; i < 100000 ; i++) {
+        hll.add("S" + std::to_string(i / 100) + "/B" + std::to_string(i % 100) + "/Unmapped");
+    }
+    const double estimate(static_cast<double>(hll.estimate()));
+    ASSERT_GT(estimate, 100010 * 0.95);
+    ASSERT_LT(estimate, 100010 * 1.05);
+
+    hll.reset();
+    ASSERT_EQ(hll.estimate(), 0);
+}
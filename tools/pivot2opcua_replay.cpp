@@ -0,0 +1,418 @@
+/*
+ * Fledge "pivottoopcua" filter plugin.
+ *
+ * Copyright (c) 2020 Dianomic Systems
+ *
+ * Released under the Apache 2.0 Licence
+ */
+
+/**
+ * Offline replay of readings through Pivot2OpcuaFilter.
+ *
+ * Readings are loaded from a capture file (see capture_file setting) or from a
+ * JSONL file (one Fledge reading per line:
+ *      {"asset_code": "...", "reading": {...}, "user_ts": "2023-01-31 12:00:00.123456"}
+ * ) and replayed through Pivot2OpcuaFilter::ingest, either at maximum speed or
+ * with the original pacing.
+ * The tool reports throughput, ingest latency percentiles, allocations per reading
+ * and a checksum of the output readings (which can also be written to a file),
+ * so that two builds of the filter can be compared on real traffic.
+ */
+
+// System headers
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Fledge headers
+#include "config_category.h"
+#include "reading_set.h"
+#include "logger.h"
+#include "rapidjson/document.h"
+
+// Project headers
+#include "pivot2opcua_filter.h"
+#include "pivot2opcua_capture.h"
+#include "pivot2opcua_histogram.h"
+
+/**************************************************************************/
+/*                ALLOCATION COUNTING                                     */
+/**************************************************************************/
+namespace {
+std::atomic<uint64_t> s_allocCount(0);
+std::atomic<uint64_t> s_allocBytes(0);
+}   // namespace
+
+void* operator new(size_t size) {
+    s_allocCount.fetch_add(1, std::memory_order_relaxed);
+    s_allocBytes.fetch_add(size, std::memory_order_relaxed);
+    void* ptr(malloc(size > 0 ? size : 1));
+    if (ptr == nullptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    free(ptr);
+}
+
+namespace {
+using Clock = std::chrono::steady_clock;
+using ReadingVect_t = std::vector<Reading*>;
+
+struct ReplayOptions {
+    std::string configFile;
+    std::string captureFile;
+    std::string jsonlFile;
+    std::string outputFile;
+    std::string logLevel = "warning";
+    bool        originalPacing = false;
+    unsigned    batchSize = 1;
+    unsigned    repeat = 1;
+    std::vector<std::pair<std::string, std::string>> settings;
+};
+
+/** A batch of readings, as received by the filter */
+struct ReplayBatch {
+    int64_t         timeUs;
+    ReadingVect_t   readings;
+};
+using ReplayBatches_t = std::vector<ReplayBatch>;
+
+/**
+ * Receives the output of the filter. Outputs may be passed on by the filter threads
+ * (async_queue, batch_size settings), while the main thread consumes them.
+ */
+struct ReplayOutput {
+    std::mutex      mutex;
+    std::vector<ReadingSet*> sets;      /// Guarded by mutex
+    uint64_t        readings = 0;
+    uint64_t        checksum = 14695981039346656037ULL;   // FNV-1a 64 offset basis
+    std::ofstream   file;
+
+    static void onOutput(OUTPUT_HANDLE* handle, READINGSET* readingSet) {
+        ReplayOutput* output(static_cast<ReplayOutput*>(handle));
+        std::lock_guard<std::mutex> guard(output->mutex);
+        output->sets.push_back(readingSet);
+    }
+
+    /** Account all received outputs, then release them */
+    void consume(void) {
+        std::vector<ReadingSet*> received;
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            received.swap(sets);
+        }
+        for (ReadingSet* readingSet : received) {
+            for (Reading* reading : *readingSet->getAllReadingsPtr()) {
+                const std::string line(std::string("{\"asset_code\":\"") + reading->getAssetName() +
+                        "\",\"reading\":" + reading->getDatapointsJSON() + "}");
+                for (const char c : line) {
+                    checksum = (checksum ^ static_cast<uint8_t>(c)) * 1099511628211ULL;
+                }
+                if (file.is_open()) file << line << "\n";
+                readings++;
+            }
+            delete readingSet;
+        }
+    }
+};
+
+void usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " --config <exchanged_data.json> (--capture <file> | --jsonl <file>)\n"
+            "    [--pacing max|original] [--batch <readings per batch (JSONL)>] [--repeat <count>]\n"
+            "    [--set <item>=<value>]... [--output <file.jsonl>] [--log <level>]\n";
+}
+
+bool parseOptions(int argc, char** argv, ReplayOptions* options) {
+    for (int i = 1 ; i < argc ; i++) {
+        const std::string arg(argv[i]);
+        if (i + 1 >= argc) return false;
+        const std::string value(argv[++i]);
+        if (arg == "--config") {
+            options->configFile = value;
+        } else if (arg == "--capture") {
+            options->captureFile = value;
+        } else if (arg == "--jsonl") {
+            options->jsonlFile = value;
+        } else if (arg == "--output") {
+            options->outputFile = value;
+        } else if (arg == "--log") {
+            options->logLevel = value;
+        } else if (arg == "--pacing") {
+            if (value != "max" && value != "original") return false;
+            options->originalPacing = (value == "original");
+        } else if (arg == "--batch") {
+            options->batchSize = static_cast<unsigned>(atoi(value.c_str()));
+        } else if (arg == "--repeat") {
+            options->repeat = static_cast<unsigned>(atoi(value.c_str()));
+        } else if (arg == "--set") {
+            const size_t eq(value.find('='));
+            if (eq == std::string::npos) return false;
+            options->settings.emplace_back(value.substr(0, eq), value.substr(eq + 1));
+        } else {
+            return false;
+        }
+    }
+    return !options->configFile.empty() && options->batchSize > 0 && options->repeat > 0 &&
+            (options->captureFile.empty() != options->jsonlFile.empty());
+}
+
+/** Convert a JSON value into a datapoint (booleans are converted to integers) */
+Datapoint* jsonToDatapoint(const std::string& name, const rapidjson::Value& value) {
+    if (value.IsObject() || value.IsArray()) {
+        std::vector<Datapoint*>* children(new std::vector<Datapoint*>);
+        DatapointValue dpv(children, value.IsObject());
+        Datapoint* dp(new Datapoint(name, dpv));
+        std::vector<Datapoint*>* target(dp->getData().getDpVec());
+        if (value.IsObject()) {
+            for (rapidjson::Value::ConstMemberIterator it = value.MemberBegin() ; it != value.MemberEnd() ; it++) {
+                Datapoint* child(jsonToDatapoint(it->name.GetString(), it->value));
+                if (child != nullptr) target->push_back(child);
+            }
+        } else {
+            int idx(0);
+            for (rapidjson::Value::ConstValueIterator it = value.Begin() ; it != value.End() ; it++) {
+                Datapoint* child(jsonToDatapoint(std::string("#") + std::to_string(++idx), *it));
+                if (child != nullptr) target->push_back(child);
+            }
+        }
+        return dp;
+    }
+    if (value.IsString()) {
+        DatapointValue dpv(std::string(value.GetString(), value.GetStringLength()));
+        return new Datapoint(name, dpv);
+    }
+    if (value.IsBool()) {
+        DatapointValue dpv(static_cast<long>(value.GetBool() ? 1 : 0));  // //NOLINT
+        return new Datapoint(name, dpv);
+    }
+    if (value.IsInt64()) {
+        DatapointValue dpv(static_cast<long>(value.GetInt64()));  // //NOLINT
+        return new Datapoint(name, dpv);
+    }
+    if (value.IsNumber()) {
+        DatapointValue dpv(value.GetDouble());
+        return new Datapoint(name, dpv);
+    }
+    return nullptr;
+}
+
+/** @return The Fledge timestamp "YYYY-MM-DD HH:MM:SS[.ffffff]" in us since Epoch, or -1 */
+int64_t parseTimestamp(const char* str) {
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    const char* end(strptime(str, "%Y-%m-%d %H:%M:%S", &tm));
+    if (end == nullptr) return -1;
+    int64_t us(static_cast<int64_t>(timegm(&tm)) * 1000000);
+    if (*end == '.') {
+        int64_t scale(100000);
+        for (end++ ; *end >= '0' && *end <= '9' ; end++) {
+            us += (*end - '0') * scale;
+            scale /= 10;
+        }
+    }
+    return us;
+}
+
+bool loadJsonl(const ReplayOptions& options, ReplayBatches_t* batches) {
+    std::ifstream input(options.jsonlFile);
+    if (!input) {
+        std::cerr << "Cannot open " << options.jsonlFile << std::endl;
+        return false;
+    }
+    std::string line;
+    unsigned lineNo(0);
+    while (std::getline(input, line)) {
+        lineNo++;
+        if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+        rapidjson::Document doc;
+        doc.Parse(line.c_str());
+        if (doc.HasParseError() || !doc.IsObject() || !doc.HasMember("asset_code") ||
+                !doc["asset_code"].IsString() || !doc.HasMember("reading") || !doc["reading"].IsObject()) {
+            std::cerr << options.jsonlFile << ":" << lineNo << ": invalid reading (ignored)" << std::endl;
+            continue;
+        }
+        std::vector<Datapoint*> datapoints;
+        const rapidjson::Value& reading(doc["reading"]);
+        for (rapidjson::Value::ConstMemberIterator it = reading.MemberBegin() ; it != reading.MemberEnd() ; it++) {
+            Datapoint* dp(jsonToDatapoint(it->name.GetString(), it->value));
+            if (dp != nullptr) datapoints.push_back(dp);
+        }
+        int64_t timeUs(-1);
+        if (doc.HasMember("user_ts") && doc["user_ts"].IsString()) {
+            timeUs = parseTimestamp(doc["user_ts"].GetString());
+        }
+        if (batches->empty() || batches->back().readings.size() >= options.batchSize) {
+            ReplayBatch batch;
+            batch.timeUs = timeUs;
+            batches->push_back(batch);
+        }
+        batches->back().readings.push_back(new Reading(doc["asset_code"].GetString(), datapoints));
+    }
+    return true;
+}
+
+bool loadCapture(const ReplayOptions& options, ReplayBatches_t* batches) {
+    return ReadingCapture::readFile(options.captureFile,
+            [batches](const ReadingCapture::CaptureIndexEntry& entry, const uint8_t* data) {
+        ReplayBatch batch;
+        batch.timeUs = entry.captureTimeUs;
+        batch.readings = ReadingCapture::decodeBatch(data, entry.length, entry.nbReadings);
+        batches->push_back(batch);
+    });
+}
+
+bool readFile(const std::string& path, std::string* content) {
+    std::ifstream input(path);
+    if (!input) return false;
+    std::stringstream buffer;
+    buffer << input.rdbuf();
+    *content = buffer.str();
+    return true;
+}
+
+double toMs(int64_t ns) {
+    return static_cast<double>(ns) / 1e6;
+}
+}   // namespace
+
+/**************************************************************************/
+int main(int argc, char** argv) {
+    ReplayOptions options;
+    if (!parseOptions(argc, argv, &options)) {
+        usage(argv[0]);
+        return 2;
+    }
+    Logger::getLogger()->setMinLevel(options.logLevel);
+
+    std::string exchangedData;
+    if (!readFile(options.configFile, &exchangedData)) {
+        std::cerr << "Cannot read " << options.configFile << std::endl;
+        return 1;
+    }
+
+    ReplayBatches_t batches;
+    try {
+        if (!(options.jsonlFile.empty() ? loadCapture(options, &batches) : loadJsonl(options, &batches))) {
+            return 1;
+        }
+    } catch (const std::exception&) {
+        std::cerr << "Corrupted input file" << std::endl;
+        return 1;
+    }
+    uint64_t nbReadings(0);
+    for (const ReplayBatch& batch : batches) {
+        nbReadings += batch.readings.size();
+    }
+    std::cout << "Loaded " << batches.size() << " batches, " << nbReadings << " readings" << std::endl;
+
+    ConfigCategory config;
+    config.addItem("enable", "enable", "boolean", "true", "true");
+    config.addItem(JSON_EXCHANGED_DATA, JSON_EXCHANGED_DATA, "JSON", exchangedData, exchangedData);
+    for (const std::pair<std::string, std::string>& setting : options.settings) {
+        config.addItem(setting.first, setting.first, "string", setting.second, setting.second);
+    }
+
+    ReplayOutput output;
+    if (!options.outputFile.empty()) {
+        output.file.open(options.outputFile);
+        if (!output.file) {
+            std::cerr << "Cannot write " << options.outputFile << std::endl;
+            return 1;
+        }
+    }
+
+    // With an asynchronous queue, ingest only queues the readings
+    bool queued(false);
+    for (const std::pair<std::string, std::string>& setting : options.settings) {
+        if (setting.first == JSON_ASYNC_QUEUE) queued = (atoll(setting.second.c_str()) > 0);
+    }
+
+    LatencyHistogram latencyNs;
+    int64_t ingestNs(0);
+    uint64_t allocCount(0);
+    uint64_t allocBytes(0);
+    std::string statistics;
+    Clock::time_point start;
+    {
+        Pivot2OpcuaFilter filter("replay", config, &output, &ReplayOutput::onOutput);
+        start = Clock::now();
+        int64_t firstTimeUs(-1);
+        for (unsigned iteration = 0 ; iteration < options.repeat ; iteration++) {
+            const Clock::time_point iterationStart(Clock::now());
+            for (const ReplayBatch& batch : batches) {
+                if (options.originalPacing && batch.timeUs >= 0) {
+                    if (firstTimeUs < 0) firstTimeUs = batch.timeUs;
+                    const std::chrono::microseconds offset(batch.timeUs - firstTimeUs);
+                    std::this_thread::sleep_until(iterationStart + offset);
+                }
+                // The filter modifies its input: replay a copy
+                std::vector<Reading*> copies;
+                copies.reserve(batch.readings.size());
+                for (Reading* reading : batch.readings) {
+                    copies.push_back(new Reading(*reading));
+                }
+                ReadingSet* readingSet(new ReadingSet(&copies));
+
+                const uint64_t allocCount0(s_allocCount.load());
+                const uint64_t allocBytes0(s_allocBytes.load());
+                const Clock::time_point t0(Clock::now());
+                filter.ingest(readingSet);
+                const int64_t ns(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count());
+                allocCount += s_allocCount.load() - allocCount0;
+                allocBytes += s_allocBytes.load() - allocBytes0;
+                latencyNs.add(ns);
+                ingestNs += ns;
+                output.consume();
+            }
+            firstTimeUs = -1;
+        }
+        statistics = filter.getStatistics();
+        // The filter is destroyed once all its queued and batched readings are passed on
+    }
+    const int64_t wallNs(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+    output.consume();
+
+    const uint64_t replayed(nbReadings * options.repeat);
+    const double perReading(replayed > 0 ? 1.0 / static_cast<double>(replayed) : 0.0);
+    printf("Replayed %llu readings in %.3f ms (ingest: %.3f ms)\n",
+            static_cast<unsigned long long>(replayed), toMs(wallNs), toMs(ingestNs));  // //NOLINT
+    printf("Throughput: %.0f readings/s%s\n",
+            ingestNs > 0 ? static_cast<double>(replayed) * 1e9 / static_cast<double>(ingestNs) : 0.0,
+            queued ? " (enqueueing only)" : "");
+    printf("Ingest latency per batch (us)%s: p50=%.3f p90=%.3f p99=%.3f max=%.3f\n",
+            queued ? " (enqueueing only, async_queue is set)" : "",
+            static_cast<double>(latencyNs.percentile(0.50)) / 1e3,
+            static_cast<double>(latencyNs.percentile(0.90)) / 1e3,
+            static_cast<double>(latencyNs.percentile(0.99)) / 1e3,
+            static_cast<double>(latencyNs.max()) / 1e3);
+    printf("Allocations: %.2f per reading, %.1f bytes per reading\n",
+            static_cast<double>(allocCount) * perReading, static_cast<double>(allocBytes) * perReading);
+    printf("Output: %llu readings, checksum %016llx\n",
+            static_cast<unsigned long long>(output.readings),  // //NOLINT
+            static_cast<unsigned long long>(output.checksum));  // //NOLINT
+    printf("Filter statistics: %s\n", statistics.c_str());
+
+    for (ReplayBatch& batch : batches) {
+        for (Reading* reading : batch.readings) {
+            delete reading;
+        }
+    }
+    return 0;
+}